@@ -1,4 +1,5 @@
 % Beregning af det frie fald, med og uden luftmodstand
+% Sweeps over mass, height, area and cw: host/drop_sim (Euler or RK4)
 
 V0=0;               % initial speed
 h0=0.5;             % initial height
@@ -43,9 +44,9 @@ h_w(i+1)=h_w(i)-V_w(i)*deltat;
 V_b(i+1)=V_b(i)+deltat*(g-(k_b*V_b(i)^2)/m);
 
 h_b(i+1)=h_b(i)-V_b(i)*deltat;
+end
 
 h_fald=-(1/2)*g*t.^2+h0;
-end
 
 plot(t,h_w,t,h_b,t,h_fald,t,u);
 
@@ -0,0 +1,283 @@
+/* ========================================
+ *
+ * Copyright YOUR COMPANY, THE YEAR
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CONFIDENTIAL AND PROPRIETARY INFORMATION
+ * WHICH IS THE PROPERTY OF your company.
+ *
+ * ========================================
+*/
+
+#include "blackbox.h"
+#include "crc16.h"
+#include "telemetry.h"
+
+#if defined(BLACKBOX) && !defined(TELEMETRY) && !defined(HOST_BUILD)
+#include "project.h"
+#include "cy_em_eeprom.h"
+#include <stddef.h>
+#endif
+
+static uint16 Wrap(uint16 i)
+{
+    return (i >= BLACKBOX_LEN) ? (uint16)(i - BLACKBOX_LEN) : i;
+}
+
+static int16 Centideg(int32 q16)
+{
+    // deg Q16 to 0.01 deg, rounded. |angle| <= 180 keeps q16 * 100 within 31 bits
+    return (int16)((q16 * 100 + 32768) >> 16);
+}
+
+static uint8 *Put16(uint8 *p, uint16 x)
+{
+    p[0] = (uint8)x;
+    p[1] = (uint8)(x >> 8);
+    return p + 2;
+}
+
+static uint8 *Put32(uint8 *p, uint32 x)
+{
+    p[0] = (uint8)x;
+    p[1] = (uint8)(x >> 8);
+    p[2] = (uint8)(x >> 16);
+    p[3] = (uint8)(x >> 24);
+    return p + 4;
+}
+
+void BlackBox_Init(BLACKBOX_STATE *bb)
+{
+    bb->head = 0;
+    bb->count = 0;
+    bb->mode = BLACKBOX_LIVE;
+    bb->postLeft = 0;
+    bb->start = 0;
+    bb->length = 0;
+    bb->trigger = 0;
+    bb->drained = 0;
+    bb->events = 0;
+    bb->merged = 0;
+    bb->missed = 0;
+    bb->dropped = 0;
+}
+
+void BlackBox_Record(BLACKBOX_STATE *bb, const IMU_FRAME *frame, const FUSION_OUT *fused, uint8 state, uint8 flags)
+{
+    // once per decided sample, after Detect_Update so state is the one the sample led to
+    BLACKBOX_RECORD *r;
+
+    if(bb->mode == BLACKBOX_FROZEN && bb->head == bb->start && bb->count != 0u)
+    {
+        bb->dropped++;      // the rest of the ring is used up, the window is not drained yet
+        return;
+    }
+
+    r = &bb->ring[bb->head];
+    r->seq = frame->seq;
+    for(uint8 i = 0; i < 3u; i++)
+    {
+        r->accel[i] = frame->accel[i];
+        r->gyro[i] = frame->gyro[i];
+    }
+    r->roll = Centideg(fused->rollQ16);
+    r->pitch = Centideg(fused->pitchQ16);
+    r->accNow = (fused->accNow > 0xFFFF) ? 0xFFFFu : (uint16)fused->accNow;
+    r->state = state;
+    r->flags = flags;
+
+    bb->head = Wrap(bb->head + 1u);
+    if(bb->count < BLACKBOX_LEN)
+    {
+        bb->count++;
+    }
+
+    if(bb->mode == BLACKBOX_POST_TRIGGER)
+    {
+        bb->length++;
+        if(--bb->postLeft == 0u)
+        {
+            bb->mode = BLACKBOX_FROZEN;
+            bb->drained = 0;
+            bb->events++;
+        }
+    }
+}
+
+void BlackBox_Trigger(BLACKBOX_STATE *bb)
+{
+    // after BlackBox_Record of the trigger sample
+    uint16 pre;
+
+    if(bb->mode == BLACKBOX_POST_TRIGGER)
+    {
+        bb->merged++;
+        return;
+    }
+    if(bb->mode == BLACKBOX_FROZEN || bb->count == 0u)
+    {
+        bb->missed++;
+        return;
+    }
+
+    pre = (bb->count - 1u < BLACKBOX_PRE) ? (uint16)(bb->count - 1u) : BLACKBOX_PRE;
+    bb->start = Wrap((uint16)(bb->head + BLACKBOX_LEN - 1u - pre));
+    bb->trigger = pre;
+    bb->length = pre + 1u;
+    bb->postLeft = BLACKBOX_POST;
+    bb->mode = BLACKBOX_POST_TRIGGER;
+    bb->ring[Wrap(bb->start + pre)].flags |= BLACKBOX_FLAG_TRIGGER;
+}
+
+uint8 BlackBox_Peek(const BLACKBOX_STATE *bb, const BLACKBOX_RECORD **record)
+{
+    // next window record for the sink, FALSE while no window is frozen
+    if(bb->mode != BLACKBOX_FROZEN)
+    {
+        return FALSE;
+    }
+    *record = &bb->ring[Wrap(bb->start + bb->drained)];
+
+    return TRUE;
+}
+
+void BlackBox_Consume(BLACKBOX_STATE *bb, uint16 records)
+{
+    // the sink has taken records more, the last one releases the window
+    if(bb->mode != BLACKBOX_FROZEN)
+    {
+        return;
+    }
+    bb->drained += records;
+    if(bb->drained >= bb->length)
+    {
+        bb->mode = BLACKBOX_LIVE;
+    }
+}
+
+uint16 BlackBox_Pack(uint8 *packet, const BLACKBOX_STATE *bb, const BLACKBOX_RECORD *record)
+{
+    // layout in blackbox.h, record is bb's current window record. Returns BLACKBOX_PACKET_SIZE
+    uint8 *p = packet;
+
+    *p++ = TELEMETRY_TYPE_BLACKBOX;
+    p = Put16(p, (uint16)bb->events);
+    p = Put16(p, bb->drained);
+    p = Put16(p, bb->length);
+    p = Put16(p, bb->trigger);
+    p = Put32(p, record->seq);
+    for(uint8 i = 0; i < 3u; i++)
+    {
+        p = Put16(p, (uint16)record->accel[i]);
+    }
+    for(uint8 i = 0; i < 3u; i++)
+    {
+        p = Put16(p, (uint16)record->gyro[i]);
+    }
+    p = Put16(p, (uint16)record->roll);
+    p = Put16(p, (uint16)record->pitch);
+    p = Put16(p, record->accNow);
+    *p++ = record->state;
+    *p++ = record->flags;
+    p = Put16(p, Crc16(packet, (uint16)(p - packet)));
+
+    return (uint16)(p - packet);
+}
+
+#if defined(BLACKBOX) && !defined(TELEMETRY) && !defined(HOST_BUILD)
+
+#define BLACKBOX_FLASH_SIZE     (sizeof(BLACKBOX_HEADER) + sizeof(BLACKBOX_RECORD) * BLACKBOX_WINDOW)
+#define BLACKBOX_HEADER_CRC_LEN ((uint16)offsetof(BLACKBOX_HEADER, crc))
+
+// flash rows behind the emulated EEPROM, header then the window records
+static const uint8 CY_ALIGN(CY_FLASH_SIZEOF_ROW) blackboxFlash[CY_EM_EEPROM_GET_PHYSICAL_SIZE(BLACKBOX_FLASH_SIZE, 1u, 1u, 0u)] = { 0u };
+
+/* Global variable declaration */
+    static cy_stc_eeprom_config_t eepromConfig =
+    {
+        .eepromSize = BLACKBOX_FLASH_SIZE,
+        .simpleMode = 1u,                       // plain rows, the header written last marks a complete window
+        .wearLevelingFactor = 1u,
+        .redundantCopy = 0u,
+        .blockingWrite = 1u,
+    };                                          // userFlashStartAddr set in BlackBox_Start
+    static cy_stc_eeprom_context_t eepromContext;
+    static uint8 eepromReady = FALSE;
+
+    uint32 blackboxStoreErrors = 0;
+
+static uint8 WriteHeader(const BLACKBOX_STATE *bb, uint16 length)
+{
+    BLACKBOX_HEADER h;
+
+    h.event = bb->events;
+    h.triggerSeq = bb->ring[Wrap(bb->start + bb->trigger)].seq;
+    h.length = length;
+    h.trigger = bb->trigger;
+    h.reserved = 0;
+    h.crc = Crc16((const uint8 *)&h, BLACKBOX_HEADER_CRC_LEN);
+
+    return Cy_Em_EEPROM_Write(0u, &h, sizeof(h), &eepromContext) == CY_EM_EEPROM_SUCCESS;
+}
+
+void BlackBox_Start(void)
+{
+    eepromConfig.userFlashStartAddr = (uint32)blackboxFlash;
+    eepromReady = (Cy_Em_EEPROM_Init(&eepromConfig, &eepromContext) == CY_EM_EEPROM_SUCCESS);
+}
+
+void BlackBox_Store(BLACKBOX_STATE *bb)
+{
+    /*
+        Blocking flash write of up to BLACKBOX_STORE_RECORDS window records,
+        main loop only and never while the actuator is pending. The window
+        records are contiguous unless they wrap at the end of the ring, then
+        the copy stops there and the next call goes on from slot 0.
+    */
+
+    const BLACKBOX_RECORD *first;
+    uint16 n = bb->length - bb->drained;
+    uint16 slot;
+
+    if(!BlackBox_Peek(bb, &first))
+    {
+        return;
+    }
+    if(!eepromReady)
+    {
+        BlackBox_Consume(bb, n);    // nowhere to put it, keep recording
+        blackboxStoreErrors++;
+        return;
+    }
+
+    if(bb->drained == 0u && !WriteHeader(bb, 0u))  // the old window is gone from here on
+    {
+        blackboxStoreErrors++;
+    }
+
+    slot = Wrap(bb->start + bb->drained);
+    if(n > BLACKBOX_STORE_RECORDS)
+    {
+        n = BLACKBOX_STORE_RECORDS;
+    }
+    if(n > BLACKBOX_LEN - slot)
+    {
+        n = BLACKBOX_LEN - slot;
+    }
+
+    if(Cy_Em_EEPROM_Write(sizeof(BLACKBOX_HEADER) + sizeof(BLACKBOX_RECORD) * bb->drained, (void *)first,
+                          sizeof(BLACKBOX_RECORD) * n, &eepromContext) != CY_EM_EEPROM_SUCCESS)
+    {
+        blackboxStoreErrors++;
+    }
+    if(bb->drained + n >= bb->length && !WriteHeader(bb, bb->length))
+    {
+        blackboxStoreErrors++;
+    }
+    BlackBox_Consume(bb, n);
+}
+
+#endif
+
+/* [] END OF FILE */
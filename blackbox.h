@@ -0,0 +1,155 @@
+/* ========================================
+ *
+ * Copyright YOUR COMPANY, THE YEAR
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CONFIDENTIAL AND PROPRIETARY INFORMATION
+ * WHICH IS THE PROPERTY OF your company.
+ *
+ * ========================================
+*/
+
+/*
+    Black-box recorder (BLACKBOX in main.h): the last BLACKBOX_LEN samples in
+    SRAM, and a window around every fall frozen until it has been drained.
+
+    BlackBox_Record takes every decided sample, raw accel/gyro as the fusion
+    saw them, roll/pitch, |a|, detector state and actuator flags, 24 bytes
+    per sample. The ring is 24 KB, 10.24 s at 100 Hz, of the ~60 KB SRAM the
+    rest of the firmware leaves free.
+
+    BlackBox_Trigger on the sample that switches the actuator on marks it and
+    keeps up to BLACKBOX_PRE samples before it. After BLACKBOX_POST more
+    samples the window is frozen: recording goes on in the rest of the ring,
+    but stops (and counts dropped samples) instead of overwriting the window.
+    Triggers during the post samples belong to the same window, triggers while
+    a window waits to be drained are only counted.
+
+    A sink takes the window with BlackBox_Peek / BlackBox_Consume, the last
+    Consume releases it:
+        TELEMETRY   one TELEMETRY_TYPE_BLACKBOX packet per sample period next
+                    to the sample packets, 500 records in 5 s
+        otherwise   BlackBox_Store copies BLACKBOX_STORE_RECORDS per call into
+                    blackboxFlash behind the emulated EEPROM, the header last,
+                    so only a complete window is ever valid. Read it with the
+                    debugger.
+
+    Packet, all fields little endian, BLACKBOX_PACKET_SIZE bytes, COBS framed
+    like the sample packets (telemetry.h):
+
+        0   uint8   type            TELEMETRY_TYPE_BLACKBOX
+        1   uint16  event           BLACKBOX_STATE.events when the window froze
+        3   uint16  index           record in the window, 0 first
+        5   uint16  length          records in the window
+        7   uint16  trigger         index of the trigger record
+        9   uint32  seq             IMU_FRAME.seq
+        13  int16   accel[3]        counts, offsets removed (calib.h)
+        19  int16   gyro[3]
+        25  int16   roll            0.01 deg
+        27  int16   pitch
+        29  uint16  accNow          |a| in counts
+        31  uint8   state           DETECT_IDLE ...
+        32  uint8   flags           BLACKBOX_FLAG_*
+        33  uint16  crc             Crc16 (crc16.h) over bytes 0..32
+
+    host/telemetry_decode --blackbox writes the records as CSV.
+*/
+
+#if !defined(BLACKBOX_H)
+#define BLACKBOX_H
+
+#include "imu_types.h"
+#include "main.h"
+#include "fusion.h"
+
+/***************************************
+*            Constants
+****************************************/
+
+#define BLACKBOX_LEN            (1024u)     // samples in the ring, 10.24 s at 100 Hz
+#define BLACKBOX_PRE            (300u)      // samples kept before the trigger, 3 s
+#define BLACKBOX_POST           (200u)      // samples taken after it, 2 s
+#define BLACKBOX_WINDOW         (BLACKBOX_PRE + 1u + BLACKBOX_POST)
+#define BLACKBOX_STORE_RECORDS  (20u)       // per BlackBox_Store, ~2 flash rows
+
+#define BLACKBOX_PACKET_SIZE    (35u)       // with the CRC
+
+// modes
+#define BLACKBOX_LIVE           (0u)        // recording, no window
+#define BLACKBOX_POST_TRIGGER   (1u)        // taking the samples after the trigger
+#define BLACKBOX_FROZEN         (2u)        // window waits for its sink
+
+// flags
+#define BLACKBOX_FLAG_ACTUATOR  (0x01u)     // detector has the actuator on
+#define BLACKBOX_FLAG_PENDING   (0x02u)     // actuator scheduled, not on yet
+#define BLACKBOX_FLAG_TRIGGER   (0x04u)     // the sample that froze the window
+
+/***************************************
+*            Types
+****************************************/
+
+typedef struct
+{
+    uint32 seq;
+    int16 accel[3];
+    int16 gyro[3];
+    int16 roll;                     // 0.01 deg
+    int16 pitch;
+    uint16 accNow;                  // |a| in counts
+    uint8 state;                    // detector state
+    uint8 flags;                    // BLACKBOX_FLAG_*
+} BLACKBOX_RECORD;
+
+typedef struct
+{
+    BLACKBOX_RECORD ring[BLACKBOX_LEN];
+    uint16 head;                    // slot of the next record
+    uint16 count;                   // records in the ring, up to BLACKBOX_LEN
+
+    uint8 mode;                     // BLACKBOX_LIVE ...
+    uint16 postLeft;                // samples still to take after the trigger
+    uint16 start;                   // slot of the first window record
+    uint16 length;                  // records in the window, trigger + 1 + BLACKBOX_POST once frozen
+    uint16 trigger;                 // index of the trigger record in the window
+    uint16 drained;                 // window records the sink has taken
+
+    uint32 events;                  // windows frozen
+    uint32 merged;                  // triggers within the post samples of a window
+    uint32 missed;                  // triggers while a window was frozen
+    uint32 dropped;                 // samples not recorded, the ring was full up to the window
+} BLACKBOX_STATE;
+
+// stored window, ahead of the records in blackboxFlash
+typedef struct
+{
+    uint32 event;                   // BLACKBOX_STATE.events of the window
+    uint32 triggerSeq;              // seq of the trigger record
+    uint16 length;                  // records behind the header, 0 while a copy is in progress
+    uint16 trigger;
+    uint16 reserved;
+    uint16 crc;                     // Crc16 over the header up to here
+} BLACKBOX_HEADER;
+
+/***************************************
+*        Function Prototypes
+****************************************/
+
+// Hardware free, shared with the host tools
+void BlackBox_Init(BLACKBOX_STATE *bb);
+void BlackBox_Record(BLACKBOX_STATE *bb, const IMU_FRAME *frame, const FUSION_OUT *fused, uint8 state, uint8 flags);
+void BlackBox_Trigger(BLACKBOX_STATE *bb);
+uint8 BlackBox_Peek(const BLACKBOX_STATE *bb, const BLACKBOX_RECORD **record);
+void BlackBox_Consume(BLACKBOX_STATE *bb, uint16 records);
+uint16 BlackBox_Pack(uint8 *packet, const BLACKBOX_STATE *bb, const BLACKBOX_RECORD *record);
+
+#if defined(BLACKBOX) && !defined(TELEMETRY) && !defined(HOST_BUILD)
+void BlackBox_Start(void);
+void BlackBox_Store(BLACKBOX_STATE *bb);
+
+extern uint32 blackboxStoreErrors;
+#endif
+
+#endif
+
+/* [] END OF FILE */
@@ -0,0 +1,384 @@
+/* ========================================
+ *
+ * Copyright YOUR COMPANY, THE YEAR
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CONFIDENTIAL AND PROPRIETARY INFORMATION
+ * WHICH IS THE PROPERTY OF your company.
+ *
+ * ========================================
+*/
+
+#include "calib.h"
+#include "crc16.h"
+#include "fusion.h"
+#include "stdlib.h"
+#include <stddef.h>
+
+#if !defined(HOST_BUILD)
+#include "project.h"
+#include "cy_em_eeprom.h"
+#include "timebase.h"
+#endif
+
+#define CALIB_CRC_LEN   ((uint16)offsetof(CALIB_RECORD, crc))
+
+// still period of one device
+typedef struct
+{
+    int16 accMin[3], accMax[3];
+    int16 gyroMin[3], gyroMax[3];
+    int32 accSum[3], gyroSum[3];
+    int16 accRef[3];            // first accel sample of the period
+    uint32 accSq[3];            // sum of (accel - accRef)^2, within CALIB_STILL_ACC so no overflow
+    uint16 count;
+} CALIB_STILL;
+
+// field extremes of one device since the last hard-iron estimate
+typedef struct
+{
+    int16 min[3], max[3];
+    uint8 started;
+} CALIB_MAG;
+
+#if !defined(HOST_BUILD)
+// flash rows behind the emulated EEPROM, zero means empty
+static const uint8 CY_ALIGN(CY_FLASH_SIZEOF_ROW) calibFlash[CY_EM_EEPROM_GET_PHYSICAL_SIZE(sizeof(CALIB_RECORD) * MPU_DEVICE_COUNT, 0u, CALIB_WEAR_LEVELING, 1u)] = { 0u };
+
+/* Global variable declaration */
+    static cy_stc_eeprom_config_t eepromConfig =
+    {
+        .eepromSize = sizeof(CALIB_RECORD) * MPU_DEVICE_COUNT,
+        .simpleMode = 0u,
+        .wearLevelingFactor = CALIB_WEAR_LEVELING,
+        .redundantCopy = 1u,                    // a reset in the middle of a write keeps the old record
+        .blockingWrite = 1u,
+    };                                          // userFlashStartAddr set in Calib_Init
+    static cy_stc_eeprom_context_t eepromContext;
+    static uint8 eepromReady = FALSE;
+#else
+    // host/calib_check: no flash, the records start empty and every save succeeds
+    static const uint8 eepromReady = TRUE;
+#endif
+
+    static CALIB_RECORD stored[MPU_DEVICE_COUNT];   // what is in flash
+    static CALIB_STILL still[MPU_DEVICE_COUNT];
+    static CALIB_MAG magRange[MPU_DEVICE_COUNT];
+    static uint8 saveWanted = FALSE;
+
+    CALIB_RECORD calib[MPU_DEVICE_COUNT];       // in use, one record per device
+    CALIB_STATS calibStats;
+
+static void Seal(CALIB_RECORD *r)
+{
+    r->version = CALIB_VERSION;
+    r->crc = Crc16((const uint8 *)r, CALIB_CRC_LEN);
+}
+
+static void StillStart(CALIB_STILL *s, const IMU_FRAME *raw)
+{
+    for(uint8 i = 0; i < 3u; i++)
+    {
+        s->accMin[i] = s->accMax[i] = raw->accel[i];
+        s->gyroMin[i] = s->gyroMax[i] = raw->gyro[i];
+        s->accSum[i] = raw->accel[i];
+        s->gyroSum[i] = raw->gyro[i];
+        s->accRef[i] = raw->accel[i];
+        s->accSq[i] = 0;
+    }
+    s->count = 1;
+}
+
+static uint8 StillAdd(CALIB_STILL *s, const IMU_FRAME *raw)
+{
+    // FALSE as soon as any axis has moved more than allowed since the still period started
+    for(uint8 i = 0; i < 3u; i++)
+    {
+        int32 d = raw->accel[i] - s->accRef[i];
+
+        if(raw->accel[i] < s->accMin[i]) s->accMin[i] = raw->accel[i];
+        if(raw->accel[i] > s->accMax[i]) s->accMax[i] = raw->accel[i];
+        if(raw->gyro[i] < s->gyroMin[i]) s->gyroMin[i] = raw->gyro[i];
+        if(raw->gyro[i] > s->gyroMax[i]) s->gyroMax[i] = raw->gyro[i];
+
+        if(s->accMax[i] - s->accMin[i] > CALIB_STILL_ACC || s->gyroMax[i] - s->gyroMin[i] > CALIB_STILL_GYRO)
+        {
+            return FALSE;
+        }
+        s->accSum[i] += raw->accel[i];
+        s->gyroSum[i] += raw->gyro[i];
+        s->accSq[i] += (uint32)(d * d);
+    }
+    s->count++;
+
+    return TRUE;
+}
+
+static uint8 StillQuiet(const CALIB_STILL *s)
+{
+    // TRUE when every accel axis has a standard deviation within CALIB_STILL_SD: n*sum(d^2) - sum(d)^2 <= (n*sd)^2
+    for(uint8 i = 0; i < 3u; i++)
+    {
+        int32 sum = s->accSum[i] - (int32)s->count * s->accRef[i];
+        int64 spread = (int64)s->count * s->accSq[i] - (int64)sum * sum;
+        int64 limit = (int64)s->count * s->count * CALIB_STILL_SD * CALIB_STILL_SD;
+
+        if(spread > limit)
+        {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+static int16 Correct(int16 raw, int16 offset)
+{
+    // raw - offset clamped to int16, a reading at full scale stays there instead of wrapping
+    int32 v = (int32)raw - offset;
+
+    return (int16)((v > 32767) ? 32767 : ((v < -32768) ? -32768 : v));
+}
+
+static int16 Mean(int32 sum)
+{
+    // rounded to nearest
+    return (int16)((sum >= 0) ? (sum + (int32)CALIB_SAMPLES / 2) / (int32)CALIB_SAMPLES
+                              : -((-sum + (int32)CALIB_SAMPLES / 2) / (int32)CALIB_SAMPLES));
+}
+
+static void StillDone(uint8 device)
+{
+    // CALIB_SAMPLES still samples, new estimate
+    CALIB_STILL *s = &still[device];
+    CALIB_RECORD *c = &calib[device];
+    uint8 changed = FALSE;
+
+    calibStats.stillPeriods++;
+
+    for(uint8 i = 0; i < 3u; i++)
+    {
+        int16 bias = Mean(s->gyroSum[i]);
+
+        if(c->flags & CALIB_FLAG_GYRO)
+        {
+            int16 step = (int16)((bias - c->gyroOff[i]) >> CALIB_REFINE_SHIFT);
+
+            if(step == 0)
+            {
+                step = (int16)((bias > c->gyroOff[i]) - (bias < c->gyroOff[i]));  // at least one count, or it stalls short
+            }
+            bias = (int16)(c->gyroOff[i] + step);
+        }
+        c->gyroOff[i] = bias;
+
+        if(abs(c->gyroOff[i] - stored[device].gyroOff[i]) >= CALIB_SAVE_DELTA)
+        {
+            changed = TRUE;
+        }
+    }
+    if(!(c->flags & CALIB_FLAG_GYRO))
+    {
+        c->flags |= CALIB_FLAG_GYRO;
+        changed = TRUE;
+    }
+
+    if(!(c->flags & CALIB_FLAG_ACCEL) &&
+       abs(Mean(s->accSum[0])) <= CALIB_ACC_LEVEL && abs(Mean(s->accSum[1])) <= CALIB_ACC_LEVEL &&
+       abs(Mean(s->accSum[2]) - (int32)FUSION_COUNTS_PER_G) <= CALIB_ACC_LEVEL)   // z up, not on its back
+    {
+        c->accOff[0] = Mean(s->accSum[0]);
+        c->accOff[1] = Mean(s->accSum[1]);
+        c->accOff[2] = (int16)(Mean(s->accSum[2]) - (int16)FUSION_COUNTS_PER_G);
+        c->flags |= CALIB_FLAG_ACCEL;
+        changed = TRUE;
+    }
+
+    if(calibStats.state[device] == CALIB_NONE)
+    {
+        calibStats.state[device] = CALIB_MEASURED;
+    }
+    if(changed)
+    {
+        saveWanted = TRUE;
+    }
+}
+
+static void MagAdd(uint8 device, const IMU_FRAME *raw)
+{
+    // hard-iron estimate once the rotation has spanned CALIB_MAG_SPAN on every axis
+    CALIB_MAG *m = &magRange[device];
+    CALIB_RECORD *c = &calib[device];
+    uint8 spanned = TRUE;
+    uint8 changed = FALSE;
+
+    if(!m->started)
+    {
+        for(uint8 i = 0; i < 3u; i++)
+        {
+            m->min[i] = m->max[i] = raw->mag[i];
+        }
+        m->started = TRUE;
+        return;
+    }
+
+    for(uint8 i = 0; i < 3u; i++)
+    {
+        if(raw->mag[i] < m->min[i]) m->min[i] = raw->mag[i];
+        if(raw->mag[i] > m->max[i]) m->max[i] = raw->mag[i];
+        if(m->max[i] - m->min[i] < CALIB_MAG_SPAN)
+        {
+            spanned = FALSE;
+        }
+    }
+    if(!spanned)
+    {
+        return;
+    }
+
+    calibStats.magSpheres++;
+    for(uint8 i = 0; i < 3u; i++)
+    {
+        c->magOff[i] = (int16)(((int32)m->min[i] + m->max[i]) / 2);
+        if(abs(c->magOff[i] - stored[device].magOff[i]) >= CALIB_MAG_SAVE_DELTA)
+        {
+            changed = TRUE;
+        }
+    }
+    if(!(c->flags & CALIB_FLAG_MAG))
+    {
+        c->flags |= CALIB_FLAG_MAG;
+        changed = TRUE;
+    }
+    if(changed)
+    {
+        saveWanted = TRUE;
+    }
+    m->started = FALSE;
+}
+
+void Calib_Init(void)
+{
+    CALIB_RECORD records[MPU_DEVICE_COUNT];
+    uint8 loaded;
+#if !defined(HOST_BUILD)
+    uint32 start = Timebase_Now();
+
+    eepromConfig.userFlashStartAddr = (uint32)calibFlash;
+    eepromReady = (Cy_Em_EEPROM_Init(&eepromConfig, &eepromContext) == CY_EM_EEPROM_SUCCESS);
+    loaded = eepromReady && (Cy_Em_EEPROM_Read(0u, records, sizeof(records), &eepromContext) == CY_EM_EEPROM_SUCCESS);
+#else
+    loaded = FALSE;
+#endif
+
+    for(uint8 d = 0; d < MPU_DEVICE_COUNT; d++)
+    {
+        CALIB_RECORD *c = &calib[d];
+
+        if(loaded && records[d].version == CALIB_VERSION &&
+           records[d].crc == Crc16((const uint8 *)&records[d], CALIB_CRC_LEN))
+        {
+            *c = records[d];
+            calibStats.state[d] = CALIB_LOADED;
+        }
+        else
+        {
+            for(uint8 i = 0; i < 3u; i++)
+            {
+                c->accOff[i] = 0;
+                c->gyroOff[i] = 0;
+                c->magOff[i] = 0;
+            }
+            c->flags = 0;
+            Seal(c);
+            calibStats.state[d] = CALIB_NONE;
+        }
+        stored[d] = *c;
+        still[d].count = 0;
+        magRange[d].started = FALSE;
+    }
+    saveWanted = FALSE;
+
+#if !defined(HOST_BUILD)
+    calibStats.loadTicks = Timebase_Now() - start;
+#endif
+}
+
+uint8 Calib_Update(uint8 device, IMU_FRAME *frame)
+{
+    /*
+        Once per sample and device from the main loop, before the fusion.
+        Refines the estimate with the raw sample, then subtracts the offsets
+        in place. The correction can move a clipped axis off full scale, so the
+        saturation is decided on the raw sample and kept in frame->saturated.
+        Returns TRUE when the records should be written (Calib_Save).
+    */
+
+    CALIB_STILL *s = &still[device];
+    const CALIB_RECORD *c = &calib[device];
+
+    if(s->count == 0u || !StillAdd(s, frame))
+    {
+        StillStart(s, frame);           // moved, the still period starts again from this sample
+    }
+    else if(s->count >= CALIB_SAMPLES)
+    {
+        if(StillQuiet(s))
+        {
+            StillDone(device);
+        }
+        else
+        {
+            calibStats.noisyPeriods++;  // vibration, no estimate from this period
+        }
+        s->count = 0;
+    }
+    if(frame->magValid)
+    {
+        MagAdd(device, frame);
+    }
+
+    frame->saturated = FALSE;
+    for(uint8 i = 0; i < 3u; i++)
+    {
+        if(abs(frame->accel[i]) >= IMU_FULL_SCALE || abs(frame->gyro[i]) >= IMU_FULL_SCALE)
+        {
+            frame->saturated = TRUE;
+        }
+        frame->accel[i] = Correct(frame->accel[i], c->accOff[i]);
+        frame->gyro[i] = Correct(frame->gyro[i], c->gyroOff[i]);
+        frame->mag[i] = frame->magValid ? Correct(frame->mag[i], c->magOff[i]) : 0;
+    }
+
+    return saveWanted;
+}
+
+void Calib_Save(void)
+{
+    // blocking flash write of all devices, main loop only and never while the actuator is pending
+    saveWanted = FALSE;
+    for(uint8 d = 0; d < MPU_DEVICE_COUNT; d++)
+    {
+        Seal(&calib[d]);
+    }
+
+#if !defined(HOST_BUILD)
+    if(eepromReady && Cy_Em_EEPROM_Write(0u, calib, sizeof(calib), &eepromContext) == CY_EM_EEPROM_SUCCESS)
+#else
+    if(eepromReady)
+#endif
+    {
+        for(uint8 d = 0; d < MPU_DEVICE_COUNT; d++)
+        {
+            stored[d] = calib[d];
+        }
+        calibStats.saves++;
+    }
+    else
+    {
+        calibStats.saveErrors++;
+    }
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,122 @@
+/* ========================================
+ *
+ * Copyright YOUR COMPANY, THE YEAR
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CONFIDENTIAL AND PROPRIETARY INFORMATION
+ * WHICH IS THE PROPERTY OF your company.
+ *
+ * ========================================
+*/
+
+/*
+    Accel offset, gyro bias and magnetometer hard-iron offset per MPU
+    (MPU_DEVICE_COUNT), kept in emulated EEPROM (cy_em_eeprom).
+
+    Calib_Init reads the stored records. With the right version and CRC the
+    offsets apply from the first sample (calibStats.loadTicks has the time
+    the read took). Otherwise the first still period measures them:
+    CALIB_SAMPLES samples in a row with every axis within CALIB_STILL_ACC and
+    CALIB_STILL_GYRO (max - min), and an accel standard deviation below
+    CALIB_STILL_SD on every axis. The max - min limits only catch motion, the
+    accel noise alone (~40 counts rms) spans ~220 counts over a period. The
+    standard deviation rejects vibration that stays within them.
+    host/calib_check feeds noisy traces through it.
+
+    The gyro bias is the mean over the still period. It is refined the same
+    way during every later still period, moving 1/2^CALIB_REFINE_SHIFT of the
+    way to the new mean, and saved again once it has drifted
+    CALIB_SAVE_DELTA counts from the stored value.
+
+    The accel offsets can not be told apart from tilt with the device in one
+    orientation. They are measured only once, on the first still period with
+    x and y within CALIB_ACC_LEVEL of 0 and z within CALIB_ACC_LEVEL of 1 g,
+    assuming the device then rests on its base. Upside down z reads -1 g and
+    no offsets are taken. Never refined online. Erase the record to measure
+    again.
+
+    The magnetometer hard-iron offset (MAGNETOMETER) is the centre of the
+    field sphere: per axis (min + max) / 2 over a rotation that spans at least
+    CALIB_MAG_SPAN counts on every axis. Then min/max start over, so the offset
+    follows a changed mounting. It is saved once it has moved
+    CALIB_MAG_SAVE_DELTA counts. Soft-iron (sphere squashed to an ellipsoid) is
+    not corrected, only the heading accuracy suffers from it.
+
+    Calib_Update takes the raw sample and corrects it in place. Writing the
+    flash blocks for a few ms, so it only asks for it and the main loop calls
+    Calib_Save when the ring is empty.
+*/
+
+#if !defined(CALIB_H)
+#define CALIB_H
+
+#include "imu_types.h"
+#include "main.h"
+
+/***************************************
+*            Constants
+****************************************/
+
+#define CALIB_VERSION           (2u)        // bump when CALIB_RECORD changes
+#define CALIB_SAMPLES           (200u)      // 2 s at 100 Hz per estimate
+#define CALIB_STILL_ACC         (MPU_ACCEL_LSB_PER_G / 20)  // 0.05 g max - min in accel counts, as POWER_STILL_ACC
+#define CALIB_STILL_SD          ((MPU_ACCEL_LSB_PER_G + 50) / 100)  // 0.01 g accel standard deviation over the period
+#define CALIB_STILL_GYRO        ((int16)(GYROSCOPE_SENSITIVITY + 0.5))  // 1 dps in gyro counts
+#define CALIB_ACC_LEVEL         (MPU_ACCEL_LSB_PER_G / 20)  // x, y and z - 1 g within 0.05 g to measure the accel offsets
+#define CALIB_REFINE_SHIFT      (2u)
+#define CALIB_SAVE_DELTA        (3)         // gyro counts
+#define CALIB_WEAR_LEVELING     (2u)        // copies of the record in flash, em_eeprom wear leveling
+#define CALIB_MAG_SPAN          (400)       // 60 uT, the earth field is 25-65 uT so about a half turn on every axis
+#define CALIB_MAG_SAVE_DELTA    (10)        // 1.5 uT
+
+// record flags
+#define CALIB_FLAG_ACCEL        (0x0001u)   // accOff measured
+#define CALIB_FLAG_GYRO         (0x0002u)   // gyroOff measured
+#define CALIB_FLAG_MAG          (0x0004u)   // magOff measured
+
+// calibStats.state
+#define CALIB_NONE              (0u)        // nothing stored, raw samples until the first still period
+#define CALIB_LOADED            (1u)        // record from flash
+#define CALIB_MEASURED          (2u)        // measured since boot
+
+/***************************************
+*            Types
+****************************************/
+
+// Stored as is, only 16 bit members so there is no padding
+typedef struct
+{
+    uint16 version;             // CALIB_VERSION
+    uint16 flags;               // CALIB_FLAG_*
+    int16 accOff[3];            // subtracted from the accel, raw counts
+    int16 gyroOff[3];           // subtracted from the gyro, raw counts
+    int16 magOff[3];            // subtracted from the magnetometer, hard-iron
+    uint16 crc;                 // Crc16 over the members above
+} CALIB_RECORD;
+
+typedef struct
+{
+    uint8 state[MPU_DEVICE_COUNT];  // CALIB_NONE/LOADED/MEASURED
+    uint32 loadTicks;           // Timebase cycles Calib_Init spent reading the records
+    uint32 stillPeriods;        // CALIB_SAMPLES still samples in a row
+    uint32 noisyPeriods;        // within the max - min limits but rejected on CALIB_STILL_SD
+    uint32 magSpheres;          // hard-iron estimates, rotations that spanned CALIB_MAG_SPAN
+    uint32 saves;
+    uint32 saveErrors;          // em_eeprom write failures
+} CALIB_STATS;
+
+/***************************************
+*        Function Prototypes
+****************************************/
+
+void Calib_Init(void);
+uint8 Calib_Update(uint8 device, IMU_FRAME *frame);
+void Calib_Save(void);
+
+extern CALIB_RECORD calib[MPU_DEVICE_COUNT];
+extern CALIB_STATS calibStats;
+
+#endif
+
+/* [] END OF FILE */
@@ -0,0 +1,35 @@
+/* ========================================
+ *
+ * Copyright YOUR COMPANY, THE YEAR
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CONFIDENTIAL AND PROPRIETARY INFORMATION
+ * WHICH IS THE PROPERTY OF your company.
+ *
+ * ========================================
+*/
+
+#include "crc16.h"
+
+// one nibble per lookup, 32 bytes of table instead of 512
+static const uint16 crcNibble[16] =
+{
+    0x0000u, 0x1021u, 0x2042u, 0x3063u, 0x4084u, 0x50A5u, 0x60C6u, 0x70E7u,
+    0x8108u, 0x9129u, 0xA14Au, 0xB16Bu, 0xC18Cu, 0xD1ADu, 0xE1CEu, 0xF1EFu
+};
+
+uint16 Crc16(const uint8 *data, uint16 len)
+{
+    uint16 crc = 0xFFFFu;
+
+    for(uint16 i = 0; i < len; i++)
+    {
+        crc = (uint16)((crc << 4) ^ crcNibble[(crc >> 12) ^ (data[i] >> 4)]);
+        crc = (uint16)((crc << 4) ^ crcNibble[(crc >> 12) ^ (data[i] & 0x0Fu)]);
+    }
+
+    return crc;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,32 @@
+/* ========================================
+ *
+ * Copyright YOUR COMPANY, THE YEAR
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CONFIDENTIAL AND PROPRIETARY INFORMATION
+ * WHICH IS THE PROPERTY OF your company.
+ *
+ * ========================================
+*/
+
+/*
+    CRC-16/CCITT-FALSE (polynomial 0x1021, init 0xFFFF, no reflection, check
+    value 0x29B1 for "123456789"), used for the telemetry packets and the
+    calibration record.
+*/
+
+#if !defined(CRC16_H)
+#define CRC16_H
+
+#include "imu_types.h"
+
+/***************************************
+*        Function Prototypes
+****************************************/
+
+uint16 Crc16(const uint8 *data, uint16 len);
+
+#endif
+
+/* [] END OF FILE */
@@ -16,6 +16,10 @@
     /*Define your macro callbacks here */
     /*For more information, refer to the Writing Code topic in the PSoC Creator Help.*/
 
+    // I2C transfer engine steps its request queue at the end of the Master ISR (i2c_engine.c)
+    #define Master_ISR_EXIT_CALLBACK
+    void Master_ISR_ExitCallback(void);
+
     
 #endif /* CYAPICALLBACKS_H */   
 /* [] */
@@ -0,0 +1,133 @@
+/* ========================================
+ *
+ * Copyright YOUR COMPANY, THE YEAR
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CONFIDENTIAL AND PROPRIETARY INFORMATION
+ * WHICH IS THE PROPERTY OF your company.
+ *
+ * ========================================
+*/
+
+#include "deferred.h"
+#include "main.h"
+#include "timebase.h"
+
+#define DEFERRED_TICK_CALLBACK  (0u)    // SysTick callback slot used by this module
+
+static void Tick(void);
+
+/* Global variable declaration */
+    static DEFERRED_ACTION *slots[DEFERRED_SLOTS];
+
+    volatile uint32 deferredLateMax = 0;    // worst lateness of an action, Timebase cycles
+    volatile uint32 deferredRejected = 0;   // Deferred_Schedule calls with no free slot
+
+void Deferred_Init(void)
+{
+    for(uint8 i = 0; i < DEFERRED_SLOTS; i++)
+    {
+        slots[i] = NULL;
+    }
+
+    CySysTickStart();                                           // 1 ms interrupt
+    (void) CySysTickSetCallback(DEFERRED_TICK_CALLBACK, Tick);
+}
+
+uint8 Deferred_Schedule(DEFERRED_ACTION *action, uint32 delayMs)
+{
+    /*
+        Runs action->callback delayMs from now. Rescheduling a pending action
+        moves its deadline. Returns FALSE if all slots are in use.
+    */
+
+    uint8 result = FALSE;
+    uint8 free = DEFERRED_SLOTS;
+    uint8 intState;
+
+    if(delayMs > DEFERRED_MAX_DELAY_MS)
+    {
+        delayMs = DEFERRED_MAX_DELAY_MS;
+    }
+
+    intState = CyEnterCriticalSection();
+
+    for(uint8 i = 0; i < DEFERRED_SLOTS; i++)
+    {
+        if(slots[i] == action)
+        {
+            free = i;                   // already pending, reuse its slot
+            break;
+        }
+        if(slots[i] == NULL && free == DEFERRED_SLOTS)
+        {
+            free = i;
+        }
+    }
+
+    if(free < DEFERRED_SLOTS)
+    {
+        action->due = Timebase_Now() + TIMEBASE_TICKS(delayMs * 1000u);
+        action->pending = TRUE;
+        slots[free] = action;
+        result = TRUE;
+    }
+    else
+    {
+        deferredRejected++;
+    }
+
+    CyExitCriticalSection(intState);
+
+    return result;
+}
+
+uint8 Deferred_Cancel(DEFERRED_ACTION *action)
+{
+    // Returns TRUE if the action was still pending, FALSE if it already ran or was never scheduled
+    uint8 result = FALSE;
+    uint8 intState = CyEnterCriticalSection();
+
+    for(uint8 i = 0; i < DEFERRED_SLOTS; i++)
+    {
+        if(slots[i] == action)
+        {
+            slots[i] = NULL;
+            action->pending = FALSE;
+            result = TRUE;
+        }
+    }
+
+    CyExitCriticalSection(intState);
+
+    return result;
+}
+
+static void Tick(void)
+{
+    // SysTick interrupt, every 1 ms
+    uint32 now = Timebase_Now();
+
+    for(uint8 i = 0; i < DEFERRED_SLOTS; i++)
+    {
+        DEFERRED_ACTION *action = slots[i];
+
+        if(action != NULL && (int32)(now - action->due) >= 0)
+        {
+            slots[i] = NULL;
+            action->pending = FALSE;
+
+            if(now - action->due > deferredLateMax)
+            {
+                deferredLateMax = now - action->due;
+            }
+            if(action->callback != NULL)
+            {
+                action->callback(action);
+            }
+        }
+    }
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,66 @@
+/* ========================================
+ *
+ * Copyright YOUR COMPANY, THE YEAR
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CONFIDENTIAL AND PROPRIETARY INFORMATION
+ * WHICH IS THE PROPERTY OF your company.
+ *
+ * ========================================
+*/
+
+/*
+    Deferred actions, run from the SysTick interrupt at a deadline.
+
+    Callers own a DEFERRED_ACTION, schedule it with a delay and may cancel it
+    until it has run. SysTick interrupts every 1 ms. Deadlines are kept in
+    Timebase cycles, so an action runs at the first tick on or after its
+    deadline: never early, at most 1 ms late. The lateness is kept in
+    deferredLateMax for checking.
+
+    Actions run in interrupt context and must be short (a pin write, setting a
+    flag).
+*/
+
+#if !defined(DEFERRED_H)
+#define DEFERRED_H
+
+#include "project.h"
+
+/***************************************
+*            Constants
+****************************************/
+
+#define DEFERRED_SLOTS          (4u)        // actions that can be pending at once
+#define DEFERRED_MAX_DELAY_MS   (20000u)    // deadlines are signed cycle differences, < 2^31 cycles at 80 MHz
+
+/***************************************
+*            Types
+****************************************/
+
+typedef struct DEFERRED_ACTION DEFERRED_ACTION;
+typedef void (*DEFERRED_CALLBACK)(DEFERRED_ACTION *action);
+
+struct DEFERRED_ACTION
+{
+    DEFERRED_CALLBACK callback;     // called in the SysTick interrupt at the deadline
+    void *context;                  // free for the owner of the action
+    uint32 due;                     // deadline in Timebase cycles, written by Deferred_Schedule
+    volatile uint8 pending;         // TRUE from Deferred_Schedule until run or cancelled
+};
+
+/***************************************
+*        Function Prototypes
+****************************************/
+
+void Deferred_Init(void);
+uint8 Deferred_Schedule(DEFERRED_ACTION *action, uint32 delayMs);
+uint8 Deferred_Cancel(DEFERRED_ACTION *action);
+
+extern volatile uint32 deferredLateMax;
+extern volatile uint32 deferredRejected;
+
+#endif
+
+/* [] END OF FILE */
@@ -0,0 +1,216 @@
+/* ========================================
+ *
+ * Copyright YOUR COMPANY, THE YEAR
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CONFIDENTIAL AND PROPRIETARY INFORMATION
+ * WHICH IS THE PROPERTY OF your company.
+ *
+ * ========================================
+*/
+
+#include "detect.h"
+
+#if (DETECT_LOG_LEN & (DETECT_LOG_LEN - 1u)) != 0u
+    #error "DETECT_LOG_LEN must be a power of two"
+#endif
+
+static void Enter(DETECT_STATE *state, uint8 to)
+{
+    DETECT_TRANSITION *t = &state->log[state->transitions & (DETECT_LOG_LEN - 1u)];
+
+    t->timeMs = state->nowMs;
+    t->from = state->state;
+    t->to = to;
+    state->transitions++;
+
+    state->state = to;
+    state->enteredMs = state->nowMs;
+    state->dwellMs = 0;
+
+    if(to == DETECT_ONSET)
+    {
+        state->onsetMs = state->nowMs;  // FREEFALL keeps it, the fall time runs on
+    }
+}
+
+static uint32 Held(const DETECT_STATE *state)
+{
+    // time in the current state including this sample
+    return state->nowMs - state->enteredMs + DETECT_FRAME_MS;
+}
+
+static uint8 Upright(const FUSION_OUT *fused)
+{
+    return (fused->rollLim < DETECT_ANGLE_LIMIT && fused->pitchLim < DETECT_ANGLE_LIMIT) ? TRUE : FALSE;
+}
+
+static uint8 Tilted(const FUSION_OUT *fused)
+{
+    return (fused->rollLim > DETECT_ANGLE_LIMIT + DETECT_ANGLE_HYST ||
+            fused->pitchLim > DETECT_ANGLE_LIMIT + DETECT_ANGLE_HYST) ? TRUE : FALSE;
+}
+
+static uint8 Still(const FUSION_OUT *fused)
+{
+    int32 offset = fused->accMean - (int32)MPU_ACCEL_LSB_PER_G;
+
+    return (fused->accVar <= DETECT_STILL_VAR && offset <= DETECT_STILL_MEAN && offset >= -DETECT_STILL_MEAN) ? TRUE : FALSE;
+}
+
+static uint8 Clear(DETECT_STATE *state)
+{
+    return state->actuator ? DETECT_CLEAR : DETECT_HOLD;
+}
+
+void Detect_Init(DETECT_STATE *state)
+{
+    state->actuator = FALSE;
+    state->fires = 0;
+    state->onsetMs = 0;
+    state->fireDelayMs = 0;
+
+    state->state = DETECT_IDLE;
+    state->nowMs = 0;
+    state->enteredMs = 0;
+    state->dwellMs = 0;
+
+    state->falseOnsets = 0;
+    state->falls = 0;
+    state->impacts = 0;
+    state->inactive = 0;
+
+    state->transitions = 0;
+    for(uint8 i = 0; i < DETECT_LOG_LEN; i++)
+    {
+        state->log[i].timeMs = 0;
+        state->log[i].from = DETECT_IDLE;
+        state->log[i].to = DETECT_IDLE;
+    }
+}
+
+uint8 Detect_Update(DETECT_STATE *state, const FUSION_OUT *fused)
+{
+    uint8 decision = DETECT_HOLD;
+    uint8 falling = (fused->accNow < DETECT_FALL_ACC) ? TRUE : FALSE;
+
+    switch(state->state)
+    {
+        case DETECT_IDLE:
+            if(falling)
+            {
+                Enter(state, DETECT_ONSET);
+            }
+            break;
+
+        case DETECT_ONSET:
+            if(fused->accNow > DETECT_FALL_EXIT_ACC)
+            {
+                state->falseOnsets++;
+                Enter(state, DETECT_IDLE);
+            }
+            else if(Held(state) >= DETECT_CONFIRM_MS)
+            {
+                state->falls++;
+                Enter(state, DETECT_FREEFALL);
+            }
+            break;
+
+        case DETECT_FREEFALL:
+            if(fused->accNow >= DETECT_IMPACT_ACC)
+            {
+                state->impacts++;
+                decision = Clear(state);
+                Enter(state, DETECT_IMPACT);
+            }
+            else if(fused->accNow > DETECT_FALL_EXIT_ACC)
+            {
+                state->dwellMs += DETECT_FRAME_MS;
+                if(state->dwellMs >= DETECT_RECOVER_MS)
+                {
+                    decision = Clear(state);
+                    Enter(state, DETECT_IDLE);
+                }
+            }
+            else
+            {
+                state->dwellMs = 0;
+            }
+            break;
+
+        case DETECT_IMPACT:
+            if(fused->accMax >= DETECT_SETTLE_ACC)
+            {
+                state->dwellMs = 0;             // still ringing
+            }
+            else if(falling)
+            {
+                Enter(state, DETECT_ONSET);
+            }
+            else if(Still(fused))
+            {
+                state->dwellMs += DETECT_FRAME_MS;
+                if(state->dwellMs >= DETECT_INACTIVE_MS)
+                {
+                    state->inactive++;
+                    Enter(state, DETECT_INACTIVE);
+                }
+            }
+            else
+            {
+                state->dwellMs = 0;
+            }
+            if(state->state == DETECT_IMPACT && Held(state) >= DETECT_POSTFALL_MS)
+            {
+                Enter(state, DETECT_IDLE);      // moved on after the impact
+            }
+            break;
+
+        case DETECT_INACTIVE:
+            if(falling)
+            {
+                Enter(state, DETECT_ONSET);
+            }
+            else if(fused->accVar > DETECT_MOVE_VAR)
+            {
+                Enter(state, DETECT_IDLE);
+            }
+            break;
+
+        default:
+            Enter(state, DETECT_IDLE);
+            break;
+    }
+
+    // actuator while in free fall, with the angle hysteresis
+    if(state->state == DETECT_FREEFALL && state->dwellMs == 0u)
+    {
+        if(!state->actuator && Upright(fused))
+        {
+            decision = DETECT_FIRE;
+            state->fires++;
+            state->fireDelayMs = Impact_FireDelayMs(state->nowMs - state->onsetMs + DETECT_FRAME_MS);
+        }
+        else if(state->actuator && Tilted(fused))
+        {
+            decision = DETECT_CLEAR;
+        }
+    }
+    if(decision != DETECT_HOLD)
+    {
+        state->actuator = (decision == DETECT_FIRE);
+    }
+
+    state->nowMs += DETECT_FRAME_MS;
+
+    return decision;
+}
+
+void Detect_Skip(DETECT_STATE *state)
+{
+    // a sample period without a sample: the state and the actuator stay as they are
+    state->nowMs += DETECT_FRAME_MS;
+}
+
+/* [] END OF FILE */
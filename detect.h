@@ -0,0 +1,140 @@
+/* ========================================
+ *
+ * Copyright YOUR COMPANY, THE YEAR
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CONFIDENTIAL AND PROPRIETARY INFORMATION
+ * WHICH IS THE PROPERTY OF your company.
+ *
+ * ========================================
+*/
+
+/*
+    Free-fall decision on top of the fusion output. Hardware free, the main loop
+    (or the host replay tool) turns the decision into actuator calls.
+
+    A state machine over the |a| signals of FUSION_OUT, constant time per
+    sample:
+
+        IDLE        --|a| < DETECT_FALL_ACC-->                  ONSET
+        ONSET       --held DETECT_CONFIRM_MS-->                 FREEFALL
+                    --|a| > DETECT_FALL_EXIT_ACC-->             IDLE (false onset)
+        FREEFALL    --|a| >= DETECT_IMPACT_ACC-->               IMPACT
+                    --|a| > DETECT_FALL_EXIT_ACC for
+                      DETECT_RECOVER_MS-->                      IDLE (fall arrested)
+        IMPACT      --settled, still for DETECT_INACTIVE_MS-->  INACTIVE
+                    --not still within DETECT_POSTFALL_MS-->    IDLE
+        INACTIVE    --accVar > DETECT_MOVE_VAR-->               IDLE
+
+    IMPACT and INACTIVE go to ONSET directly on a new fall. Every threshold
+    has a separate enter and leave level, so a signal sitting on one does not
+    make the state flap.
+
+    The actuator is switched on (DETECT_FIRE) in FREEFALL while rollLim and
+    pitchLim are both below DETECT_ANGLE_LIMIT, and switched off again
+    (DETECT_CLEAR) when one of them rises above DETECT_ANGLE_LIMIT +
+    DETECT_ANGLE_HYST or the fall ends. Otherwise the decision is DETECT_HOLD.
+
+    When a DETECT_FIRE switches the actuator on, fireDelayMs is set from the
+    time to impact (impact.h) for the free fall seen so far. The fall is
+    counted from the first sample of ONSET, rounded up to a whole sample so
+    the estimate errs towards firing early, and goes on through ONSET and
+    FREEFALL: a noisy sample between DETECT_FALL_ACC and DETECT_FALL_EXIT_ACC
+    does not end the fall, so it must not restart the count either.
+
+    Time is the sample clock, DETECT_FRAME_MS per Detect_Update. A round
+    without a usable sample is passed to Detect_Skip instead, it advances the
+    clock and decides nothing, so the time in a state stays real time. The last
+    DETECT_LOG_LEN transitions are kept in log with their time, the counters
+    summarize the rest.
+*/
+
+#if !defined(DETECT_H)
+#define DETECT_H
+
+#include "fusion.h"
+#include "impact.h"
+
+/***************************************
+*            Constants
+****************************************/
+
+#define DETECT_FRAME_MS     (10u)   // one sample at 100 Hz
+
+// |a| levels in accel counts (accNow, accMean, accMax), accVar in counts^2
+#define DETECT_FALL_ACC         (MPU_ACCEL_LSB_PER_G * 3 / 10)  // 0.3 g, below is falling. Also the impact estimate
+#define DETECT_FALL_EXIT_ACC    (MPU_ACCEL_LSB_PER_G / 2)       // 0.5 g, above ends the onset or the fall
+#define DETECT_IMPACT_ACC       (MPU_ACCEL_LSB_PER_G * 3 / 2)   // 1.5 g, a fall ending above this hit something
+#define DETECT_SETTLE_ACC       (MPU_ACCEL_LSB_PER_G * 6 / 5)   // 1.2 g, window accMax below: the impact has rung out
+#define DETECT_STILL_MEAN       (MPU_ACCEL_LSB_PER_G / 10)      // accMean within 0.1 g of 1 g ...
+#define DETECT_STILL_VAR        ((uint32)(MPU_ACCEL_LSB_PER_G / 50) * (MPU_ACCEL_LSB_PER_G / 50))   // ... and sd below 0.02 g is lying still
+#define DETECT_MOVE_VAR         ((uint32)(MPU_ACCEL_LSB_PER_G / 20) * (MPU_ACCEL_LSB_PER_G / 20))   // sd above 0.05 g is moving again
+
+#define DETECT_ANGLE_LIMIT  (85)    // deg, rollLim and pitchLim must both be below to fire
+#define DETECT_ANGLE_HYST   (5)     // deg, a fired actuator is cleared above DETECT_ANGLE_LIMIT + this
+
+// Dwell times, ms
+#define DETECT_CONFIRM_MS   (50u)   // onset to confirmed free fall
+#define DETECT_RECOVER_MS   (30u)   // back above DETECT_FALL_EXIT_ACC without impact
+#define DETECT_INACTIVE_MS  (2000u) // still after the impact
+#define DETECT_POSTFALL_MS  (10000u)    // longest wait for the stillness after an impact
+
+#define DETECT_LOG_LEN      (8u)    // transitions kept, power of two
+
+// States
+#define DETECT_IDLE         (0u)
+#define DETECT_ONSET        (1u)    // |a| dropped, not confirmed yet
+#define DETECT_FREEFALL     (2u)    // confirmed free fall, the actuator may be on
+#define DETECT_IMPACT       (3u)    // the fall ended in a hit, waiting for stillness
+#define DETECT_INACTIVE     (4u)    // lying still after the impact
+#define DETECT_STATES       (5u)
+
+// Decisions
+#define DETECT_HOLD         (0u)    // leave the actuator as it is
+#define DETECT_FIRE         (1u)    // free fall in the right orientation, actuator on
+#define DETECT_CLEAR        (2u)    // actuator off
+
+/***************************************
+*            Types
+****************************************/
+
+typedef struct
+{
+    uint32 timeMs;                  // sample clock of the first sample in the new state
+    uint8 from;
+    uint8 to;
+} DETECT_TRANSITION;
+
+typedef struct
+{
+    uint8 actuator;                 // TRUE between a DETECT_FIRE and the next DETECT_CLEAR
+    uint32 fires;                   // DETECT_FIRE decisions
+    uint32 onsetMs;                 // nowMs of the first sample of the current or last fall
+    uint32 fireDelayMs;             // from the last DETECT_FIRE to switching the actuator on (impact.h)
+
+    uint8 state;                    // DETECT_IDLE ...
+    uint32 nowMs;                   // sample clock, start of the current sample
+    uint32 enteredMs;               // nowMs of the first sample in the current state
+    uint32 dwellMs;                 // how long the leave condition of the state has held
+
+    uint32 falseOnsets;             // ONSET back to IDLE
+    uint32 falls;                   // confirmed free falls
+    uint32 impacts;                 // falls that ended in an impact
+    uint32 inactive;                // impacts followed by stillness
+
+    uint32 transitions;             // total, the last DETECT_LOG_LEN are in log
+    DETECT_TRANSITION log[DETECT_LOG_LEN];
+} DETECT_STATE;
+
+/***************************************
+*        Function Prototypes
+****************************************/
+
+void Detect_Init(DETECT_STATE *state);
+uint8 Detect_Update(DETECT_STATE *state, const FUSION_OUT *fused);
+void Detect_Skip(DETECT_STATE *state);
+
+#endif
+
+/* [] END OF FILE */
@@ -0,0 +1,122 @@
+/* ========================================
+ *
+ * Copyright YOUR COMPANY, THE YEAR
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CONFIDENTIAL AND PROPRIETARY INFORMATION
+ * WHICH IS THE PROPERTY OF your company.
+ *
+ * ========================================
+*/
+
+#include "fastmath.h"
+
+#define FM_PI           (3.14159265f)
+#define FM_HALF_PI      (1.57079633f)
+#define FM_RSQRT_MAGIC  (0x5F375A86uL)  // seed of 1/sqrt from the float bit pattern (Lomont)
+
+// Odd polynomial for atan(z), z in [0,1] (Abramowitz & Stegun 4.4.47), max error 1e-5 rad
+#define ATAN_A1         (0.9998660f)
+#define ATAN_A3         (-0.3302995f)
+#define ATAN_A5         (0.1801410f)
+#define ATAN_A7         (-0.0851330f)
+#define ATAN_A9         (0.0208351f)
+
+// asin(x) = pi/2 - sqrt(1 - x) * P(x), x in [0,1] (Abramowitz & Stegun 4.4.46), max error 2e-8 rad
+#define ASIN_A0         (1.5707963050f)
+#define ASIN_A1         (-0.2145988016f)
+#define ASIN_A2         (0.0889789874f)
+#define ASIN_A3         (-0.0501743046f)
+#define ASIN_A4         (0.0308918810f)
+#define ASIN_A5         (-0.0170881256f)
+#define ASIN_A6         (0.0066700901f)
+#define ASIN_A7         (-0.0012624911f)
+
+float FastMath_InvSqrt(float x)
+{
+    // 1/sqrt(x) for x > 0, no divide
+    union { float f; uint32 i; } u;
+    float half = 0.5f * x;
+
+    u.f = x;
+    u.i = FM_RSQRT_MAGIC - (u.i >> 1);
+    u.f *= 1.5f - half * u.f * u.f;
+    u.f *= 1.5f - half * u.f * u.f;
+
+    return u.f;
+}
+
+float FastMath_Sqrt(float x)
+{
+    // sqrt(x), 0 for x <= 0. The Newton correction on the root brings it to float precision
+    float y, r;
+
+    if(x <= 0.0f)
+    {
+        return 0.0f;
+    }
+
+    y = FastMath_InvSqrt(x);
+    r = x * y;
+
+    return r + 0.5f * y * (x - r * r);
+}
+
+float FastMath_Atan2(float y, float x)
+{
+    // atan2 in rad, [-pi, pi]. Reduced to z = min/max in [0,1], one divide
+    float ax = (x < 0.0f) ? -x : x;
+    float ay = (y < 0.0f) ? -y : y;
+    float z, z2, angle;
+
+    if(ax == 0.0f && ay == 0.0f)
+    {
+        return 0.0f;
+    }
+
+    z = (ax >= ay) ? ay / ax : ax / ay;
+    z2 = z * z;
+    angle = z * (ATAN_A1 + z2 * (ATAN_A3 + z2 * (ATAN_A5 + z2 * (ATAN_A7 + z2 * ATAN_A9))));
+
+    if(ay > ax)
+    {
+        angle = FM_HALF_PI - angle;
+    }
+    if(x < 0.0f)
+    {
+        angle = FM_PI - angle;
+    }
+    if(y < 0.0f)
+    {
+        angle = -angle;
+    }
+
+    return angle;
+}
+
+float FastMath_Asin(float x)
+{
+    // asin in rad, input clamped to [-1, 1]
+    float ax = (x < 0.0f) ? -x : x;
+    float p, angle;
+
+    if(ax > 1.0f)
+    {
+        ax = 1.0f;
+    }
+
+    p = ASIN_A7;
+    p = ASIN_A6 + p * ax;
+    p = ASIN_A5 + p * ax;
+    p = ASIN_A4 + p * ax;
+    p = ASIN_A3 + p * ax;
+    p = ASIN_A2 + p * ax;
+    p = ASIN_A1 + p * ax;
+    p = ASIN_A0 + p * ax;
+    angle = FM_HALF_PI - FastMath_Sqrt(1.0f - ax) * p;
+
+    return (x < 0.0f) ? -angle : angle;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,64 @@
+/* ========================================
+ *
+ * Copyright YOUR COMPANY, THE YEAR
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CONFIDENTIAL AND PROPRIETARY INFORMATION
+ * WHICH IS THE PROPERTY OF your company.
+ *
+ * ========================================
+*/
+
+/*
+    Float kernels for the orientation path, replacing the newlib-nano soft-float
+    sqrt, atan2 and asin. The M3 has no FPU, so a libm call costs thousands of
+    cycles; these need a handful of soft-float multiplies and at most one
+    divide. Error bounds over the whole input range, measured against double
+    libm with host/bench_math:
+
+        FastMath_InvSqrt    relative 4.7e-6     magic seed and two Newton steps
+        FastMath_Sqrt       relative 8.9e-8     x * InvSqrt(x) with one correction
+        FastMath_Atan2      absolute 1.2e-5 rad odd minimax polynomial on [0, 1]
+        FastMath_Asin       absolute 3.1e-7 rad polynomial times sqrt(1 - x)
+
+    All below the noise of a single accel sample (~0.01 deg). Define
+    FUSION_FAST_MATH in main.h to use them in the fusion paths, the MATH_x
+    macros below pick the kernel or libm accordingly (the user includes
+    <math.h> for the latter). The integer counterparts are in fixmath.c.
+*/
+
+#if !defined(FASTMATH_H)
+#define FASTMATH_H
+
+#include "imu_types.h"
+#include "main.h"
+
+/***************************************
+*            Constants
+****************************************/
+
+#ifdef FUSION_FAST_MATH
+    #define MATH_SQRTF(x)       FastMath_Sqrt(x)
+    #define MATH_INVSQRTF(x)    FastMath_InvSqrt(x)
+    #define MATH_ATAN2F(y, x)   FastMath_Atan2(y, x)
+    #define MATH_ASINF(x)       FastMath_Asin(x)
+#else
+    #define MATH_SQRTF(x)       sqrtf(x)
+    #define MATH_INVSQRTF(x)    (1.0f / sqrtf(x))
+    #define MATH_ATAN2F(y, x)   atan2f(y, x)
+    #define MATH_ASINF(x)       asinf(x)
+#endif
+
+/***************************************
+*        Function Prototypes
+****************************************/
+
+float FastMath_InvSqrt(float x);
+float FastMath_Sqrt(float x);
+float FastMath_Atan2(float y, float x);
+float FastMath_Asin(float x);
+
+#endif
+
+/* [] END OF FILE */
@@ -0,0 +1,302 @@
+/* ========================================
+ *
+ * Copyright YOUR COMPANY, THE YEAR
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CONFIDENTIAL AND PROPRIETARY INFORMATION
+ * WHICH IS THE PROPERTY OF your company.
+ *
+ * ========================================
+*/
+
+#include "fixmath.h"
+#include <stddef.h>
+
+// Odd polynomial for atan(z), z in [0,1], Q15 (Abramowitz & Stegun 4.4.47). Max error 1e-5 rad before rounding.
+#define ATAN_A1     (32763)     //  0.9998660
+#define ATAN_A3     (-10823)    // -0.3302995
+#define ATAN_A5     (5903)      //  0.1801410
+#define ATAN_A7     (-2790)     // -0.0851330
+#define ATAN_A9     (683)       //  0.0208351
+
+#define CORDIC_PI_Q28       (843314857)     // pi, the CORDIC angle accumulates in Q28
+#define CORDIC_GAIN_Q30     (652032874)     // 1 / prod(sqrt(1 + 2^-2i)), 0.6072529
+
+// atan(2^-i) in Q28 rad
+static const int32 cordicAtanQ28[FIX_CORDIC_STEPS] =
+{
+    210828714, 124459457, 65760959, 33381290, 16755422, 8385879, 4193963, 2097109, 1048571, 524287,
+    262144, 131072, 65536, 32768, 16384, 8192, 4096, 2048, 1024, 512
+};
+
+uint32 Fix_Sqrt32(uint32 x)
+{
+    // floor(sqrt(x)), one result bit per iteration
+    uint32 root = 0;
+    uint32 bit = 1uL << 30;
+
+    while(bit > x)
+    {
+        bit >>= 2;
+    }
+
+    while(bit != 0u)
+    {
+        if(x >= root + bit)
+        {
+            x -= root + bit;
+            root = (root >> 1) + bit;
+        }
+        else
+        {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+
+    return root;
+}
+
+uint32 Fix_Sqrt64(uint64 x)
+{
+    // floor(sqrt(x)) for the wide sums of squares
+    uint64 root = 0;
+    uint64 bit = 1uLL << 62;
+
+    if(x <= 0xFFFFFFFFuLL)
+    {
+        return Fix_Sqrt32((uint32)x);   // 32 bit loop is much cheaper on the M3
+    }
+
+    while(bit > x)
+    {
+        bit >>= 2;
+    }
+
+    while(bit != 0u)
+    {
+        if(x >= root + bit)
+        {
+            x -= root + bit;
+            root = (root >> 1) + bit;
+        }
+        else
+        {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+
+    return (uint32)root;
+}
+
+uint32 Fix_InvSqrtQ28(uint32 xQ28)
+{
+    /*
+        1/sqrt(x) in Q28 without division. x is scaled by 4^k into [1,4), a linear
+        seed is refined by four Newton steps y = y*(3 - m*y^2)/2 and the result is
+        scaled back by 2^k. Relative error < 2e-8, results above 16.0 (x below
+        1/256) saturate.
+    */
+
+    int8 k = 0;
+    uint32 m = xQ28;
+    uint64 y;
+
+    if(m == 0u)
+    {
+        return 0xFFFFFFFFu;
+    }
+
+    while(m < (1uL << 28))
+    {
+        m <<= 2;
+        k++;
+    }
+    while(m >= (1uL << 30))
+    {
+        m >>= 2;
+        k--;
+    }
+
+    y = (uint64)(295279001u - (uint32)(((uint64)m * 40265318u) >> 28));  // 1.1 - 0.15*m
+
+    for(uint8 i = 0; i < 4u; i++)
+    {
+        uint64 y2 = (y * y) >> 28;
+        uint64 my2 = ((uint64)m * y2) >> 28;
+        y = (y * ((3uLL << 28) - my2)) >> 29;
+    }
+
+    if(k >= 0)
+    {
+        y <<= k;
+    }
+    else
+    {
+        y >>= -k;
+    }
+
+    return (y > 0xFFFFFFFFuLL) ? 0xFFFFFFFFu : (uint32)y;
+}
+
+int32 Fix_Atan2Q16(int32 y, int32 x)
+{
+    /*
+        atan2 in Q16 radians, [-pi, pi]. x and y can be in any common scale.
+        Reduced to z = min/max in [0,1] and the polynomial above. Max error
+        1.6e-4 rad (0.01 deg) including the Q15 rounding.
+    */
+
+    uint32 ax = (x < 0) ? (uint32)(-x) : (uint32)x;
+    uint32 ay = (y < 0) ? (uint32)(-y) : (uint32)y;
+    int32 z, z2, p, angle;
+
+    if((ax == 0u) && (ay == 0u))
+    {
+        return 0;
+    }
+
+    while((ax | ay) >= (1uL << 16))     // keep (min << 15) inside 32 bit
+    {
+        ax >>= 1;
+        ay >>= 1;
+    }
+
+    if(ax >= ay)
+    {
+        z = (int32)((ay << 15) / ax);
+    }
+    else
+    {
+        z = (int32)((ax << 15) / ay);
+    }
+
+    z2 = (z * z) >> 15;
+    p = ATAN_A9;
+    p = ATAN_A7 + ((p * z2) >> 15);
+    p = ATAN_A5 + ((p * z2) >> 15);
+    p = ATAN_A3 + ((p * z2) >> 15);
+    p = ATAN_A1 + ((p * z2) >> 15);
+    angle = (p * z) >> 14;              // Q15 * Q15 -> Q16
+
+    if(ay > ax)
+    {
+        angle = FIX_HALF_PI_Q16 - angle;
+    }
+    if(x < 0)
+    {
+        angle = FIX_PI_Q16 - angle;
+    }
+    if(y < 0)
+    {
+        angle = -angle;
+    }
+
+    return angle;
+}
+
+int32 Fix_AsinQ16(int32 xQ15)
+{
+    // asin in Q16 radians as atan2(x, sqrt(1 - x^2)), input clamped to [-1, 1]
+    int32 c;
+
+    if(xQ15 > FIX_Q15_ONE)
+    {
+        xQ15 = FIX_Q15_ONE;
+    }
+    if(xQ15 < -FIX_Q15_ONE)
+    {
+        xQ15 = -FIX_Q15_ONE;
+    }
+
+    c = (int32)Fix_Sqrt32((uint32)(FIX_Q30_ONE - (xQ15 * xQ15)));
+
+    return Fix_Atan2Q16(xQ15, c);
+}
+
+int32 Fix_CordicQ16(int32 y, int32 x, uint32 *mag)
+{
+    /*
+        atan2(y, x) in Q16 radians by CORDIC vectoring: the vector is rotated onto
+        the x axis by +-atan(2^-i) steps, their sum is the angle and the final x
+        is the length times the CORDIC gain. x and y in any common scale, the
+        length comes back in that scale when mag is not NULL. The vector is
+        shifted to 28 bits first so every scale gets the full precision. Max
+        error 1e-5 rad (the Q16 rounding), the length is exact to 1e-8 before
+        it is rounded to an integer.
+    */
+
+    uint32 ax = (x < 0) ? (uint32)(-x) : (uint32)x;
+    uint32 ay = (y < 0) ? (uint32)(-y) : (uint32)y;
+    uint32 m = ax | ay;
+    int8 shift = 0;
+    int32 angle = 0;
+    int32 xs;
+
+    if(m == 0u)
+    {
+        if(mag != NULL)
+        {
+            *mag = 0u;
+        }
+        return 0;
+    }
+
+    while(m >= (1uL << 29))             // the gain grows it by 1.65, sqrt(2) * 2^29 * 1.65 fits
+    {
+        m >>= 1;
+        shift--;
+    }
+    while(m < (1uL << 28))
+    {
+        m <<= 1;
+        shift++;
+    }
+    if(shift >= 0)
+    {
+        x = (int32)((uint32)x << shift);
+        y = (int32)((uint32)y << shift);
+    }
+    else
+    {
+        x >>= -shift;
+        y >>= -shift;
+    }
+
+    if(x < 0)                           // left half plane: turn by pi, vectoring converges within +-99 deg
+    {
+        angle = (y >= 0) ? CORDIC_PI_Q28 : -CORDIC_PI_Q28;
+        x = -x;
+        y = -y;
+    }
+
+    for(uint8 i = 0; i < FIX_CORDIC_STEPS; i++)
+    {
+        xs = x;
+        if(y > 0)
+        {
+            x += y >> i;
+            y -= xs >> i;
+            angle += cordicAtanQ28[i];
+        }
+        else
+        {
+            x -= y >> i;
+            y += xs >> i;
+            angle -= cordicAtanQ28[i];
+        }
+    }
+
+    if(mag != NULL)
+    {
+        uint32 len = (uint32)(((uint64)(uint32)x * CORDIC_GAIN_Q30) >> 30);
+
+        *mag = (shift >= 0) ? ((len + ((1uL << shift) >> 1)) >> shift) : (len << -shift);
+    }
+
+    return (angle + (1L << 11)) >> 12;  // Q28 -> Q16, rounded
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,60 @@
+/* ========================================
+ *
+ * Copyright YOUR COMPANY, THE YEAR
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CONFIDENTIAL AND PROPRIETARY INFORMATION
+ * WHICH IS THE PROPERTY OF your company.
+ *
+ * ========================================
+*/
+
+/*
+    Integer math for the fixed-point fusion path. The Cortex-M3 has a hardware
+    32 bit divide and a 32x32->64 multiply, but no FPU, so everything here stays
+    in int32/int64 and avoids 64 bit division.
+
+    Qn means a signed integer holding value * 2^n.
+
+    Fix_Atan2Q16 is a polynomial with one hardware divide. Fix_CordicQ16 gets
+    the same angle from shifts and adds only and the vector length with it,
+    the cheaper choice where both are needed or on a core without a divider.
+*/
+
+#if !defined(FIXMATH_H)
+#define FIXMATH_H
+
+#include "imu_types.h"
+
+/***************************************
+*            Constants
+****************************************/
+
+#define FIX_Q15_ONE         (32768)
+#define FIX_Q16_ONE         (65536)
+#define FIX_Q28_ONE         (268435456)
+#define FIX_Q30_ONE         (1073741824)
+
+#define FIX_PI_Q16          (205887)        // pi
+#define FIX_HALF_PI_Q16     (102944)        // pi/2
+
+#define FIX_CORDIC_STEPS    (20u)           // Fix_CordicQ16 iterations, one result bit each
+
+// (a * b) >> shift with a 64 bit intermediate, rounds towards -inf like >>
+#define FIX_MUL(a, b, shift)    ((int32)(((int64)(a) * (int64)(b)) >> (shift)))
+
+/***************************************
+*        Function Prototypes
+****************************************/
+
+uint32 Fix_Sqrt32(uint32 x);
+uint32 Fix_Sqrt64(uint64 x);
+uint32 Fix_InvSqrtQ28(uint32 xQ28);
+int32 Fix_Atan2Q16(int32 y, int32 x);
+int32 Fix_AsinQ16(int32 xQ15);
+int32 Fix_CordicQ16(int32 y, int32 x, uint32 *mag);
+
+#endif
+
+/* [] END OF FILE */
@@ -0,0 +1,165 @@
+/* ========================================
+ *
+ * Copyright YOUR COMPANY, THE YEAR
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CONFIDENTIAL AND PROPRIETARY INFORMATION
+ * WHICH IS THE PROPERTY OF your company.
+ *
+ * ========================================
+*/
+
+#include "fusion.h"
+#include "fastmath.h"
+#include "fixmath.h"
+#include "profile.h"
+#include <math.h>
+#include "stdlib.h"
+
+#ifdef FUSION_FAST_MATH
+    // float kernels (fastmath.h) instead of the double libm calls
+    #define SQUARE(x)       ((x) * (x))
+    #define SQRT(x)         FastMath_Sqrt(x)
+    #define INV_SQRT(x)     FastMath_InvSqrt(x)
+    #define ATAN2(y, x)     FastMath_Atan2(y, x)
+    #define ASIN(x)         FastMath_Asin(x)
+#else
+    #define SQUARE(x)       pow(x, 2)
+    #define SQRT(x)         sqrt(x)
+    #define INV_SQRT(x)     (1.0 / sqrt(x))
+    #define ATAN2(y, x)     atan2(y, x)
+    #define ASIN(x)         asin(x)
+#endif
+
+void Fusion_AccWindow(WINDOW_STATS *window, uint32 mag, FUSION_OUT *out)
+{
+    /*
+        |a| window shared by all fusion paths, mag in raw counts. accLim is the
+        window sum in 0.1 g, scaled before it is truncated. Until the window
+        has filled up the sum is extrapolated from the samples so far, so a
+        fresh start does not look like free fall.
+    */
+
+    WindowStats_Push(window, (int32)mag);
+    out->accNow = (int32)mag;
+
+    if(WindowStats_Full(window))
+    {
+        out->accLim = (int32)(((uint64)WindowStats_Sum(window) * 10u) / FUSION_COUNTS_PER_G);
+    }
+    else
+    {
+        out->accLim = (int32)(((uint64)WindowStats_Sum(window) * 10u * FUSION_WINDOW) /
+                              ((uint64)WindowStats_Count(window) * FUSION_COUNTS_PER_G));
+    }
+
+    out->accMean = WindowStats_Mean(window);
+    out->accMin = WindowStats_Min(window);
+    out->accMax = WindowStats_Max(window);
+    out->accVar = WindowStats_Variance(window);
+}
+
+void FusionFloat_Init(FUSION_FLOAT_STATE *state)
+{
+    WindowStats_Init(&state->window);
+    
+    state->Q_pre[0] = 1;
+    state->Q_pre[1] = 0;
+    state->Q_pre[2] = 0;
+    state->Q_pre[3] = 0;
+}
+
+void FusionFloat_Update(FUSION_FLOAT_STATE *state, const IMU_FRAME *frame, FUSION_OUT *out)
+{
+    float accCurrent;
+    double roll, pitch;
+    float phi_quat, theta_quat;
+    float Q[4];
+    float Q_dot[4];
+    int filtered_roll, filtered_pitch;
+    PROFILE_START(mark);
+    
+    //__Fald detektions modul______________________________________________//
+    // Caltulates the absolute power with Pythagoras theorem and adds it to the window
+    accCurrent = SQRT(SQUARE((float)frame->accel[0]) + SQUARE((float)frame->accel[1]) + SQUARE((float)frame->accel[2]));
+    
+    Fusion_AccWindow(&state->window, (uint32)(accCurrent + 0.5f), out);  // in counts, exact integer sum
+    PROFILE_LAP(PROFILE_WINDOW, mark);
+    
+    //__Orienterings modul______________________________________________//     
+    float accelX = frame->accel[0];
+    float accelY = frame->accel[1];
+    float accelZ = frame->accel[2];
+    float gyroX = frame->gyro[0]/57.3;
+    float gyroY = frame->gyro[1]/57.3;
+    float gyroZ = frame->gyro[2]/57.3;
+    
+    // NORMALIZE ACCEL VALUES
+    float invAccel = INV_SQRT(SQUARE(accelX) + SQUARE(accelY) + SQUARE(accelZ));
+    accelX = accelX * invAccel;
+    accelY = accelY * invAccel;
+    accelZ = accelZ * invAccel;
+    
+    //  Euler angle from accel
+    roll = ATAN2 (-accelX ,( SQRT((accelY * accelY) + (accelZ * accelZ))));
+    pitch = ATAN2 (accelY ,( SQRT((accelX * accelX) + (accelZ * accelZ))));
+    
+    // 1st step sensor fusion using complimentary filter
+    pitch = (0.98 * (pitch + gyroY * dt / 1000.0f) + 0.02 * (accelY)) * 57.3;
+    roll =  (0.98 * (roll + gyroX * dt / 1000.0f) + 0.02 * (accelX)) * 57.3;
+    PROFILE_LAP(PROFILE_EULER, mark);
+    
+    // Calculate quaternions
+    Q_dot[0] = -0.5* ((gyroX*state->Q_pre[1]) + (gyroY*state->Q_pre[2]) + (state->Q_pre[3]*gyroZ));
+    Q_dot[1] =  0.5* ((gyroX*state->Q_pre[0]) + (gyroZ*state->Q_pre[2]) - (state->Q_pre[3]*gyroY));
+    Q_dot[2] =  0.5* ((gyroY*state->Q_pre[0]) - (gyroZ*state->Q_pre[1]) + (state->Q_pre[3]*gyroX));
+    Q_dot[3] =  0.5* ((gyroZ*state->Q_pre[0]) + (gyroY*state->Q_pre[1]) - (state->Q_pre[2]*gyroX));
+    
+    // Store quaternions
+    for(uint8 i = 0; i < 4u; i++)
+    {
+        Q[i] = state->Q_pre[i] + (Q_dot[i] * dt / 1000.0);
+        state->Q_pre[i] = Q[i];
+    }
+
+    // Normalize quaternions
+    float invn = INV_SQRT((Q[0]*Q[0]) + (Q[1]*Q[1]) + (Q[2]*Q[2]) + (Q[3]*Q[3]));
+    float Q0 = Q[0] * invn;
+    float Q1 = Q[1] * invn;
+    float Q2 = Q[2] * invn;
+    float Q3 = Q[3] * invn;
+    
+    // Quaternion angles
+    phi_quat = ATAN2 (2*((Q0*Q1)+(Q2*Q3)), (0.5f-(Q1*Q1)-(Q2*Q2)));
+    theta_quat = ASIN (2*((Q0*Q2)-(Q1*Q3)));
+    
+    // 2nd step sensor fusion using complimentary filter
+    phi_quat = (0.98 * (phi_quat + gyroX * dt / 1000.0f) + 0.02 * (accelX)) * 57.3;
+    theta_quat = (0.98 * (theta_quat + gyroY * dt / 1000.0f) + 0.02 * (accelY)) * 57.3;
+
+    // Final filtration using complimentary filter
+    filtered_roll = 0.99 * (roll + roll * dt / 1000.0f) + 0.01 * (phi_quat);
+    filtered_pitch = 0.99 * (pitch + pitch * dt / 1000.0f) + 0.01 * (theta_quat);
+    
+    // Convert to absolute values
+    out->rollLim = abs(filtered_roll);
+    out->pitchLim = abs(filtered_pitch);
+    
+    // Offset to generate values form 0-180 instead of +-90
+    if(accelZ < 0)
+    {
+        out->rollLim = 180 - abs(filtered_roll);
+        out->pitchLim = 180 - abs(filtered_pitch);
+    }
+    
+    out->rollQ16 = (int32)(roll * FIX_Q16_ONE);
+    out->pitchQ16 = (int32)(pitch * FIX_Q16_ONE);
+    out->quat[0] = (int32)(Q0 * FIX_Q30_ONE);
+    out->quat[1] = (int32)(Q1 * FIX_Q30_ONE);
+    out->quat[2] = (int32)(Q2 * FIX_Q30_ONE);
+    out->quat[3] = (int32)(Q3 * FIX_Q30_ONE);
+    PROFILE_LAP(PROFILE_QUAT, mark);
+}
+
+/* [] END OF FILE */
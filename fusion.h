@@ -0,0 +1,174 @@
+/* ========================================
+ *
+ * Copyright YOUR COMPANY, THE YEAR
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CONFIDENTIAL AND PROPRIETARY INFORMATION
+ * WHICH IS THE PROPERTY OF your company.
+ *
+ * ========================================
+*/
+
+/*
+    Orientation and free-fall signal processing, run once per IMU frame.
+
+    Two interchangeable implementations of the same algorithm:
+
+    FusionFloat_x   The original float/double code from the main loop, kept as
+                    the reference. Every sample goes through soft-float sqrt,
+                    pow, atan2 and asin on the M3, or through the float
+                    kernels of fastmath.c with FUSION_FAST_MATH.
+
+    FusionFixed_x   Integer only. Magnitude and normalization with integer sqrt
+                    and the hardware divide, angles in Q16 radians with the
+                    polynomial atan2/asin in fixmath.c, quaternion in Q28 and
+                    normalized with a Newton reciprocal square root.
+
+    Define FUSION_FIXED_POINT in main.h to make Fusion_x the fixed-point path.
+
+    A third option replaces the three stacked filters with a single quaternion
+    estimator (fusion_quat.c), selected with FUSION_ESTIMATOR in main.h:
+
+    FusionMadgwick_x    Gradient descent correction towards the measured gravity
+    FusionMahony_x      PI correction, the integral term tracks the gyro bias
+
+    These work in real units (rad/s, dt in seconds) and skip the accel
+    correction while |a| is outside 1 g +- FUSION_ACC_GATE. rollLim/pitchLim
+    keep their meaning for the detector, rollQ16/pitchQ16 are the estimated
+    tilt instead of the accel angles. Per sample: 2 asinf and 2 sqrtf against
+    3 atan2, 1 asin, 5 sqrt and 6 pow in the reference. Full Euler angles are
+    computed only on request with FusionQuat_Euler.
+
+    Only the quaternion estimators use the magnetometer (MAGNETOMETER): with
+    it their yaw is referenced to magnetic north instead of drifting with the
+    gyro z bias. The complementary filters stay 6-DoF, their outputs are tilt.
+
+    Host results from host/bench_fusion on synthetic motion with ground truth
+    are in that file.
+
+    Error bound of the fixed-point path versus the float reference, measured on
+    the host with "host/build/bench_fusion --fixed-error" (seeds 1 to 3) over
+    2 x 10^6 frames (uniform random int16 frames, and random-walk motion with
+    short free-fall bursts, in sequences of 10^5 frames):
+        rollQ16/pitchQ16    < 0.012 deg
+        quat                < 1e-4 per component after 10^5 frames, mostly
+                            rounding in the reference's float integration
+        rollLim/pitchLim    +-1 deg in 0.56 % of frames, where the value sits at
+                            an integer and the int conversion truncates the
+                            other way. Up to 4 deg in < 1e-5 of frames, where the
+                            quaternion roll sits on the +-180 deg wrap of atan2
+        accLim              differs in <= 1e-5 of frames, where |a| sits on a
+                            half count and the float and integer square roots
+                            round it differently. The window itself is the same
+                            exact integer code (Fusion_AccWindow) in all paths
+
+    Cycle counts are measured on target with FUSION_COMPARE (main.c), which runs
+    both paths on every frame and accumulates cycles and deviations.
+*/
+
+#if !defined(FUSION_H)
+#define FUSION_H
+
+#include "imu_types.h"
+#include "main.h"
+#include "window_stats.h"
+
+/***************************************
+*            Constants
+****************************************/
+
+#define FUSION_WINDOW       (WINDOW_STATS_LEN)  // samples in the |a| window
+#define FUSION_COUNTS_PER_G ((uint32)MPU_ACCEL_LSB_PER_G)     // ACCELEROMETER_SENSITIVITY as integer
+
+#define FUSION_EST_COMPLEMENTARY    (0u)    // fusion.c / fusion_fixed.c
+#define FUSION_EST_MADGWICK         (1u)    // fusion_quat.c
+#define FUSION_EST_MAHONY           (2u)    // fusion_quat.c
+
+#define FUSION_ACC_GATE         (0.5f)  // accel correction only while | |a| - 1 g | < this, in g
+#define FUSION_MADGWICK_BETA    (0.1f)  // gradient step, rad/s
+#define FUSION_MAHONY_KP        (1.0f)  // proportional gain, rad/s per unit error
+#define FUSION_MAHONY_KI        (0.02f) // integral gain, gyro bias in rad/s per unit error and s
+
+/***************************************
+*            Types
+****************************************/
+
+typedef struct
+{
+    int32 accLim;           // sum of the last FUSION_WINDOW |a| in 0.1 g, truncated
+    int32 rollLim;          // |filtered roll| in deg, 180 - |roll| when upside down
+    int32 pitchLim;         // |filtered pitch| in deg, 180 - |pitch| when upside down
+    int32 rollQ16;          // roll after the 1st complementary filter (estimated roll for the quaternion filters), deg Q16
+    int32 pitchQ16;         // pitch after the 1st complementary filter (estimated pitch for the quaternion filters), deg Q16
+    int32 quat[4];          // normalized attitude quaternion, Q30
+    int32 accNow;           // |a| of this sample in counts
+    int32 accMean;          // |a| over the window in counts: mean, min, max
+    int32 accMin;
+    int32 accMax;
+    uint32 accVar;          // variance of |a| over the window, counts^2
+} FUSION_OUT;
+
+typedef struct
+{
+    WINDOW_STATS window;            // |a| in raw counts
+    float Q_pre[4];                 // integrated quaternion, not normalized
+} FUSION_FLOAT_STATE;
+
+typedef struct
+{
+    WINDOW_STATS window;            // |a| in raw counts
+    int32 Q_pre[4];                 // integrated quaternion, not normalized, Q28
+} FUSION_FIXED_STATE;
+
+typedef struct
+{
+    WINDOW_STATS window;            // |a| in raw counts
+    float q[4];                     // attitude quaternion, normalized every sample
+    float integral[3];              // Mahony integral term, rad/s
+    uint8 seeded;                   // q set from the first trusted accel sample
+    uint8 headed;                   // yaw set from the first magnetometer sample
+} FUSION_QUAT_STATE;
+
+/***************************************
+*        Function Prototypes
+****************************************/
+
+void Fusion_AccWindow(WINDOW_STATS *window, uint32 mag, FUSION_OUT *out);
+
+void FusionFloat_Init(FUSION_FLOAT_STATE *state);
+void FusionFloat_Update(FUSION_FLOAT_STATE *state, const IMU_FRAME *frame, FUSION_OUT *out);
+
+void FusionFixed_Init(FUSION_FIXED_STATE *state);
+void FusionFixed_Update(FUSION_FIXED_STATE *state, const IMU_FRAME *frame, FUSION_OUT *out);
+
+void FusionQuat_Init(FUSION_QUAT_STATE *state);
+void FusionMadgwick_Update(FUSION_QUAT_STATE *state, const IMU_FRAME *frame, FUSION_OUT *out);
+void FusionMahony_Update(FUSION_QUAT_STATE *state, const IMU_FRAME *frame, FUSION_OUT *out);
+void FusionQuat_Euler(const FUSION_QUAT_STATE *state, float *roll, float *pitch, float *yaw);
+
+#if !defined(FUSION_ESTIMATOR)
+    #define FUSION_ESTIMATOR    FUSION_EST_COMPLEMENTARY
+#endif
+
+#if (FUSION_ESTIMATOR == FUSION_EST_MADGWICK)
+    #define FUSION_STATE        FUSION_QUAT_STATE
+    #define Fusion_Init         FusionQuat_Init
+    #define Fusion_Update       FusionMadgwick_Update
+#elif (FUSION_ESTIMATOR == FUSION_EST_MAHONY)
+    #define FUSION_STATE        FUSION_QUAT_STATE
+    #define Fusion_Init         FusionQuat_Init
+    #define Fusion_Update       FusionMahony_Update
+#elif defined(FUSION_FIXED_POINT)
+    #define FUSION_STATE        FUSION_FIXED_STATE
+    #define Fusion_Init         FusionFixed_Init
+    #define Fusion_Update       FusionFixed_Update
+#else
+    #define FUSION_STATE        FUSION_FLOAT_STATE
+    #define Fusion_Init         FusionFloat_Init
+    #define Fusion_Update       FusionFloat_Update
+#endif
+
+#endif
+
+/* [] END OF FILE */
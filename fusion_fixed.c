@@ -0,0 +1,179 @@
+/* ========================================
+ *
+ * Copyright YOUR COMPANY, THE YEAR
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CONFIDENTIAL AND PROPRIETARY INFORMATION
+ * WHICH IS THE PROPERTY OF your company.
+ *
+ * ========================================
+*/
+
+/*
+    Fixed-point version of FusionFloat_Update (fusion.c). Same algorithm and same
+    constants, including the dt/1000 gyro scaling and the 0.5 in the quaternion
+    roll, so the two can be compared output for output.
+*/
+
+#include "fusion.h"
+#include "fixmath.h"
+#include "profile.h"
+
+#define K_0_98_Q30          (1052266988)    // 0.98
+#define K_0_02_Q30          (21474836)      // 0.02
+#define K_0_99_Q30          (1063015036)    // 0.99 * (1 + dt/1000)
+#define K_0_01_Q30          (10737418)      // 0.01
+#define K_57_3_Q16          (3755213)       // 57.3, rad -> deg as in the float code
+#define GYRO_STEP_Q36       (11993)         // gyro count / 57.3 * dt/1000, Q16 rad per count << 20
+#define QUAT_STEP_Q38       (23986)         // 0.5 / 57.3 * dt/1000, per count
+
+static int32 Complementary(int32 angleQ16, int16 gyroRaw, int32 accQ15)
+{
+    // (0.98 * (angle + gyro * dt/1000) + 0.02 * acc) * 57.3, rad Q16 in, deg Q16 out
+    int32 predicted = angleQ16 + ((gyroRaw * GYRO_STEP_Q36) >> 20);
+    int32 mixed = FIX_MUL(predicted, K_0_98_Q30, 30) + FIX_MUL(accQ15 << 1, K_0_02_Q30, 30);
+
+    return FIX_MUL(mixed, K_57_3_Q16, 16);
+}
+
+static int32 TruncDeg(int32 degQ16)
+{
+    // int conversion of the float code, truncates towards zero
+    return (degQ16 >= 0) ? (degQ16 >> 16) : -((-degQ16) >> 16);
+}
+
+static int32 AbsInt(int32 x)
+{
+    return (x < 0) ? -x : x;
+}
+
+void FusionFixed_Init(FUSION_FIXED_STATE *state)
+{
+    WindowStats_Init(&state->window);
+
+    state->Q_pre[0] = FIX_Q28_ONE;
+    state->Q_pre[1] = 0;
+    state->Q_pre[2] = 0;
+    state->Q_pre[3] = 0;
+}
+
+void FusionFixed_Update(FUSION_FIXED_STATE *state, const IMU_FRAME *frame, FUSION_OUT *out)
+{
+    int32 ax = frame->accel[0];
+    int32 ay = frame->accel[1];
+    int32 az = frame->accel[2];
+    int32 gx = frame->gyro[0];
+    int32 gy = frame->gyro[1];
+    int32 gz = frame->gyro[2];
+    uint32 sumSq = (uint32)(ax*ax) + (uint32)(ay*ay) + (uint32)(az*az);    // < 3 * 2^30
+    uint32 mag;
+    int32 axn, ayn, azn;
+    int32 roll, pitch, phi, theta;
+    int32 Q[4];
+    int64 dq[4];
+    int32 filtered_roll, filtered_pitch;
+    PROFILE_START(mark);
+
+    //__Fald detektions modul______________________________________________//
+    // |a| in counts, and normalized accel in Q15 with only 32 bit divides
+    if(sumSq < (1uL << 24))
+    {
+        uint32 magQ4 = Fix_Sqrt32(sumSq << 8);     // below 0.25 g keep 4 extra bits for the division
+
+        if(magQ4 == 0u)
+        {
+            magQ4 = 1u;
+        }
+        mag = (magQ4 + 8u) >> 4;
+        axn = (ax << 19) / (int32)magQ4;
+        ayn = (ay << 19) / (int32)magQ4;
+        azn = (az << 19) / (int32)magQ4;
+    }
+    else
+    {
+        mag = Fix_Sqrt32(sumSq);
+        if((sumSq - (mag * mag)) > mag)
+        {
+            mag++;                                  // round to nearest
+        }
+        axn = (ax << 15) / (int32)mag;
+        ayn = (ay << 15) / (int32)mag;
+        azn = (az << 15) / (int32)mag;
+    }
+
+    Fusion_AccWindow(&state->window, mag, out);
+    PROFILE_LAP(PROFILE_WINDOW, mark);
+
+    //__Orienterings modul______________________________________________//
+    //  Euler angle from accel, Q16 rad
+    roll = Fix_Atan2Q16(-axn, (int32)Fix_Sqrt32((uint32)(ayn*ayn) + (uint32)(azn*azn)));
+    pitch = Fix_Atan2Q16(ayn, (int32)Fix_Sqrt32((uint32)(axn*axn) + (uint32)(azn*azn)));
+
+    // 1st step sensor fusion using complimentary filter, deg Q16
+    pitch = Complementary(pitch, (int16)gy, ayn);
+    roll = Complementary(roll, (int16)gx, axn);
+    PROFILE_LAP(PROFILE_EULER, mark);
+
+    // Integrate quaternion, Q28
+    dq[0] = -((int64)gx*state->Q_pre[1] + (int64)gy*state->Q_pre[2] + (int64)gz*state->Q_pre[3]);
+    dq[1] =   (int64)gx*state->Q_pre[0] + (int64)gz*state->Q_pre[2] - (int64)gy*state->Q_pre[3];
+    dq[2] =   (int64)gy*state->Q_pre[0] - (int64)gz*state->Q_pre[1] + (int64)gx*state->Q_pre[3];
+    dq[3] =   (int64)gz*state->Q_pre[0] + (int64)gy*state->Q_pre[1] - (int64)gx*state->Q_pre[2];
+
+    for(uint8 i = 0; i < 4u; i++)
+    {
+        state->Q_pre[i] += (int32)(((dq[i] * QUAT_STEP_Q38) + (1LL << 37)) >> 38);    // rounded, truncation would drift
+    }
+
+    // Normalize quaternion, Q28 * Q28 >> 26 = Q30
+    {
+        int64 sq = 0;
+        uint32 invn;
+
+        for(uint8 i = 0; i < 4u; i++)
+        {
+            sq += (int64)state->Q_pre[i] * state->Q_pre[i];
+        }
+        invn = Fix_InvSqrtQ28((uint32)(sq >> 28));
+
+        for(uint8 i = 0; i < 4u; i++)
+        {
+            Q[i] = (int32)(((int64)state->Q_pre[i] * invn) >> 26);
+        }
+    }
+
+    // Quaternion angles, Q16 rad
+    phi = Fix_Atan2Q16(2 * (FIX_MUL(Q[0], Q[1], 30) + FIX_MUL(Q[2], Q[3], 30)),
+                       (FIX_Q30_ONE >> 1) - FIX_MUL(Q[1], Q[1], 30) - FIX_MUL(Q[2], Q[2], 30));
+    theta = Fix_AsinQ16((2 * (FIX_MUL(Q[0], Q[2], 30) - FIX_MUL(Q[1], Q[3], 30))) >> 15);
+
+    // 2nd step sensor fusion using complimentary filter, deg Q16
+    phi = Complementary(phi, (int16)gx, axn);
+    theta = Complementary(theta, (int16)gy, ayn);
+
+    // Final filtration using complimentary filter
+    filtered_roll = TruncDeg(FIX_MUL(roll, K_0_99_Q30, 30) + FIX_MUL(phi, K_0_01_Q30, 30));
+    filtered_pitch = TruncDeg(FIX_MUL(pitch, K_0_99_Q30, 30) + FIX_MUL(theta, K_0_01_Q30, 30));
+
+    // Convert to absolute values
+    out->rollLim = AbsInt(filtered_roll);
+    out->pitchLim = AbsInt(filtered_pitch);
+
+    // Offset to generate values form 0-180 instead of +-90
+    if(az < 0)                                      // raw sign, azn can round to 0
+    {
+        out->rollLim = 180 - AbsInt(filtered_roll);
+        out->pitchLim = 180 - AbsInt(filtered_pitch);
+    }
+
+    out->rollQ16 = roll;
+    out->pitchQ16 = pitch;
+    out->quat[0] = Q[0];
+    out->quat[1] = Q[1];
+    out->quat[2] = Q[2];
+    out->quat[3] = Q[3];
+    PROFILE_LAP(PROFILE_QUAT, mark);
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,386 @@
+/* ========================================
+ *
+ * Copyright YOUR COMPANY, THE YEAR
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CONFIDENTIAL AND PROPRIETARY INFORMATION
+ * WHICH IS THE PROPERTY OF your company.
+ *
+ * ========================================
+*/
+
+/*
+    Single quaternion estimators as an alternative to the three stacked
+    complementary filters in fusion.c.
+
+    FusionMadgwick_Update   gradient descent correction (Madgwick 2010)
+    FusionMahony_Update     PI correction on the gravity error (Mahony 2008)
+
+    Both integrate the gyro in rad/s (GYROSCOPE_SENSITIVITY) over the real dt and
+    correct with the accelerometer only while |a| is within FUSION_ACC_GATE of
+    1 g, so free fall and impacts are ridden out on the gyro alone.
+
+    With a magnetometer sample in the frame (magValid) both run the full 9-DoF
+    (MARG) form: the measured field is rotated into the world frame, its
+    horizontal part taken as north (the reference b = (bx, 0, bz) follows the
+    local inclination) and the error towards it corrects yaw as well. The first
+    usable field sets the heading directly. The magnetometer is only used
+    together with a trusted accel sample, the tilt must be known to find the
+    horizontal.
+
+    Per sample: no trig, 2 square roots (accel and quaternion normalization).
+    The float reference needs 3 atan2, 1 asin, 5 sqrt and 6 pow. The decision
+    inputs rollLim/pitchLim need 2 asinf on the gravity vector. Full Euler
+    angles are only computed when asked for with FusionQuat_Euler. With
+    FUSION_FAST_MATH all of these are the kernels of fastmath.c.
+*/
+
+#include "fusion.h"
+#include "fastmath.h"
+#include "fixmath.h"
+#include "profile.h"
+#include <math.h>
+
+#define RAD_TO_DEG          (57.29578f)
+#define GYRO_RAD_PER_COUNT  ((float)(3.14159265 / 180.0 / GYROSCOPE_SENSITIVITY))
+#define SAMPLE_PERIOD       ((float)dt)
+#define ACC_GATE_LOW_SQ     ((1.0f - FUSION_ACC_GATE) * (1.0f - FUSION_ACC_GATE) * ACCELEROMETER_SENSITIVITY * ACCELEROMETER_SENSITIVITY)
+#define ACC_GATE_HIGH_SQ    ((1.0f + FUSION_ACC_GATE) * (1.0f + FUSION_ACC_GATE) * ACCELEROMETER_SENSITIVITY * ACCELEROMETER_SENSITIVITY)
+
+static void Normalize(float *v, uint8 n)
+{
+    float sq = 0.0f;
+    float inv;
+
+    for(uint8 i = 0; i < n; i++)
+    {
+        sq += v[i] * v[i];
+    }
+    inv = MATH_INVSQRTF(sq);
+    for(uint8 i = 0; i < n; i++)
+    {
+        v[i] *= inv;
+    }
+}
+
+static void Output(const FUSION_QUAT_STATE *state, FUSION_OUT *out)
+{
+    /*
+        rollLim/pitchLim with the same meaning as in the reference: the angles the
+        accel Euler formulas would give for the estimated gravity vector, and
+        180 minus those when upside down.
+    */
+
+    const float *q = state->q;
+    float gx = 2.0f * (q[1]*q[3] - q[0]*q[2]);
+    float gy = 2.0f * (q[0]*q[1] + q[2]*q[3]);
+    float gz = q[0]*q[0] - q[1]*q[1] - q[2]*q[2] + q[3]*q[3];
+    float roll, pitch;
+
+    gx = (gx > 1.0f) ? 1.0f : ((gx < -1.0f) ? -1.0f : gx);
+    gy = (gy > 1.0f) ? 1.0f : ((gy < -1.0f) ? -1.0f : gy);
+
+    roll = -MATH_ASINF(gx) * RAD_TO_DEG;    // == atan2(-gx, sqrt(gy^2 + gz^2)) for a unit vector
+    pitch = MATH_ASINF(gy) * RAD_TO_DEG;
+
+    out->rollLim = (int32)fabsf(roll);
+    out->pitchLim = (int32)fabsf(pitch);
+    if(gz < 0.0f)
+    {
+        out->rollLim = 180 - out->rollLim;
+        out->pitchLim = 180 - out->pitchLim;
+    }
+
+    out->rollQ16 = (int32)(roll * FIX_Q16_ONE);
+    out->pitchQ16 = (int32)(pitch * FIX_Q16_ONE);
+    for(uint8 i = 0; i < 4u; i++)
+    {
+        out->quat[i] = (int32)(q[i] * FIX_Q30_ONE);
+    }
+}
+
+static void Seed(FUSION_QUAT_STATE *state, const float *a)
+{
+    /*
+        Start from the tilt of the first trusted accel sample instead of level,
+        otherwise a device switched on at an angle needs seconds to converge.
+        Shortest rotation taking the measured gravity a (unit) onto z, no yaw.
+    */
+
+    float *q = state->q;
+
+    if(a[2] > -0.999f)
+    {
+        q[0] = 1.0f + a[2];
+        q[1] = a[1];
+        q[2] = -a[0];
+        q[3] = 0.0f;
+        Normalize(q, 4u);
+    }
+    else
+    {
+        q[0] = 0.0f;                        // upside down, any half turn about a horizontal axis
+        q[1] = 1.0f;
+        q[2] = 0.0f;
+        q[3] = 0.0f;
+    }
+    state->seeded = TRUE;
+}
+
+static uint8 MagUsable(const IMU_FRAME *frame, float *m)
+{
+    // Normalized field in m, FALSE without a magnetometer sample
+    m[0] = frame->mag[0];
+    m[1] = frame->mag[1];
+    m[2] = frame->mag[2];
+
+    if(!frame->magValid || (m[0] == 0.0f && m[1] == 0.0f && m[2] == 0.0f))
+    {
+        return FALSE;
+    }
+    Normalize(m, 3u);
+
+    return TRUE;
+}
+
+static void SeedHeading(FUSION_QUAT_STATE *state, const float *m)
+{
+    // Turn about the world z axis so the horizontal part of the field points along x
+    float *q = state->q;
+    float hx = m[0] * (1.0f - 2.0f * (q[2]*q[2] + q[3]*q[3])) + m[1] * 2.0f * (q[1]*q[2] - q[0]*q[3]) + m[2] * 2.0f * (q[1]*q[3] + q[0]*q[2]);
+    float hy = m[0] * 2.0f * (q[1]*q[2] + q[0]*q[3]) + m[1] * (1.0f - 2.0f * (q[1]*q[1] + q[3]*q[3])) + m[2] * 2.0f * (q[2]*q[3] - q[0]*q[1]);
+    float half = 0.5f * MATH_ATAN2F(hy, hx);
+    float c = cosf(half), s = sinf(half);
+    float r[4];
+
+    // (c, 0, 0, -s) x q
+    r[0] = c*q[0] + s*q[3];
+    r[1] = c*q[1] + s*q[2];
+    r[2] = c*q[2] - s*q[1];
+    r[3] = c*q[3] - s*q[0];
+    for(uint8 i = 0; i < 4u; i++)
+    {
+        q[i] = r[i];
+    }
+    state->headed = TRUE;
+}
+
+static uint8 AccelTrusted(FUSION_QUAT_STATE *state, float *a, float accSq)
+{
+    // Normalizes a and seeds the attitude on first use. FALSE in free fall and on impacts
+    if(accSq <= ACC_GATE_LOW_SQ || accSq >= ACC_GATE_HIGH_SQ)
+    {
+        return FALSE;
+    }
+
+    Normalize(a, 3u);
+    if(!state->seeded)
+    {
+        Seed(state, a);
+    }
+
+    return TRUE;
+}
+
+static void Integrate(FUSION_QUAT_STATE *state, float gx, float gy, float gz, const float *s, float beta)
+{
+    // q += (0.5 * q x (0, g) - beta * s) * dt, then renormalize
+    float *q = state->q;
+    float qDot[4];
+
+    qDot[0] = 0.5f * (-q[1]*gx - q[2]*gy - q[3]*gz) - beta * s[0];
+    qDot[1] = 0.5f * ( q[0]*gx + q[2]*gz - q[3]*gy) - beta * s[1];
+    qDot[2] = 0.5f * ( q[0]*gy - q[1]*gz + q[3]*gx) - beta * s[2];
+    qDot[3] = 0.5f * ( q[0]*gz + q[1]*gy - q[2]*gx) - beta * s[3];
+
+    for(uint8 i = 0; i < 4u; i++)
+    {
+        q[i] += qDot[i] * SAMPLE_PERIOD;
+    }
+    Normalize(q, 4u);
+}
+
+void FusionQuat_Init(FUSION_QUAT_STATE *state)
+{
+    WindowStats_Init(&state->window);
+
+    state->q[0] = 1.0f;
+    state->q[1] = 0.0f;
+    state->q[2] = 0.0f;
+    state->q[3] = 0.0f;
+
+    state->integral[0] = 0.0f;
+    state->integral[1] = 0.0f;
+    state->integral[2] = 0.0f;
+    state->seeded = FALSE;
+    state->headed = FALSE;
+}
+
+void FusionMadgwick_Update(FUSION_QUAT_STATE *state, const IMU_FRAME *frame, FUSION_OUT *out)
+{
+    const float *q = state->q;
+    float gx = frame->gyro[0] * GYRO_RAD_PER_COUNT;
+    float gy = frame->gyro[1] * GYRO_RAD_PER_COUNT;
+    float gz = frame->gyro[2] * GYRO_RAD_PER_COUNT;
+    float a[3] = { frame->accel[0], frame->accel[1], frame->accel[2] };
+    float accSq = a[0]*a[0] + a[1]*a[1] + a[2]*a[2];
+    float s[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    float m[3];
+    PROFILE_START(mark);
+
+    Fusion_AccWindow(&state->window, (uint32)(MATH_SQRTF(accSq) + 0.5f), out);
+    PROFILE_LAP(PROFILE_WINDOW, mark);
+
+    if(AccelTrusted(state, a, accSq))
+    {
+        uint8 magOk = MagUsable(frame, m);
+
+        if(magOk && !state->headed)
+        {
+            SeedHeading(state, m);
+        }
+
+        if(magOk)
+        {
+            // Gradient of the gravity and field errors, MARG form of Madgwick eq. 34 (a is normalized already)
+            float _2q0 = 2.0f*q[0], _2q1 = 2.0f*q[1], _2q2 = 2.0f*q[2], _2q3 = 2.0f*q[3];
+            float _2q0mx = _2q0*m[0], _2q0my = _2q0*m[1], _2q0mz = _2q0*m[2], _2q1mx = _2q1*m[0];
+            float _2q0q2 = _2q0*q[2], _2q2q3 = _2q2*q[3];
+            float q0q0 = q[0]*q[0], q0q1 = q[0]*q[1], q0q2 = q[0]*q[2], q0q3 = q[0]*q[3];
+            float q1q1 = q[1]*q[1], q1q2 = q[1]*q[2], q1q3 = q[1]*q[3];
+            float q2q2 = q[2]*q[2], q2q3 = q[2]*q[3], q3q3 = q[3]*q[3];
+            float hx, hy, _2bx, _2bz, _4bx, _4bz, ex, ey, ez;
+
+            hx = m[0]*q0q0 - _2q0my*q[3] + _2q0mz*q[2] + m[0]*q1q1 + _2q1*m[1]*q[2] + _2q1*m[2]*q[3] - m[0]*q2q2 - m[0]*q3q3;
+            hy = _2q0mx*q[3] + m[1]*q0q0 - _2q0mz*q[1] + _2q1mx*q[2] - m[1]*q1q1 + m[1]*q2q2 + _2q2*m[2]*q[3] - m[1]*q3q3;
+            _2bx = MATH_SQRTF(hx*hx + hy*hy);
+            _2bz = -_2q0mx*q[2] + _2q0my*q[1] + m[2]*q0q0 + _2q1mx*q[3] - m[2]*q1q1 + _2q2*m[1]*q[3] - m[2]*q2q2 + m[2]*q3q3;
+            _4bx = 2.0f*_2bx;
+            _4bz = 2.0f*_2bz;
+
+            ex = _2bx*(0.5f - q2q2 - q3q3) + _2bz*(q1q3 - q0q2) - m[0];     // field error, world reference in the body frame
+            ey = _2bx*(q1q2 - q0q3) + _2bz*(q0q1 + q2q3) - m[1];
+            ez = _2bx*(q0q2 + q1q3) + _2bz*(0.5f - q1q1 - q2q2) - m[2];
+
+            s[0] = -_2q2*(2.0f*q1q3 - _2q0q2 - a[0]) + _2q1*(2.0f*q0q1 + _2q2q3 - a[1])
+                   - _2bz*q[2]*ex + (-_2bx*q[3] + _2bz*q[1])*ey + _2bx*q[2]*ez;
+            s[1] = _2q3*(2.0f*q1q3 - _2q0q2 - a[0]) + _2q0*(2.0f*q0q1 + _2q2q3 - a[1]) - 4.0f*q[1]*(1.0f - 2.0f*q1q1 - 2.0f*q2q2 - a[2])
+                   + _2bz*q[3]*ex + (_2bx*q[2] + _2bz*q[0])*ey + (_2bx*q[3] - _4bz*q[1])*ez;
+            s[2] = -_2q0*(2.0f*q1q3 - _2q0q2 - a[0]) + _2q3*(2.0f*q0q1 + _2q2q3 - a[1]) - 4.0f*q[2]*(1.0f - 2.0f*q1q1 - 2.0f*q2q2 - a[2])
+                   + (-_4bx*q[2] - _2bz*q[0])*ex + (_2bx*q[1] + _2bz*q[3])*ey + (_2bx*q[0] - _4bz*q[2])*ez;
+            s[3] = _2q1*(2.0f*q1q3 - _2q0q2 - a[0]) + _2q2*(2.0f*q0q1 + _2q2q3 - a[1])
+                   + (-_4bx*q[3] + _2bz*q[1])*ex + (-_2bx*q[0] + _2bz*q[2])*ey + _2bx*q[1]*ez;
+        }
+        else
+        {
+            // Gradient of the gravity error, Madgwick eq. 25 with the common subexpressions pulled out
+            float _2q0 = 2.0f*q[0], _2q1 = 2.0f*q[1], _2q2 = 2.0f*q[2], _2q3 = 2.0f*q[3];
+            float _4q0 = 4.0f*q[0], _4q1 = 4.0f*q[1], _4q2 = 4.0f*q[2];
+            float _8q1 = 8.0f*q[1], _8q2 = 8.0f*q[2];
+            float q0q0 = q[0]*q[0], q1q1 = q[1]*q[1], q2q2 = q[2]*q[2], q3q3 = q[3]*q[3];
+
+            s[0] = _4q0*q2q2 + _2q2*a[0] + _4q0*q1q1 - _2q1*a[1];
+            s[1] = _4q1*q3q3 - _2q3*a[0] + 4.0f*q0q0*q[1] - _2q0*a[1] - _4q1 + _8q1*q1q1 + _8q1*q2q2 + _4q1*a[2];
+            s[2] = 4.0f*q0q0*q[2] + _2q0*a[0] + _4q2*q3q3 - _2q3*a[1] - _4q2 + _8q2*q1q1 + _8q2*q2q2 + _4q2*a[2];
+            s[3] = 4.0f*q1q1*q[3] - _2q1*a[0] + 4.0f*q2q2*q[3] - _2q2*a[1];
+        }
+
+        if(s[0] != 0.0f || s[1] != 0.0f || s[2] != 0.0f || s[3] != 0.0f)
+        {
+            Normalize(s, 4u);
+        }
+    }
+
+    Integrate(state, gx, gy, gz, s, FUSION_MADGWICK_BETA);
+    PROFILE_LAP(PROFILE_QUAT, mark);
+    Output(state, out);
+    PROFILE_LAP(PROFILE_EULER, mark);
+}
+
+void FusionMahony_Update(FUSION_QUAT_STATE *state, const IMU_FRAME *frame, FUSION_OUT *out)
+{
+    const float *q = state->q;
+    float gx = frame->gyro[0] * GYRO_RAD_PER_COUNT;
+    float gy = frame->gyro[1] * GYRO_RAD_PER_COUNT;
+    float gz = frame->gyro[2] * GYRO_RAD_PER_COUNT;
+    float a[3] = { frame->accel[0], frame->accel[1], frame->accel[2] };
+    float accSq = a[0]*a[0] + a[1]*a[1] + a[2]*a[2];
+    static const float noStep[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    float m[3];
+    PROFILE_START(mark);
+
+    Fusion_AccWindow(&state->window, (uint32)(MATH_SQRTF(accSq) + 0.5f), out);
+    PROFILE_LAP(PROFILE_WINDOW, mark);
+
+    if(AccelTrusted(state, a, accSq))
+    {
+        // Error between measured and estimated gravity, fed back through a PI controller
+        float vx = 2.0f * (q[1]*q[3] - q[0]*q[2]);
+        float vy = 2.0f * (q[0]*q[1] + q[2]*q[3]);
+        float vz = q[0]*q[0] - q[1]*q[1] - q[2]*q[2] + q[3]*q[3];
+        float ex, ey, ez;
+
+        ex = a[1]*vz - a[2]*vy;
+        ey = a[2]*vx - a[0]*vz;
+        ez = a[0]*vy - a[1]*vx;
+
+        if(MagUsable(frame, m))
+        {
+            // plus the error between measured and estimated field, the reference from the field itself
+            float hx, hy, bx, bz, wx, wy, wz;
+
+            if(!state->headed)
+            {
+                SeedHeading(state, m);
+            }
+
+            hx = 2.0f * (m[0] * (0.5f - q[2]*q[2] - q[3]*q[3]) + m[1] * (q[1]*q[2] - q[0]*q[3]) + m[2] * (q[1]*q[3] + q[0]*q[2]));
+            hy = 2.0f * (m[0] * (q[1]*q[2] + q[0]*q[3]) + m[1] * (0.5f - q[1]*q[1] - q[3]*q[3]) + m[2] * (q[2]*q[3] - q[0]*q[1]));
+            bx = MATH_SQRTF(hx*hx + hy*hy);
+            bz = 2.0f * (m[0] * (q[1]*q[3] - q[0]*q[2]) + m[1] * (q[2]*q[3] + q[0]*q[1]) + m[2] * (0.5f - q[1]*q[1] - q[2]*q[2]));
+
+            wx = 2.0f * (bx * (0.5f - q[2]*q[2] - q[3]*q[3]) + bz * (q[1]*q[3] - q[0]*q[2]));
+            wy = 2.0f * (bx * (q[1]*q[2] - q[0]*q[3]) + bz * (q[0]*q[1] + q[2]*q[3]));
+            wz = 2.0f * (bx * (q[0]*q[2] + q[1]*q[3]) + bz * (0.5f - q[1]*q[1] - q[2]*q[2]));
+
+            ex += m[1]*wz - m[2]*wy;
+            ey += m[2]*wx - m[0]*wz;
+            ez += m[0]*wy - m[1]*wx;
+        }
+
+        state->integral[0] += FUSION_MAHONY_KI * ex * SAMPLE_PERIOD;
+        state->integral[1] += FUSION_MAHONY_KI * ey * SAMPLE_PERIOD;
+        state->integral[2] += FUSION_MAHONY_KI * ez * SAMPLE_PERIOD;
+
+        gx += FUSION_MAHONY_KP * ex + state->integral[0];
+        gy += FUSION_MAHONY_KP * ey + state->integral[1];
+        gz += FUSION_MAHONY_KP * ez + state->integral[2];
+    }
+    else
+    {
+        gx += state->integral[0];           // keep the learned gyro bias while the accel is not trusted
+        gy += state->integral[1];
+        gz += state->integral[2];
+    }
+
+    Integrate(state, gx, gy, gz, noStep, 0.0f);
+    PROFILE_LAP(PROFILE_QUAT, mark);
+    Output(state, out);
+    PROFILE_LAP(PROFILE_EULER, mark);
+}
+
+void FusionQuat_Euler(const FUSION_QUAT_STATE *state, float *roll, float *pitch, float *yaw)
+{
+    // Aerospace sequence Euler angles in degrees, only for telemetry and debugging
+    const float *q = state->q;
+    float sinp = 2.0f * (q[0]*q[2] - q[3]*q[1]);
+
+    sinp = (sinp > 1.0f) ? 1.0f : ((sinp < -1.0f) ? -1.0f : sinp);
+
+    *roll = MATH_ATAN2F(2.0f * (q[0]*q[1] + q[2]*q[3]), 1.0f - 2.0f * (q[1]*q[1] + q[2]*q[2])) * RAD_TO_DEG;
+    *pitch = MATH_ASINF(sinp) * RAD_TO_DEG;
+    *yaw = MATH_ATAN2F(2.0f * (q[0]*q[3] + q[1]*q[2]), 1.0f - 2.0f * (q[2]*q[2] + q[3]*q[3])) * RAD_TO_DEG;
+}
+
+/* [] END OF FILE */
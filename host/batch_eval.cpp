@@ -0,0 +1,522 @@
+/* ========================================
+ *
+ * Copyright YOUR COMPANY, THE YEAR
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CONFIDENTIAL AND PROPRIETARY INFORMATION
+ * WHICH IS THE PROPERTY OF your company.
+ *
+ * ========================================
+*/
+
+/*
+    Runs the fusion and detection core over a whole collection of recorded
+    traces and scores the detections against labels, to re-check every field
+    recording after an algorithm change.
+
+    Arguments are traces (trace.h) or directories, searched recursively for
+    .csv, .txt, .imul and .bin. Every trace is memory mapped (Trace_Map) and
+    goes through a fresh fusion filter and detector exactly like replay.
+
+    One trace is one task. The tasks are sorted largest first and dealt round
+    robin onto one deque per thread. A thread takes from the back of its own
+    deque and, once that is empty, steals from the front of the others where
+    the smallest ones wait, so a thread that drew a long recording does not
+    hold up the rest. Each
+    result goes into the slot of its trace and the slots are summed after the
+    join, the deque locks once per trace are the only shared writes.
+
+    --labels names the real falls, CSV lines
+        trace,t_us
+    with the fall onset in the trace's time, trace the path as given or its
+    file name, one line per fall. Traces without a line are fall-free. A
+    detection is the first DETECT_FIRE of a confirmed free fall
+    (DETECT_STATE.falls), later ones in the same fall after a DETECT_CLEAR
+    are counted as re-fires. A detection from --early ms before to --window
+    ms after an onset not matched yet is a true positive, its latency
+    detection - onset. Other detections are false positives, onsets without a
+    detection are missed. Without --labels only the detections are counted.
+    The labels file itself is skipped when it sits in a searched directory.
+
+    --per-trace writes one line per trace:
+        trace,samples,detections,refires,true,false,missed,latency_ms
+
+    The tasks share nothing but the deques, so the throughput should grow with
+    the cores until the disk or the page cache cannot keep up. So far it has
+    only run on a single-core machine, where --threads 1 and --threads 4 gave
+    the same metrics and the same time: 64 synthetic traces (2.1 * 10^5
+    samples, 151 labeled drops) in ~0.1 s, ~2 * 10^6 samples/s with the float
+    path, parsing included. Measure the scaling on a multi-core host before
+    relying on it.
+
+    usage: batch_eval [--fixed|--madgwick|--mahony] [--threads N] [--labels labels.csv]
+                      [--early ms] [--window ms] [--per-trace out.csv] trace|dir...
+*/
+
+#include "trace.h"
+
+extern "C" {
+#include "detect.h"
+#include "fusion.h"
+}
+
+#undef M_PI
+#undef dt
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+struct TraceResult
+{
+    bool ok = false;
+    std::string error;
+    size_t samples = 0;
+    uint32 detections = 0;
+    uint32 refires = 0;             // actuator on again within the same fall
+    uint32 truePos = 0;
+    uint32 falsePos = 0;
+    uint32 missed = 0;
+    std::vector<double> latencyMs;
+    uint32 falls = 0;               // DETECT_STATE counters at the end of the trace
+    uint32 falseOnsets = 0;
+    uint32 impacts = 0;
+    uint32 inactive = 0;
+};
+
+struct Task
+{
+    std::string path;
+    uintmax_t size;
+};
+
+// One per thread: the owner pops at the back, thieves take from the front
+class StealQueue
+{
+public:
+    void Push(size_t task)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        tasks.push_back(task);
+    }
+
+    bool Pop(size_t &task)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if(tasks.empty())
+        {
+            return false;
+        }
+        task = tasks.back();
+        tasks.pop_back();
+        return true;
+    }
+
+    bool Steal(size_t &task)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if(tasks.empty())
+        {
+            return false;
+        }
+        task = tasks.front();
+        tasks.pop_front();
+        return true;
+    }
+
+private:
+    std::mutex mutex;
+    std::deque<size_t> tasks;
+};
+
+struct Options
+{
+    const char *path = "float";
+    double earlyMs = 100.0;
+    double windowMs = 1000.0;
+    std::unordered_map<std::string, std::vector<double>> labels;   // onsets in us
+};
+
+template <typename STATE>
+static void Detect(const std::vector<IMU_FRAME> &frames, std::vector<double> &detections, TraceResult &r,
+                   DETECT_STATE &detector, void (*init)(STATE *), void (*update)(STATE *, const IMU_FRAME *, FUSION_OUT *))
+{
+    STATE fusion;
+    FUSION_OUT fused;
+    uint32 detectedFall = 0;        // DETECT_STATE.falls of the last detection, a fire needs a confirmed fall first
+
+    init(&fusion);
+    Detect_Init(&detector);
+    for(const IMU_FRAME &f : frames)
+    {
+        uint8 wasFiring = detector.actuator;
+
+        update(&fusion, &f, &fused);
+        if(Detect_Update(&detector, &fused) == DETECT_FIRE && !wasFiring)
+        {
+            if(detector.falls != detectedFall)
+            {
+                detections.push_back((double)f.timestamp);
+                detectedFall = detector.falls;
+            }
+            else
+            {
+                r.refires++;
+            }
+        }
+    }
+}
+
+static const std::vector<double> *Labels(const Options &o, const std::string &path)
+{
+    auto it = o.labels.find(path);
+    if(it == o.labels.end())
+    {
+        it = o.labels.find(std::filesystem::path(path).filename().string());
+    }
+    return (it != o.labels.end()) ? &it->second : nullptr;
+}
+
+static void Evaluate(const Options &o, const Task &task, TraceResult &r)
+{
+    std::vector<IMU_FRAME> frames;
+    std::vector<double> detections;
+    DETECT_STATE detector;
+
+    if(!Trace_Map(task.path, frames, r.error))
+    {
+        return;
+    }
+
+    if(std::strcmp(o.path, "fixed") == 0)
+    {
+        Detect<FUSION_FIXED_STATE>(frames, detections, r, detector, FusionFixed_Init, FusionFixed_Update);
+    }
+    else if(std::strcmp(o.path, "madgwick") == 0)
+    {
+        Detect<FUSION_QUAT_STATE>(frames, detections, r, detector, FusionQuat_Init, FusionMadgwick_Update);
+    }
+    else if(std::strcmp(o.path, "mahony") == 0)
+    {
+        Detect<FUSION_QUAT_STATE>(frames, detections, r, detector, FusionQuat_Init, FusionMahony_Update);
+    }
+    else
+    {
+        Detect<FUSION_FLOAT_STATE>(frames, detections, r, detector, FusionFloat_Init, FusionFloat_Update);
+    }
+
+    r.ok = true;
+    r.samples = frames.size();
+    r.detections = (uint32)detections.size();
+    r.falls = detector.falls;
+    r.falseOnsets = detector.falseOnsets;
+    r.impacts = detector.impacts;
+    r.inactive = detector.inactive;
+
+    // every onset takes the first free detection in its window, both lists are in time order
+    const std::vector<double> *onsets = Labels(o, task.path);
+    std::vector<bool> used(detections.size(), false);
+
+    if(onsets != nullptr)
+    {
+        for(double onset : *onsets)
+        {
+            size_t d = 0;
+
+            while(d < detections.size() && (used[d] || detections[d] < onset - o.earlyMs * 1000.0))
+            {
+                d++;
+            }
+            if(d < detections.size() && detections[d] <= onset + o.windowMs * 1000.0)
+            {
+                used[d] = true;
+                r.truePos++;
+                r.latencyMs.push_back((detections[d] - onset) / 1000.0);
+            }
+            else
+            {
+                r.missed++;
+            }
+        }
+    }
+    r.falsePos = r.detections - r.truePos;
+}
+
+static bool IsTrace(const std::filesystem::path &p)
+{
+    std::string ext = p.extension().string();
+    return ext == ".csv" || ext == ".txt" || ext == ".imul" || ext == ".bin";
+}
+
+static bool LoadLabels(const char *path, Options &o)
+{
+    std::ifstream in(path);
+    std::string line;
+
+    if(!in)
+    {
+        return false;
+    }
+    while(std::getline(in, line))
+    {
+        size_t comma = line.rfind(',');
+
+        if(line.empty() || line[0] == '#' || comma == std::string::npos)
+        {
+            continue;
+        }
+        char *end;
+        double onset = std::strtod(line.c_str() + comma + 1, &end);
+        if(end == line.c_str() + comma + 1)
+        {
+            continue;                   // header
+        }
+        o.labels[line.substr(0, comma)].push_back(onset);
+    }
+    for(auto &l : o.labels)
+    {
+        std::sort(l.second.begin(), l.second.end());
+    }
+    return true;
+}
+
+static double Percentile(const std::vector<double> &sorted, double p)
+{
+    return sorted.empty() ? 0.0 : sorted[(size_t)(p * (double)(sorted.size() - 1) + 0.5)];
+}
+
+static void Usage(void)
+{
+    std::fprintf(stderr, "usage: batch_eval [--fixed|--madgwick|--mahony] [--threads N] [--labels labels.csv]\n"
+                         "                  [--early ms] [--window ms] [--per-trace out.csv] trace|dir...\n");
+    std::exit(2);
+}
+
+int main(int argc, char **argv)
+{
+    Options o;
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    const char *labelsPath = nullptr;
+    const char *perTracePath = nullptr;
+    std::vector<Task> tasks;
+
+    for(int i = 1; i < argc; i++)
+    {
+        if(std::strcmp(argv[i], "--fixed") == 0 || std::strcmp(argv[i], "--madgwick") == 0 ||
+           std::strcmp(argv[i], "--mahony") == 0)
+        {
+            o.path = argv[i] + 2;
+        }
+        else if(std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc)     threads = (unsigned)std::strtoul(argv[++i], nullptr, 10);
+        else if(std::strcmp(argv[i], "--labels") == 0 && i + 1 < argc)      labelsPath = argv[++i];
+        else if(std::strcmp(argv[i], "--early") == 0 && i + 1 < argc)       o.earlyMs = std::strtod(argv[++i], nullptr);
+        else if(std::strcmp(argv[i], "--window") == 0 && i + 1 < argc)      o.windowMs = std::strtod(argv[++i], nullptr);
+        else if(std::strcmp(argv[i], "--per-trace") == 0 && i + 1 < argc)   perTracePath = argv[++i];
+        else if(argv[i][0] == '-')
+        {
+            Usage();
+        }
+        else
+        {
+            std::error_code ec;
+            std::filesystem::path p(argv[i]);
+
+            if(std::filesystem::is_directory(p, ec))
+            {
+                std::vector<std::filesystem::path> found;
+                for(const auto &e : std::filesystem::recursive_directory_iterator(p, ec))
+                {
+                    if(e.is_regular_file() && IsTrace(e.path()))
+                    {
+                        found.push_back(e.path());
+                    }
+                }
+                std::sort(found.begin(), found.end());
+                for(const auto &f : found)
+                {
+                    tasks.push_back({ f.string(), std::filesystem::file_size(f, ec) });
+                }
+            }
+            else
+            {
+                tasks.push_back({ p.string(), std::filesystem::file_size(p, ec) });
+            }
+        }
+    }
+    if(tasks.empty() || threads == 0 || o.earlyMs < 0.0 || o.windowMs < 0.0)
+    {
+        Usage();
+    }
+    if(labelsPath != nullptr && !LoadLabels(labelsPath, o))
+    {
+        std::fprintf(stderr, "batch_eval: cannot read %s\n", labelsPath);
+        return 1;
+    }
+    if(labelsPath != nullptr)
+    {
+        std::error_code ec;
+        tasks.erase(std::remove_if(tasks.begin(), tasks.end(), [&](const Task &t)
+                    { return std::filesystem::equivalent(t.path, labelsPath, ec); }), tasks.end());
+    }
+    if(tasks.empty())
+    {
+        Usage();
+    }
+    threads = std::min(threads, (unsigned)tasks.size());
+
+    // largest first, dealt round robin so every thread starts with its share of the big ones
+    std::vector<size_t> order(tasks.size());
+    for(size_t t = 0; t < order.size(); t++)
+    {
+        order[t] = t;
+    }
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return tasks[a].size > tasks[b].size; });
+
+    std::vector<StealQueue> queues(threads);
+    for(size_t k = order.size(); k-- > 0; )
+    {
+        queues[k % threads].Push(order[k]);     // pushed smallest first, popped from the back
+    }
+
+    std::vector<TraceResult> results(tasks.size());
+    std::vector<size_t> steals(threads, 0);
+    auto start = std::chrono::steady_clock::now();
+
+    auto worker = [&](unsigned self)
+    {
+        size_t t;
+
+        for(;;)
+        {
+            bool got = queues[self].Pop(t);
+
+            for(unsigned k = 1; !got && k < threads; k++)
+            {
+                got = queues[(self + k) % threads].Steal(t);
+                steals[self] += got;
+            }
+            if(!got)
+            {
+                return;                 // nothing is queued after the start, all deques are empty
+            }
+            Evaluate(o, tasks[t], results[t]);
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for(unsigned i = 1; i < threads; i++)
+    {
+        pool.emplace_back(worker, i);
+    }
+    worker(0);
+    for(std::thread &th : pool)
+    {
+        th.join();
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    TraceResult total;
+    size_t failed = 0;
+    size_t stolen = 0;
+
+    for(size_t i = 0; i < results.size(); i++)
+    {
+        const TraceResult &r = results[i];
+
+        if(!r.ok)
+        {
+            std::fprintf(stderr, "batch_eval: %s: %s\n", tasks[i].path.c_str(), r.error.c_str());
+            failed++;
+            continue;
+        }
+        total.samples += r.samples;
+        total.detections += r.detections;
+        total.refires += r.refires;
+        total.truePos += r.truePos;
+        total.falsePos += r.falsePos;
+        total.missed += r.missed;
+        total.falls += r.falls;
+        total.falseOnsets += r.falseOnsets;
+        total.impacts += r.impacts;
+        total.inactive += r.inactive;
+        total.latencyMs.insert(total.latencyMs.end(), r.latencyMs.begin(), r.latencyMs.end());
+    }
+    for(size_t s : steals)
+    {
+        stolen += s;
+    }
+    std::sort(total.latencyMs.begin(), total.latencyMs.end());
+
+    if(perTracePath != nullptr)
+    {
+        FILE *f = std::fopen(perTracePath, "w");
+        if(f == nullptr)
+        {
+            std::fprintf(stderr, "batch_eval: cannot write %s\n", perTracePath);
+            return 1;
+        }
+        std::fprintf(f, "trace,samples,detections,refires,true,false,missed,latency_ms\n");
+        for(size_t i = 0; i < results.size(); i++)
+        {
+            const TraceResult &r = results[i];
+            double sum = 0.0;
+
+            for(double l : r.latencyMs)
+            {
+                sum += l;
+            }
+            std::fprintf(f, "%s,%zu,%u,%u,%u,%u,%u,", tasks[i].path.c_str(), r.samples, r.detections, r.refires,
+                         r.truePos, r.falsePos, r.missed);
+            if(r.latencyMs.empty())
+            {
+                std::fprintf(f, "\n");
+            }
+            else
+            {
+                std::fprintf(f, "%.1f\n", sum / (double)r.latencyMs.size());
+            }
+        }
+        std::fclose(f);
+    }
+
+    double mean = 0.0;
+    for(double l : total.latencyMs)
+    {
+        mean += l;
+    }
+    mean = total.latencyMs.empty() ? 0.0 : mean / (double)total.latencyMs.size();
+
+    std::printf("traces      %zu (%zu failed), %zu samples, %s path\n", tasks.size(), failed, total.samples, o.path);
+    std::printf("time        %u threads, %.3f s, %.3g samples/s, %zu tasks stolen\n",
+                threads, seconds, seconds > 0.0 ? (double)total.samples / seconds : 0.0, stolen);
+    std::printf("detections  %u, %u re-fires within the same fall\n", total.detections, total.refires);
+    if(labelsPath != nullptr)
+    {
+        unsigned labelled = total.truePos + total.missed;
+
+        std::printf("labels      %u falls: %u detected, %u missed, %u false detections\n",
+                    labelled, total.truePos, total.missed, total.falsePos);
+        std::printf("            precision %.3f, recall %.3f\n",
+                    total.detections ? (double)total.truePos / total.detections : 0.0,
+                    labelled ? (double)total.truePos / labelled : 0.0);
+        std::printf("latency ms  mean %.1f, p50 %.1f, p95 %.1f, max %.1f\n", mean,
+                    Percentile(total.latencyMs, 0.5), Percentile(total.latencyMs, 0.95),
+                    total.latencyMs.empty() ? 0.0 : total.latencyMs.back());
+    }
+    std::printf("detector    %u falls, %u false onsets, %u impacts, %u inactive\n",
+                total.falls, total.falseOnsets, total.impacts, total.inactive);
+
+    return failed != 0;
+}
+
+/* [] END OF FILE */
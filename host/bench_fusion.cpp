@@ -0,0 +1,501 @@
+/* ========================================
+ *
+ * Copyright YOUR COMPANY, THE YEAR
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CONFIDENTIAL AND PROPRIETARY INFORMATION
+ * WHICH IS THE PROPERTY OF your company.
+ *
+ * ========================================
+*/
+
+/*
+    Runs every fusion estimator over synthetic motion with a known attitude and
+    reports host time per sample and tilt error against the truth.
+
+    The truth quaternion is integrated from a known body rate at 1 kHz. The
+    frames are generated at 100 Hz with the firmware scaling (16384 LSB/g,
+    32.8 LSB/dps, 0.15 uT/LSB), gyro bias and noise, accel noise and linear
+    acceleration, and a 48 uT field at 60 deg inclination as the calibrated
+    magnetometer (hard-iron removed) would see it:
+
+        static      resting at 30/-20 deg tilt
+        sway        +-60 deg at 0.3-0.5 Hz, small linear acceleration
+        carry       +-30 deg with 0.3 g of walking/carrying acceleration
+        fall        rest, 0.5 s free fall tumbling at 200 dps, impact, rest
+
+    Tilt error is roll/pitch (rollQ16/pitchQ16) against the angles of the true
+    gravity vector, the quantity the accel formulas in fusion.c estimate. lim is
+    the rollLim/pitchLim error against the truth. dec agree is the fraction of
+    frames where Detect_Update decides the same as with the true rollLim/pitchLim
+    (and the estimator's own accLim). yaw rms is the heading error of the output
+    quaternion against the truth, north being the horizontal part of the field.
+
+    One run on x86-64, gcc -O2, seed 1, 10^5 frames per scenario:
+
+        scenario  estimator ns/sample  rms deg  max deg  lim rms  yaw rms  dec agree
+        static    float         193.0     0.66      2.5      1.2     14.6     1.0000
+                  fixed         396.6     0.66      2.5      1.2     14.6     1.0000
+                  madgwick      186.3     0.10      0.4      0.6      0.3     1.0000
+                  mahony        163.2     0.08      0.7      0.5      0.2     1.0000
+        sway      float         252.1     1.46      5.4      6.3     64.2     1.0000
+                  fixed         512.6     1.46      5.4      6.3     64.2     1.0000
+                  madgwick      202.5     0.81      2.8      5.6      1.5     1.0000
+                  mahony        174.5     0.45      1.7      4.8      1.4     1.0000
+        carry     float         242.5     9.88     23.2      9.3     26.4     1.0000
+                  fixed         435.7     9.88     23.2      9.3     26.4     1.0000
+                  madgwick      151.3     1.12      3.8      1.2      2.2     1.0000
+                  mahony        132.3     1.08      2.6      1.1      0.5     1.0000
+        fall      float         251.0    19.15    151.4     30.5     11.0     0.9396
+                  fixed         378.9    19.15    151.4     30.5     11.0     0.9396
+                  madgwick      130.5     0.31      2.0      0.6      0.3     1.0000
+                  mahony        112.6     0.32      1.2      0.4      0.3     1.0000
+
+    With --no-mag the quaternion estimators keep their tilt numbers, but yaw
+    integrates the 0.3 dps gyro z bias: 48 to 118 deg rms over the 1000 s.
+
+    The reference scales the gyro by dt/1000, so it is in effect accel only and
+    follows every linear acceleration. In free fall its angles are noise, which
+    is where the detector decides differently. The large lim rms in sway is the
+    180 - |angle| fold near horizontal, where any estimator flips a frame early
+    or late. ns/sample only ranks the estimators on a machine with an FPU; on
+    the M3 everything float is soft-float and the cycle counts come from
+    FUSION_COMPARE in main.c.
+
+    --fixed-error compares the fixed-point path with the float reference
+    instead, the error bound in fusion.h comes from it. Per pattern the max
+    roll/pitch and quaternion component difference, the share of frames with
+    rollLim/pitchLim off by one and by more, the largest lim difference and
+    the share of frames where accLim differs.
+
+    usage: bench_fusion [--frames N] [--seed S] [--no-mag]
+           bench_fusion --fixed-error [--seed S]
+*/
+
+extern "C" {
+#include "detect.h"
+#include "fixmath.h"
+#include "fusion.h"
+}
+
+#undef M_PI         // main.h has its own 3.14, <cmath> brings the real one
+#undef dt           // and dt would replace every identifier of that name
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#define SIM_RATE_HZ         (100)       // frame rate, the firmware dt
+#define SIM_SUBSTEPS        (10)        // truth integration steps per frame
+#define ACCEL_LSB_PER_G     ACCELEROMETER_SENSITIVITY   // the full-scale ranges of main.h
+#define GYRO_LSB_PER_DPS    GYROSCOPE_SENSITIVITY
+#define MAG_LSB_PER_UT      (1.0 / 0.15)
+#define MAG_FIELD_UT        (48.0)
+#define MAG_INCLINATION     (60.0)      // deg, field points down into the ground
+#define DEG                 (3.14159265358979323846 / 180.0)
+
+struct Quat
+{
+    double w, x, y, z;
+};
+
+struct Sample
+{
+    IMU_FRAME frame;
+    double roll;        // truth, deg
+    double pitch;
+    double yaw;
+    int32 rollLim;      // truth rollLim/pitchLim as the detector sees them
+    int32 pitchLim;
+};
+
+struct Motion
+{
+    double rate[3];     // body rate, rad/s
+    double lin[3];      // linear acceleration, g, world frame
+    bool freeFall;
+};
+
+static Quat Multiply(const Quat &a, const Quat &b)
+{
+    return { a.w*b.w - a.x*b.x - a.y*b.y - a.z*b.z,
+             a.w*b.x + a.x*b.w + a.y*b.z - a.z*b.y,
+             a.w*b.y - a.x*b.z + a.y*b.w + a.z*b.x,
+             a.w*b.z + a.x*b.y - a.y*b.x + a.z*b.w };
+}
+
+static Quat FromEuler(double roll, double pitch)
+{
+    Quat qx = { std::cos(roll / 2), std::sin(roll / 2), 0, 0 };
+    Quat qy = { std::cos(pitch / 2), 0, std::sin(pitch / 2), 0 };
+    return Multiply(qx, qy);
+}
+
+static void BodyFromWorld(const Quat &q, const double *v, double *out)
+{
+    // R(q)^T v, same convention as the estimators: q rotates body into world
+    double r[3][3] = {
+        { 1 - 2*(q.y*q.y + q.z*q.z), 2*(q.x*q.y - q.w*q.z),     2*(q.x*q.z + q.w*q.y) },
+        { 2*(q.x*q.y + q.w*q.z),     1 - 2*(q.x*q.x + q.z*q.z), 2*(q.y*q.z - q.w*q.x) },
+        { 2*(q.x*q.z - q.w*q.y),     2*(q.y*q.z + q.w*q.x),     1 - 2*(q.x*q.x + q.y*q.y) } };
+
+    for(int i = 0; i < 3; i++)
+    {
+        out[i] = r[0][i]*v[0] + r[1][i]*v[1] + r[2][i]*v[2];
+    }
+}
+
+static double YawOf(double w, double x, double y, double z)
+{
+    return std::atan2(2 * (w*z + x*y), 1 - 2 * (y*y + z*z)) / DEG;
+}
+
+static int16 Clamp16(double v)
+{
+    v = std::nearbyint(v);
+    return (int16)(v > 32767 ? 32767 : (v < -32768 ? -32768 : v));
+}
+
+static int32 LimOf(double angle, bool upsideDown)
+{
+    int32 lim = (int32)std::fabs(angle);
+    return upsideDown ? 180 - lim : lim;
+}
+
+static bool magSim = true;     // --no-mag: frames without magnetometer, 6-DoF as before
+
+template <typename PROFILE>
+static std::vector<Sample> Simulate(long frames, unsigned seed, Quat q, PROFILE profile)
+{
+    std::mt19937 rng(seed);
+    std::normal_distribution<double> unit(0.0, 1.0);
+    const double gyroBias[3] = { 0.6 * DEG, -0.4 * DEG, 0.3 * DEG };    // rad/s, typical after turn-on
+    const double gyroNoise = 0.05 * DEG;                                // rad/s rms, 100 Hz bandwidth
+    const double accelNoise = 0.008;                                    // g rms
+    const double magNoise = 0.6 * MAG_LSB_PER_UT;                       // counts rms
+    const double field[3] = { MAG_FIELD_UT * std::cos(MAG_INCLINATION * DEG), 0,
+                              -MAG_FIELD_UT * std::sin(MAG_INCLINATION * DEG) };
+    const double h = 1.0 / (SIM_RATE_HZ * SIM_SUBSTEPS);
+    std::vector<Sample> out((size_t)frames);
+
+    for(long n = 0; n < frames; n++)
+    {
+        double t = (double)n / SIM_RATE_HZ;
+        Motion m = profile(t);
+        double specific[3], body[3], up[3], mag[3];
+        const double zUp[3] = { 0, 0, 1 };
+
+        for(int s = 0; s < SIM_SUBSTEPS; s++)
+        {
+            Quat w = { 0, m.rate[0] * h / 2, m.rate[1] * h / 2, m.rate[2] * h / 2 };
+            Quat d = Multiply(q, w);
+            double norm;
+
+            q = { q.w + d.w, q.x + d.x, q.y + d.y, q.z + d.z };
+            norm = std::sqrt(q.w*q.w + q.x*q.x + q.y*q.y + q.z*q.z);
+            q = { q.w / norm, q.x / norm, q.y / norm, q.z / norm };
+        }
+
+        // accelerometer measures specific force: gravity reaction plus linear acceleration, nothing in free fall
+        for(int i = 0; i < 3; i++)
+        {
+            specific[i] = m.freeFall ? 0.0 : zUp[i] + m.lin[i];
+        }
+        BodyFromWorld(q, specific, body);
+        BodyFromWorld(q, zUp, up);
+        BodyFromWorld(q, field, mag);
+
+        IMU_FRAME &f = out[(size_t)n].frame;
+        f.timestamp = (uint32)(n * (1000000 / SIM_RATE_HZ));
+        f.seq = (uint32)n;
+        f.temp = 0;
+        for(int i = 0; i < 3; i++)
+        {
+            f.accel[i] = Clamp16((body[i] + accelNoise * unit(rng)) * ACCEL_LSB_PER_G);
+            f.gyro[i] = Clamp16((m.rate[i] + gyroBias[i] + gyroNoise * unit(rng)) / DEG * GYRO_LSB_PER_DPS);
+            f.mag[i] = Clamp16(mag[i] * MAG_LSB_PER_UT + magNoise * unit(rng));
+        }
+        f.magValid = magSim ? 1 : 0;
+        if(!magSim)
+        {
+            f.mag[0] = f.mag[1] = f.mag[2] = 0;
+        }
+
+        Sample &s = out[(size_t)n];
+        s.roll = -std::asin(std::fmax(-1.0, std::fmin(1.0, up[0]))) / DEG;
+        s.pitch = std::asin(std::fmax(-1.0, std::fmin(1.0, up[1]))) / DEG;
+        s.yaw = YawOf(q.w, q.x, q.y, q.z);
+        s.rollLim = LimOf(s.roll, up[2] < 0);
+        s.pitchLim = LimOf(s.pitch, up[2] < 0);
+    }
+
+    return out;
+}
+
+struct Result
+{
+    double nsPerSample;
+    double rms;
+    double max;
+    double limRms;
+    double yawRms;
+    double agree;
+};
+
+template <typename STATE>
+static Result Run(const std::vector<Sample> &samples,
+                  void (*init)(STATE *), void (*update)(STATE *, const IMU_FRAME *, FUSION_OUT *))
+{
+    Result r = { 0, 0, 0, 0, 0, 0 };
+    std::vector<FUSION_OUT> out(samples.size());
+    STATE state;
+    DETECT_STATE detector, truthDetector;
+    const int passes = 5;
+
+    // timing pass first, best of a few so a scheduler hiccup does not count
+    for(int p = 0; p < passes; p++)
+    {
+        init(&state);
+        auto start = std::chrono::steady_clock::now();
+        for(size_t i = 0; i < samples.size(); i++)
+        {
+            update(&state, &samples[i].frame, &out[i]);
+        }
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        ns /= (double)samples.size();
+        if(p == 0 || ns < r.nsPerSample)
+        {
+            r.nsPerSample = ns;
+        }
+    }
+
+    Detect_Init(&detector);
+    Detect_Init(&truthDetector);
+    double sq = 0, limSq = 0, yawSq = 0;
+    size_t same = 0;
+    size_t settled = (size_t)SIM_RATE_HZ;      // first second is start-up transient for every filter
+
+    for(size_t i = 0; i < samples.size(); i++)
+    {
+        // same accLim, true rollLim/pitchLim: what the detector should have decided
+        FUSION_OUT truth = out[i];
+        truth.rollLim = samples[i].rollLim;
+        truth.pitchLim = samples[i].pitchLim;
+        same += (Detect_Update(&detector, &out[i]) == Detect_Update(&truthDetector, &truth));
+
+        if(i < settled)
+        {
+            continue;
+        }
+
+        double er = out[i].rollQ16 / (double)FIX_Q16_ONE - samples[i].roll;
+        double ep = out[i].pitchQ16 / (double)FIX_Q16_ONE - samples[i].pitch;
+        double el = (double)(out[i].rollLim - samples[i].rollLim);
+        double em = (double)(out[i].pitchLim - samples[i].pitchLim);
+        const int32 *qo = out[i].quat;
+        double ey = std::remainder(YawOf(qo[0] / (double)FIX_Q30_ONE, qo[1] / (double)FIX_Q30_ONE,
+                                         qo[2] / (double)FIX_Q30_ONE, qo[3] / (double)FIX_Q30_ONE) - samples[i].yaw, 360.0);
+
+        sq += er*er + ep*ep;
+        limSq += el*el + em*em;
+        yawSq += ey*ey;
+        r.max = std::fmax(r.max, std::fmax(std::fabs(er), std::fabs(ep)));
+    }
+
+    size_t n = (samples.size() > settled) ? samples.size() - settled : 1;
+    r.rms = std::sqrt(sq / (2.0 * (double)n));
+    r.limRms = std::sqrt(limSq / (2.0 * (double)n));
+    r.yawRms = std::sqrt(yawSq / (double)n);
+    r.agree = (double)same / (double)samples.size();
+
+    return r;
+}
+
+static void Report(const char *scenario, const std::vector<Sample> &samples)
+{
+    struct Estimator
+    {
+        const char *name;
+        Result result;
+    };
+
+    Estimator est[] = {
+        { "float",    Run<FUSION_FLOAT_STATE>(samples, FusionFloat_Init, FusionFloat_Update) },
+        { "fixed",    Run<FUSION_FIXED_STATE>(samples, FusionFixed_Init, FusionFixed_Update) },
+        { "madgwick", Run<FUSION_QUAT_STATE>(samples, FusionQuat_Init, FusionMadgwick_Update) },
+        { "mahony",   Run<FUSION_QUAT_STATE>(samples, FusionQuat_Init, FusionMahony_Update) },
+    };
+
+    for(const Estimator &e : est)
+    {
+        std::printf("%-9s %-9s %9.1f %8.2f %8.1f %8.1f %8.1f %10.4f\n",
+                    (&e == &est[0]) ? scenario : "", e.name, e.result.nsPerSample, e.result.rms,
+                    e.result.max, e.result.limRms, e.result.yawRms, e.result.agree);
+    }
+}
+
+static void FixedError(const char *pattern, unsigned seed)
+{
+    /*
+        --fixed-error: the fixed-point path against the float reference on the
+        same frames, 10 sequences of 10^5 frames from a fresh state each.
+        "uniform" is uniform random int16 accel and gyro, "walk" a random walk
+        of accel within +-20000 and gyro within +-3000 counts with a 30 frame
+        free-fall burst every 5000 frames.
+    */
+
+    const int sequences = 10;
+    const int length = 100000;
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> full(-32768, 32767);
+    std::uniform_int_distribution<int> accStep(-300, 300);
+    std::uniform_int_distribution<int> gyroStep(-50, 50);
+    bool uniform = (std::strcmp(pattern, "uniform") == 0);
+    double angleMax = 0, quatMax = 0;
+    long frames = 0, limOne = 0, limMore = 0, accDiff = 0;
+    int limMax = 0;
+
+    for(int s = 0; s < sequences; s++)
+    {
+        FUSION_FLOAT_STATE ref;
+        FUSION_FIXED_STATE fix;
+        IMU_FRAME f;
+        int acc[3] = { 0, 0, 16384 }, gyro[3] = { 0, 0, 0 };
+
+        std::memset(&f, 0, sizeof(f));
+        FusionFloat_Init(&ref);
+        FusionFixed_Init(&fix);
+
+        for(int i = 0; i < length; i++)
+        {
+            FUSION_OUT a, b;
+
+            for(int k = 0; k < 3; k++)
+            {
+                if(uniform)
+                {
+                    f.accel[k] = (int16)full(rng);
+                    f.gyro[k] = (int16)full(rng);
+                }
+                else
+                {
+                    acc[k] = std::min(20000, std::max(-20000, acc[k] + accStep(rng)));
+                    gyro[k] = std::min(3000, std::max(-3000, gyro[k] + gyroStep(rng)));
+                    f.accel[k] = (int16)((i % 5000 < 30) ? accStep(rng) : acc[k]);
+                    f.gyro[k] = (int16)gyro[k];
+                }
+            }
+
+            FusionFloat_Update(&ref, &f, &a);
+            FusionFixed_Update(&fix, &f, &b);
+            frames++;
+
+            angleMax = std::fmax(angleMax, std::fabs((a.rollQ16 - b.rollQ16) / (double)FIX_Q16_ONE));
+            angleMax = std::fmax(angleMax, std::fabs((a.pitchQ16 - b.pitchQ16) / (double)FIX_Q16_ONE));
+            for(int k = 0; k < 4; k++)
+            {
+                quatMax = std::fmax(quatMax, std::fabs((a.quat[k] - (double)b.quat[k]) / FIX_Q30_ONE));
+            }
+
+            int lim = std::max(std::abs(a.rollLim - b.rollLim), std::abs(a.pitchLim - b.pitchLim));
+            limOne += (lim == 1);
+            limMore += (lim > 1);
+            limMax = std::max(limMax, lim);
+            accDiff += (a.accLim != b.accLim);
+        }
+    }
+
+    std::printf("%-9s %8ld %11.4f %9.1e %9.3f %9.1e %8d %9.1e\n", pattern, frames, angleMax, quatMax,
+                100.0 * limOne / frames, (double)limMore / frames, limMax, (double)accDiff / frames);
+}
+
+static void Usage(void)
+{
+    std::fprintf(stderr, "usage: bench_fusion [--frames N] [--seed S] [--no-mag]\n"
+                         "       bench_fusion --fixed-error [--seed S]\n");
+    std::exit(2);
+}
+
+int main(int argc, char **argv)
+{
+    long frames = 100000;
+    unsigned seed = 1;
+    bool fixedError = false;
+
+    for(int i = 1; i < argc; i++)
+    {
+        if(std::strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+        {
+            frames = std::strtol(argv[++i], nullptr, 10);
+        }
+        else if(std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+        {
+            seed = (unsigned)std::strtoul(argv[++i], nullptr, 10);
+        }
+        else if(std::strcmp(argv[i], "--no-mag") == 0)
+        {
+            magSim = false;
+        }
+        else if(std::strcmp(argv[i], "--fixed-error") == 0)
+        {
+            fixedError = true;
+        }
+        else
+        {
+            Usage();
+        }
+    }
+    if(frames < 2 * SIM_RATE_HZ)
+    {
+        Usage();
+    }
+
+    if(fixedError)
+    {
+        std::printf("%-9s %8s %11s %9s %9s %9s %8s %9s\n", "pattern", "frames", "angle deg", "quat", "lim+-1 %", "lim>1", "lim max", "accLim");
+        FixedError("uniform", seed);
+        FixedError("walk", seed);
+        return 0;
+    }
+
+    std::printf("%-9s %-9s %9s %8s %8s %8s %8s %10s\n", "scenario", "estimator", "ns/sample", "rms deg", "max deg", "lim rms", "yaw rms", "dec agree");
+
+    Report("static", Simulate(frames, seed, FromEuler(30 * DEG, -20 * DEG), [](double) {
+        return Motion{ { 0, 0, 0 }, { 0, 0, 0 }, false };
+    }));
+
+    Report("sway", Simulate(frames, seed, FromEuler(0, 0), [](double t) {
+        // angle amplitude 60 deg -> rate amplitude 60 deg * 2 pi f
+        return Motion{ { 60 * DEG * 2 * M_PI * 0.5 * std::cos(2 * M_PI * 0.5 * t),
+                         60 * DEG * 2 * M_PI * 0.3 * std::cos(2 * M_PI * 0.3 * t), 0.2 * std::sin(0.7 * t) },
+                       { 0.02 * std::sin(2 * M_PI * 1.1 * t), 0.02 * std::cos(2 * M_PI * 0.9 * t), 0 }, false };
+    }));
+
+    Report("carry", Simulate(frames, seed, FromEuler(0, 0), [](double t) {
+        return Motion{ { 30 * DEG * 2 * M_PI * 0.2 * std::cos(2 * M_PI * 0.2 * t),
+                         30 * DEG * 2 * M_PI * 0.15 * std::cos(2 * M_PI * 0.15 * t), 0 },
+                       { 0.3 * std::sin(2 * M_PI * 1.8 * t), 0.15 * std::sin(2 * M_PI * 0.9 * t), 0.3 * std::sin(2 * M_PI * 3.6 * t) },
+                       false };
+    }));
+
+    Report("fall", Simulate(frames, seed, FromEuler(10 * DEG, 5 * DEG), [](double t) {
+        // 4 s cycle: 2 s rest, 0.5 s tumbling free fall, 50 ms impact, rest
+        double c = std::fmod(t, 4.0);
+        bool falling = (c >= 2.0 && c < 2.5);
+        bool impact = (c >= 2.5 && c < 2.55);
+        double tumble = falling ? 200 * DEG : 0;
+        double ret = (c >= 2.55 && c < 3.05) ? -200 * DEG : 0;       // rotate back so the cycle repeats
+        return Motion{ { tumble + ret, 0.5 * (tumble + ret), 0 }, { 0, 0, impact ? 6.0 : 0 }, falling };
+    }));
+
+    return 0;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,225 @@
+/* ========================================
+ *
+ * Copyright YOUR COMPANY, THE YEAR
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CONFIDENTIAL AND PROPRIETARY INFORMATION
+ * WHICH IS THE PROPERTY OF your company.
+ *
+ * ========================================
+*/
+
+/*
+    Feeds still and moving sample streams through Calib_Update (calib.c, built
+    with HOST_BUILD: no flash, the records start empty) and checks when the
+    first still period completes.
+
+    Without traces it runs built-in cases of 30 s at 100 Hz with gaussian
+    sensor noise, a gyro bias of (12, -7, 3) and an accel offset of
+    (80, -40, 120) counts on a level device:
+
+        still           --noise accel counts rms (default 39, about the
+                        MPU-9250 datasheet noise at +-2 g) and 2.6 gyro
+                        counts rms
+        still x2        twice that noise
+        vibration       still plus 0.02 g at 23 Hz on every axis, within
+                        CALIB_STILL_ACC max - min but not within CALIB_STILL_SD
+        carried         still plus 0.3 g at 1 Hz, beyond CALIB_STILL_ACC
+        upside down     still, resting on its back (z at -1 g)
+
+    The still cases must calibrate, with the bias and offsets within four
+    standard errors of the mean of one still period. Upside down must
+    calibrate the gyro bias only, the accel offsets stay unmeasured. The
+    others must not calibrate. With traces every one of them must calibrate,
+    so pass recordings of a device at rest. Exit status 1 when any
+    expectation fails.
+
+    One run, seed 1:
+
+        case          first s  periods  noisy  gyroOff          accOff
+        still            2.00       15      0    12   -7    3     79  -39  119
+        still x2         2.00       15      0    12   -7    3     83  -35  118
+        vibration       never        0      9     0    0    0      0    0    0
+        carried         never        0      0     0    0    0      0    0    0
+        upside down      2.00       15      0    12   -7    3      0    0    0
+
+    usage: calib_check [--noise COUNTS] [--seed S] [trace ...]
+*/
+
+#include "trace.h"
+
+extern "C" {
+#include "calib.h"
+}
+
+#undef M_PI         // main.h has its own 3.14, <cmath> brings the real one
+#undef dt           // and dt would replace every identifier of that name
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+
+#define CHECK_RATE_HZ   (100u)
+#define CHECK_SECONDS   (30u)
+#define CHECK_GYRO_RMS  (2.6)
+
+static const int gyroBias[3] = { 12, -7, 3 };
+static const int accOffset[3] = { 80, -40, 120 };
+
+struct Result
+{
+    double firstS;              // time of the first estimate, < 0 for never
+    uint32 periods;
+    uint32 noisy;
+};
+
+static Result Run(const std::vector<IMU_FRAME> &frames)
+{
+    Result r = { -1.0, 0, 0 };
+
+    memset(&calibStats, 0, sizeof(calibStats));
+    Calib_Init();
+
+    for(size_t n = 0; n < frames.size(); n++)
+    {
+        IMU_FRAME f = frames[n];
+
+        if(Calib_Update(0u, &f))
+        {
+            Calib_Save();
+        }
+        if(r.firstS < 0.0 && calibStats.state[0] == CALIB_MEASURED)
+        {
+            r.firstS = (double)(f.timestamp - frames[0].timestamp) / 1e6 + 1.0 / CHECK_RATE_HZ;
+        }
+    }
+    r.periods = calibStats.stillPeriods;
+    r.noisy = calibStats.noisyPeriods;
+
+    return r;
+}
+
+static std::vector<IMU_FRAME> Generate(std::mt19937 &rng, double accRms, double vibG, double vibHz, double zG = 1.0)
+{
+    std::normal_distribution<double> gauss(0.0, 1.0);
+    std::vector<IMU_FRAME> frames(CHECK_RATE_HZ * CHECK_SECONDS);
+
+    for(size_t n = 0; n < frames.size(); n++)
+    {
+        IMU_FRAME &f = frames[n];
+        double t = (double)n / CHECK_RATE_HZ;
+        double vib = vibG * MPU_ACCEL_LSB_PER_G * sin(2.0 * 3.14159265358979 * vibHz * t);
+
+        memset(&f, 0, sizeof(f));
+        f.timestamp = (uint32)(n * TRACE_PERIOD_US);
+        f.seq = (uint32)n;
+        for(int i = 0; i < 3; i++)
+        {
+            double g = (i == 2) ? zG * MPU_ACCEL_LSB_PER_G : 0.0;
+
+            f.accel[i] = (int16)lround(g + accOffset[i] + vib + accRms * gauss(rng));
+            f.gyro[i] = (int16)lround(gyroBias[i] + CHECK_GYRO_RMS * gauss(rng));
+        }
+    }
+
+    return frames;
+}
+
+static bool Report(const char *name, const Result &r, bool expectCal, double accRms, bool expectAccel = true)
+{
+    /*
+        accRms > 0: the offsets must be within 4 standard errors of the mean of
+        one still period. Without expectAccel the accel offsets must not have
+        been measured at all.
+    */
+    bool ok = (r.firstS >= 0.0) == expectCal;
+    double accTol = 4.0 * accRms / sqrt((double)CALIB_SAMPLES) + 1.0;
+    double gyroTol = 4.0 * CHECK_GYRO_RMS / sqrt((double)CALIB_SAMPLES) + 1.0;
+    char first[16];
+
+    if(ok && expectCal && accRms > 0.0)
+    {
+        ok = (expectAccel == ((calib[0].flags & CALIB_FLAG_ACCEL) != 0u));
+        for(int i = 0; i < 3; i++)
+        {
+            ok = ok && abs(calib[0].gyroOff[i] - gyroBias[i]) <= gyroTol &&
+                 (expectAccel ? abs(calib[0].accOff[i] - accOffset[i]) <= accTol : calib[0].accOff[i] == 0);
+        }
+    }
+
+    if(r.firstS < 0.0)
+    {
+        snprintf(first, sizeof(first), "never");
+    }
+    else
+    {
+        snprintf(first, sizeof(first), "%.2f", r.firstS);
+    }
+    printf("%-12s %8s %8u %6u  %4d %4d %4d  %5d %4d %4d  %s\n", name, first, (unsigned)r.periods, (unsigned)r.noisy,
+           calib[0].gyroOff[0], calib[0].gyroOff[1], calib[0].gyroOff[2],
+           calib[0].accOff[0], calib[0].accOff[1], calib[0].accOff[2], ok ? "ok" : "FAIL");
+
+    return ok;
+}
+
+int main(int argc, char **argv)
+{
+    double noise = 39.0;
+    unsigned seed = 1;
+    std::vector<std::string> traces;
+    bool ok = true;
+
+    for(int a = 1; a < argc; a++)
+    {
+        if(!strcmp(argv[a], "--noise") && a + 1 < argc)
+        {
+            noise = atof(argv[++a]);
+        }
+        else if(!strcmp(argv[a], "--seed") && a + 1 < argc)
+        {
+            seed = (unsigned)strtoul(argv[++a], NULL, 0);
+        }
+        else if(argv[a][0] == '-')
+        {
+            fprintf(stderr, "usage: calib_check [--noise COUNTS] [--seed S] [trace ...]\n");
+            return 2;
+        }
+        else
+        {
+            traces.push_back(argv[a]);
+        }
+    }
+
+    printf("%-12s %8s %8s %6s  %-14s  %-14s\n", "case", "first s", "periods", "noisy", "gyroOff", "accOff");
+
+    if(traces.empty())
+    {
+        std::mt19937 rng(seed);
+
+        ok &= Report("still", Run(Generate(rng, noise, 0.0, 0.0)), true, noise);
+        ok &= Report("still x2", Run(Generate(rng, 2.0 * noise, 0.0, 0.0)), true, 2.0 * noise);
+        ok &= Report("vibration", Run(Generate(rng, noise, 0.02, 23.0)), false, 0.0);
+        ok &= Report("carried", Run(Generate(rng, noise, 0.3, 1.0)), false, 0.0);
+        ok &= Report("upside down", Run(Generate(rng, noise, 0.0, 0.0, -1.0)), true, noise, false);
+    }
+
+    for(const std::string &path : traces)
+    {
+        std::vector<IMU_FRAME> frames;
+        std::string error;
+
+        if(!Trace_Load(path, frames, error) || frames.empty())
+        {
+            fprintf(stderr, "%s: %s\n", path.c_str(), error.empty() ? "no samples" : error.c_str());
+            return 2;
+        }
+        ok &= Report(path.c_str(), Run(frames), true, 0.0);
+    }
+
+    return ok ? 0 : 1;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,571 @@
+/* ========================================
+ *
+ * Copyright YOUR COMPANY, THE YEAR
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CONFIDENTIAL AND PROPRIETARY INFORMATION
+ * WHICH IS THE PROPERTY OF your company.
+ *
+ * ========================================
+*/
+
+/*
+    Drop simulator for parameter sweeps, the Freefall.m model for a whole grid
+    of scenarios at once:
+
+        dv/dt = g - k v^2 / m,  dh/dt = -v,  k = 0.5 cw rho A
+
+    Every combination of mass, height, area and cw is one scenario. Scenarios
+    are integrated SIMD_LANES at a time in SIMD registers (GCC/Clang vector
+    extensions), a lane stops when it reaches the ground while the others go
+    on. Batches are handed out to the threads from an atomic counter.
+
+    The impact time is interpolated linearly between the last two steps like
+    gen_impact. The closed form with drag
+
+        t = vt/g acosh(exp(h0 g / vt^2)),  vt = sqrt(m g / k)
+
+    is reported next to it, and the worst deviation goes to stderr, so the
+    step size can be chosen per method.
+
+    Output, one row per scenario in grid order (mass outermost, cw innermost):
+        CSV     mass,height,area,cw,t_impact,v_impact,t_exact
+        binary  "DSIM", uint32 version 1, uint32 rows, uint32 columns (7),
+                then rows * columns little endian doubles in the CSV order
+
+    A range is start:stop:count, a single value is one point.
+
+    --detect also samples every scenario at the firmware rate and runs the
+    samples through the detector (detect.c, impact.c) for a device held
+    upright: 1 g before the release, the drag deceleration c v^2 while falling
+    (the accelerometer reads the specific force, gravity does not show), 3 g at
+    the ground. --glitch ms replaces the sample that far into the fall by one
+    at 0.4 g, between DETECT_FALL_ACC and DETECT_FALL_EXIT_ACC, a single noisy
+    sample that does not end the fall. Reported is the margin from the
+    actuator being deployed, IMPACT_ACTUATOR_LEAD_MS after it was switched on,
+    to the impact. drop_sim exits with 1 when a deployment comes after the
+    impact. The noisy sample in the onset, for the default scenarios:
+
+        drop_sim --detect --glitch 20
+        ...  impact 319.22 ms ...  actuator on 134 ms, deployed 10.22 ms before impact
+        ...  impact 320.21 ms ...  actuator on 134 ms, deployed 11.21 ms before impact
+
+    the same as without --glitch. With the fall time restarted by the noisy
+    sample the actuator went on at 164 ms and deployed ~19 ms after the impact.
+    Drops from below the design height of impact_table.h hit the ground
+    earlier than the table allows for and are late with or without noise.
+
+    usage: drop_sim [--mass r] [--height r] [--area r] [--cw r] [--rho x] [--g x]
+                    [--dt s] [--euler|--rk4] [--threads n] [--scalar]
+                    [--detect [--glitch ms]] [-o out.(csv|bin)]
+*/
+
+extern "C" {
+#include "detect.h"
+}
+
+#undef M_PI
+#undef dt
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define SIMD_LANES      (4)
+#define RESULT_COLUMNS  (7)
+
+typedef double  VDouble __attribute__((vector_size(SIMD_LANES * sizeof(double))));
+typedef int64_t VMask   __attribute__((vector_size(SIMD_LANES * sizeof(int64_t))));
+
+struct Range
+{
+    double start = 0.0;
+    double stop = 0.0;
+    unsigned count = 1;
+
+    double At(unsigned i) const
+    {
+        return (count < 2) ? start : start + (stop - start) * i / (count - 1);
+    }
+};
+
+struct Sweep
+{
+    Range mass, height, area, cw;
+    double rho = 1.225;         // kg/m^3
+    double g = 9.82;            // m/s^2
+    double step = 1e-4;         // s
+    bool rk4 = false;
+    bool detect = false;
+    double glitchMs = -1.0;     // fall time of the noisy sample, none when negative
+};
+
+struct Result
+{
+    double mass, height, area, cw;
+    double tImpact, vImpact, tExact;
+};
+
+struct Detection
+{
+    bool fired = false;
+    uint32_t onMs = 0;          // actuator switched on, from the release
+    double marginMs = 0.0;      // deployed before the impact, negative when after it
+};
+
+static double ExactImpact(const Sweep &s, const Result &r)
+{
+    double k = 0.5 * r.cw * s.rho * r.area;
+    double vt = std::sqrt(r.mass * s.g / k);
+
+    return vt / s.g * std::acosh(std::exp(r.height * s.g / (vt * vt)));
+}
+
+/***************************************
+*     Scalar reference, --scalar
+****************************************/
+
+static void Derivative(double c, double g, double v, double &dh, double &dv)
+{
+    dh = -v;
+    dv = g - c * v * v;
+}
+
+static void IntegrateScalar(const Sweep &s, Result &r)
+{
+    double c = 0.5 * r.cw * s.rho * r.area / r.mass;    // k / m
+    double h = r.height;
+    double v = 0.0;
+    double t = 0.0;
+
+    for(;;)
+    {
+        double hNext, vNext;
+
+        if(s.rk4)
+        {
+            double dh1, dv1, dh2, dv2, dh3, dv3, dh4, dv4;
+
+            Derivative(c, s.g, v, dh1, dv1);
+            Derivative(c, s.g, v + 0.5 * s.step * dv1, dh2, dv2);
+            Derivative(c, s.g, v + 0.5 * s.step * dv2, dh3, dv3);
+            Derivative(c, s.g, v + s.step * dv3, dh4, dv4);
+            hNext = h + s.step / 6.0 * (dh1 + 2.0 * dh2 + 2.0 * dh3 + dh4);
+            vNext = v + s.step / 6.0 * (dv1 + 2.0 * dv2 + 2.0 * dv3 + dv4);
+        }
+        else
+        {
+            hNext = h - v * s.step;
+            vNext = v + s.step * (s.g - c * v * v);
+        }
+
+        if(hNext <= 0.0)
+        {
+            double frac = h / (h - hNext);
+
+            r.tImpact = t + frac * s.step;
+            r.vImpact = v + frac * (vNext - v);
+            return;
+        }
+
+        h = hNext;
+        v = vNext;
+        t += s.step;
+    }
+}
+
+/***************************************
+*     Detector on the sampled fall, --detect
+****************************************/
+
+static void DetectScenario(const Sweep &s, const Result &r, Detection &d)
+{
+    const double countsPerMs2 = MPU_ACCEL_LSB_PER_G / s.g;
+    double c = 0.5 * r.cw * s.rho * r.area / r.mass;
+    double h = r.height;
+    double v = 0.0;
+    double t = 0.0;
+    DETECT_STATE detector;
+    FUSION_OUT out;
+
+    std::memset(&out, 0, sizeof(out));
+    Detect_Init(&detector);
+
+    for(uint32_t sample = 0; ; sample++)
+    {
+        uint32_t fallMs = sample * DETECT_FRAME_MS;
+        double acc;
+
+        // Euler or RK4 like the sweep, up to the sample time
+        while(h > 0.0 && t < fallMs / 1000.0)
+        {
+            if(s.rk4)
+            {
+                double dh1, dv1, dh2, dv2, dh3, dv3, dh4, dv4;
+
+                Derivative(c, s.g, v, dh1, dv1);
+                Derivative(c, s.g, v + 0.5 * s.step * dv1, dh2, dv2);
+                Derivative(c, s.g, v + 0.5 * s.step * dv2, dh3, dv3);
+                Derivative(c, s.g, v + s.step * dv3, dh4, dv4);
+                h += s.step / 6.0 * (dh1 + 2.0 * dh2 + 2.0 * dh3 + dh4);
+                v += s.step / 6.0 * (dv1 + 2.0 * dv2 + 2.0 * dv3 + dv4);
+            }
+            else
+            {
+                h -= v * s.step;
+                v += s.step * (s.g - c * v * v);
+            }
+            t += s.step;
+        }
+
+        if(h <= 0.0)
+        {
+            acc = 3.0 * MPU_ACCEL_LSB_PER_G;
+        }
+        else if(s.glitchMs >= 0.0 && std::fabs(fallMs - s.glitchMs) < DETECT_FRAME_MS / 2.0)
+        {
+            acc = 0.4 * MPU_ACCEL_LSB_PER_G;
+        }
+        else
+        {
+            acc = c * v * v * countsPerMs2;
+        }
+
+        out.accNow = out.accMean = out.accMin = out.accMax = (int32)std::lround(acc);
+
+        if(Detect_Update(&detector, &out) == DETECT_FIRE && !d.fired)
+        {
+            d.fired = true;
+            d.onMs = fallMs + detector.fireDelayMs;
+            d.marginMs = r.tImpact * 1000.0 - (d.onMs + IMPACT_ACTUATOR_LEAD_MS);
+        }
+        if(h <= 0.0)
+        {
+            return;
+        }
+    }
+}
+
+/***************************************
+*   SIMD_LANES scenarios per batch
+****************************************/
+
+static VDouble Splat(double x)
+{
+    VDouble v;
+
+    for(int i = 0; i < SIMD_LANES; i++)
+    {
+        v[i] = x;
+    }
+    return v;
+}
+
+static VDouble Select(VMask mask, VDouble a, VDouble b)
+{
+    // a where mask is set, b elsewhere, without a branch per lane
+    VMask bits = (mask & (VMask)a) | (~mask & (VMask)b);
+
+    return (VDouble)bits;
+}
+
+static bool Any(VMask mask)
+{
+    int64_t bits = 0;
+
+    for(int i = 0; i < SIMD_LANES; i++)
+    {
+        bits |= mask[i];
+    }
+    return bits != 0;
+}
+
+static void IntegrateBatch(const Sweep &s, Result *r, int lanes)
+{
+    VDouble c, h, v, tImpact, vImpact;
+    VDouble g = Splat(s.g);
+    VDouble step = Splat(s.step);
+    VDouble half = Splat(0.5 * s.step);
+    VDouble sixth = Splat(s.step / 6.0);
+    VDouble zero = Splat(0.0);
+    double t = 0.0;
+
+    for(int i = 0; i < SIMD_LANES; i++)
+    {
+        const Result &lane = r[(i < lanes) ? i : 0];    // unused lanes repeat the first scenario
+
+        c[i] = 0.5 * lane.cw * s.rho * lane.area / lane.mass;
+        h[i] = lane.height;
+    }
+    v = zero;
+    tImpact = zero;
+    vImpact = zero;
+
+    VMask falling = h > zero;
+
+    while(Any(falling))
+    {
+        VDouble hNext, vNext;
+
+        if(s.rk4)
+        {
+            VDouble dv1 = g - c * v * v;
+            VDouble v2 = v + half * dv1;
+            VDouble dv2 = g - c * v2 * v2;
+            VDouble v3 = v + half * dv2;
+            VDouble dv3 = g - c * v3 * v3;
+            VDouble v4 = v + step * dv3;
+            VDouble dv4 = g - c * v4 * v4;
+
+            hNext = h - sixth * (v + 2.0 * v2 + 2.0 * v3 + v4);
+            vNext = v + sixth * (dv1 + 2.0 * dv2 + 2.0 * dv3 + dv4);
+        }
+        else
+        {
+            hNext = h - v * step;
+            vNext = v + step * (g - c * v * v);
+        }
+
+        VMask landed = falling & (hNext <= zero);
+        VDouble frac = h / (h - hNext);
+
+        tImpact = Select(landed, Splat(t) + frac * step, tImpact);
+        vImpact = Select(landed, v + frac * (vNext - v), vImpact);
+
+        falling &= ~landed;
+        h = Select(falling, hNext, h);
+        v = Select(falling, vNext, v);
+        t += s.step;
+    }
+
+    for(int i = 0; i < lanes; i++)
+    {
+        r[i].tImpact = tImpact[i];
+        r[i].vImpact = vImpact[i];
+    }
+}
+
+/***************************************
+*            Command line
+****************************************/
+
+static void Usage(void)
+{
+    std::fprintf(stderr, "usage: drop_sim [--mass r] [--height r] [--area r] [--cw r] [--rho x] [--g x] [--dt s]\n"
+                         "                [--euler|--rk4] [--threads n] [--scalar] [--detect [--glitch ms]] [-o out.(csv|bin)]\n"
+                         "       r is start:stop:count or a single value\n");
+    std::exit(2);
+}
+
+static Range ParseRange(const char *text)
+{
+    Range r;
+    char *end;
+
+    r.start = std::strtod(text, &end);
+    r.stop = r.start;
+    if(*end == ':')
+    {
+        r.stop = std::strtod(end + 1, &end);
+        if(*end != ':')
+        {
+            Usage();
+        }
+        r.count = (unsigned)std::strtoul(end + 1, &end, 10);
+    }
+    if(*end != '\0' || r.count == 0 || r.start <= 0.0 || r.stop <= 0.0)
+    {
+        Usage();
+    }
+    return r;
+}
+
+static bool WriteResults(const char *path, const std::vector<Result> &results)
+{
+    size_t len = std::strlen(path);
+    bool binary = len > 4 && std::strcmp(path + len - 4, ".bin") == 0;
+    FILE *f = std::fopen(path, "wb");
+
+    if(f == nullptr)
+    {
+        return false;
+    }
+
+    if(binary)
+    {
+        uint32_t header[3] = { 1u, (uint32_t)results.size(), RESULT_COLUMNS };
+
+        std::fwrite("DSIM", 1, 4, f);
+        std::fwrite(header, sizeof(header), 1, f);
+        std::fwrite(results.data(), sizeof(Result), results.size(), f);
+    }
+    else
+    {
+        std::fprintf(f, "mass,height,area,cw,t_impact,v_impact,t_exact\n");
+        for(const Result &r : results)
+        {
+            std::fprintf(f, "%.6g,%.6g,%.6g,%.6g,%.9f,%.9f,%.9f\n",
+                         r.mass, r.height, r.area, r.cw, r.tImpact, r.vImpact, r.tExact);
+        }
+    }
+
+    return std::fclose(f) == 0;
+}
+
+int main(int argc, char **argv)
+{
+    Sweep s;
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    bool scalar = false;
+    const char *outPath = nullptr;
+
+    // Freefall.m
+    s.mass = ParseRange("0.197");
+    s.height = ParseRange("0.5");
+    s.area = ParseRange("0.00064:0.01201:2");
+    s.cw = ParseRange("1.05");
+
+    for(int i = 1; i < argc; i++)
+    {
+        bool hasValue = i + 1 < argc;
+
+        if(std::strcmp(argv[i], "--euler") == 0)                    s.rk4 = false;
+        else if(std::strcmp(argv[i], "--rk4") == 0)                 s.rk4 = true;
+        else if(std::strcmp(argv[i], "--scalar") == 0)              scalar = true;
+        else if(std::strcmp(argv[i], "--detect") == 0)              s.detect = true;
+        else if(!hasValue)                                          Usage();
+        else if(std::strcmp(argv[i], "--mass") == 0)                s.mass = ParseRange(argv[++i]);
+        else if(std::strcmp(argv[i], "--height") == 0)              s.height = ParseRange(argv[++i]);
+        else if(std::strcmp(argv[i], "--area") == 0)                s.area = ParseRange(argv[++i]);
+        else if(std::strcmp(argv[i], "--cw") == 0)                  s.cw = ParseRange(argv[++i]);
+        else if(std::strcmp(argv[i], "--rho") == 0)                 s.rho = std::strtod(argv[++i], nullptr);
+        else if(std::strcmp(argv[i], "--g") == 0)                   s.g = std::strtod(argv[++i], nullptr);
+        else if(std::strcmp(argv[i], "--dt") == 0)                  s.step = std::strtod(argv[++i], nullptr);
+        else if(std::strcmp(argv[i], "--threads") == 0)             threads = (unsigned)std::strtoul(argv[++i], nullptr, 10);
+        else if(std::strcmp(argv[i], "--glitch") == 0)              s.glitchMs = std::strtod(argv[++i], nullptr);
+        else if(std::strcmp(argv[i], "-o") == 0)                    outPath = argv[++i];
+        else                                                        Usage();
+    }
+    if(s.rho <= 0.0 || s.g <= 0.0 || s.step <= 0.0 || threads == 0 || (s.glitchMs >= 0.0 && !s.detect))
+    {
+        Usage();
+    }
+
+    std::vector<Result> results;
+    results.reserve((size_t)s.mass.count * s.height.count * s.area.count * s.cw.count);
+    for(unsigned a = 0; a < s.mass.count; a++)
+        for(unsigned b = 0; b < s.height.count; b++)
+            for(unsigned c = 0; c < s.area.count; c++)
+                for(unsigned d = 0; d < s.cw.count; d++)
+                {
+                    results.push_back({ s.mass.At(a), s.height.At(b), s.area.At(c), s.cw.At(d), 0.0, 0.0, 0.0 });
+                }
+
+    std::vector<Detection> detections(s.detect ? results.size() : 0);
+    size_t batches = (results.size() + SIMD_LANES - 1) / SIMD_LANES;
+    std::atomic<size_t> next(0);
+    auto start = std::chrono::steady_clock::now();
+
+    auto worker = [&]()
+    {
+        for(size_t b = next++; b < batches; b = next++)
+        {
+            size_t first = b * SIMD_LANES;
+            int lanes = (int)std::min<size_t>(SIMD_LANES, results.size() - first);
+
+            if(scalar)
+            {
+                for(int i = 0; i < lanes; i++)
+                {
+                    IntegrateScalar(s, results[first + i]);
+                }
+            }
+            else
+            {
+                IntegrateBatch(s, &results[first], lanes);
+            }
+            for(int i = 0; i < lanes && s.detect; i++)
+            {
+                DetectScenario(s, results[first + i], detections[first + i]);
+            }
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for(unsigned i = 1; i < threads; i++)
+    {
+        pool.emplace_back(worker);
+    }
+    worker();
+    for(std::thread &t : pool)
+    {
+        t.join();
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    double maxError = 0.0;
+
+    for(Result &r : results)
+    {
+        r.tExact = ExactImpact(s, r);
+        maxError = std::max(maxError, std::fabs(r.tImpact - r.tExact));
+    }
+
+    std::fprintf(stderr, "%zu scenarios, %s %s, dt %g s, %u threads: %.3f s, %.3g scenarios/s\n",
+                 results.size(), s.rk4 ? "rk4" : "euler", scalar ? "scalar" : "simd", s.step, threads,
+                 seconds, results.size() / seconds);
+    std::fprintf(stderr, "max |t_impact - t_exact| %.3g ms\n", maxError * 1000.0);
+
+    size_t fired = 0, late = 0;
+    for(const Detection &d : detections)
+    {
+        fired += d.fired;
+        late += d.fired && d.marginMs < 0.0;
+    }
+    if(s.detect)
+    {
+        std::fprintf(stderr, "detector: %zu of %zu fired, %zu deployed after the impact\n", fired, results.size(), late);
+    }
+
+    if(outPath != nullptr)
+    {
+        if(!WriteResults(outPath, results))
+        {
+            std::fprintf(stderr, "drop_sim: cannot write %s\n", outPath);
+            return 1;
+        }
+    }
+    else if(results.size() <= 16)
+    {
+        for(size_t i = 0; i < results.size(); i++)
+        {
+            const Result &r = results[i];
+
+            std::printf("m %.4g kg  h %.4g m  A %.4g m2  cw %.4g:  impact %.2f ms at %.3f m/s (exact %.2f ms)",
+                        r.mass, r.height, r.area, r.cw, r.tImpact * 1000.0, r.vImpact, r.tExact * 1000.0);
+            if(s.detect && detections[i].fired)
+            {
+                std::printf("  actuator on %u ms, deployed %.2f ms %s impact", (unsigned)detections[i].onMs,
+                            std::fabs(detections[i].marginMs), (detections[i].marginMs < 0.0) ? "after" : "before");
+            }
+            else if(s.detect)
+            {
+                std::printf("  not detected");
+            }
+            std::printf("\n");
+        }
+    }
+
+    return (late > 0) ? 1 : 0;
+}
+
+/* [] END OF FILE */
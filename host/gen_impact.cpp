@@ -0,0 +1,171 @@
+/* ========================================
+ *
+ * Copyright YOUR COMPANY, THE YEAR
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CONFIDENTIAL AND PROPRIETARY INFORMATION
+ * WHICH IS THE PROPERTY OF your company.
+ *
+ * ========================================
+*/
+
+/*
+    Generates impact_table.h, the time-to-impact tables the firmware schedules
+    the actuator from (impact.c).
+
+    Same model as Freefall.m: explicit Euler with quadratic drag
+
+        v += dt * (g - k v^2 / m),  h -= v dt,  k = 0.5 cw rho A
+
+    for the worst case (small cross-section, least drag, earliest impact) and
+    the best case (large cross-section). For every elapsed free-fall time in
+    steps of one sample period the table holds the time left until h reaches 0,
+    in ms, rounded down so the actuator is never late.
+
+    usage: gen_impact [--mass kg] [--area-small m2] [--area-large m2]
+                      [--height m] [--cw c] [--step-ms n] [-o impact_table.h]
+
+    Defaults are the Freefall.m values. make impact-table rewrites
+    ../impact_table.h with them.
+*/
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+struct Model
+{
+    double mass = 0.197;        // kg
+    double areaSmall = 0.00064; // m^2, worst case
+    double areaLarge = 0.01201; // m^2, best case
+    double height = 0.5;        // m
+    double cw = 1.05;
+    double rho = 1.225;         // kg/m^3
+    double g = 9.82;            // m/s^2
+    double step = 1e-4;         // s, Euler step of Freefall.m
+};
+
+static std::vector<double> Trajectory(const Model &m, double area)
+{
+    // h(t) at every Euler step until the ground is passed
+    double k = 0.5 * m.cw * m.rho * area;
+    double v = 0.0;
+    double h = m.height;
+    std::vector<double> heights;
+
+    heights.push_back(h);
+    while(h > 0.0)
+    {
+        double vNext = v + m.step * (m.g - k * v * v / m.mass);
+        h -= v * m.step;
+        v = vNext;
+        heights.push_back(h);
+    }
+
+    return heights;
+}
+
+static double ImpactTime(const Model &m, const std::vector<double> &h)
+{
+    // linear interpolation of the zero crossing between the last two steps
+    size_t n = h.size() - 1;
+    return (double)(n - 1) * m.step + m.step * h[n - 1] / (h[n - 1] - h[n]);
+}
+
+static void Usage(void)
+{
+    std::fprintf(stderr, "usage: gen_impact [--mass kg] [--area-small m2] [--area-large m2] [--height m] [--cw c] [--step-ms n] [-o file]\n");
+    std::exit(2);
+}
+
+int main(int argc, char **argv)
+{
+    Model m;
+    unsigned stepMs = 10;
+    const char *outPath = nullptr;
+
+    for(int i = 1; i < argc; i++)
+    {
+        double *target = nullptr;
+
+        if(i + 1 >= argc)
+        {
+            Usage();
+        }
+        if(std::strcmp(argv[i], "--mass") == 0)             target = &m.mass;
+        else if(std::strcmp(argv[i], "--area-small") == 0)  target = &m.areaSmall;
+        else if(std::strcmp(argv[i], "--area-large") == 0)  target = &m.areaLarge;
+        else if(std::strcmp(argv[i], "--height") == 0)      target = &m.height;
+        else if(std::strcmp(argv[i], "--cw") == 0)          target = &m.cw;
+        else if(std::strcmp(argv[i], "--step-ms") == 0)     stepMs = (unsigned)std::strtoul(argv[i + 1], nullptr, 10);
+        else if(std::strcmp(argv[i], "-o") == 0)            outPath = argv[i + 1];
+        else                                                Usage();
+
+        if(target != nullptr)
+        {
+            *target = std::strtod(argv[i + 1], nullptr);
+        }
+        i++;
+    }
+    if(m.mass <= 0 || m.areaSmall <= 0 || m.areaLarge <= 0 || m.height <= 0 || stepMs == 0)
+    {
+        Usage();
+    }
+
+    double worst = ImpactTime(m, Trajectory(m, m.areaSmall));
+    double best = ImpactTime(m, Trajectory(m, m.areaLarge));
+    unsigned entries = (unsigned)(std::fmax(worst, best) * 1000.0 / stepMs) + 1u;   // both tables end at 0
+
+    FILE *f = (outPath != nullptr) ? std::fopen(outPath, "wb") : stdout;
+    if(f == nullptr)
+    {
+        std::fprintf(stderr, "gen_impact: cannot write %s\n", outPath);
+        return 1;
+    }
+
+    // CRLF and the project header, like every other source in the firmware directory
+    std::fprintf(f, "/* ========================================\r\n *\r\n * Copyright YOUR COMPANY, THE YEAR\r\n"
+                    " * All Rights Reserved\r\n * UNPUBLISHED, LICENSED SOFTWARE.\r\n *\r\n"
+                    " * CONFIDENTIAL AND PROPRIETARY INFORMATION\r\n * WHICH IS THE PROPERTY OF your company.\r\n"
+                    " *\r\n * ========================================\r\n*/\r\n\r\n");
+    std::fprintf(f, "/*\r\n    Generated by host/gen_impact from the Freefall.m model, do not edit.\r\n\r\n");
+    std::fprintf(f, "    mass %.4g kg, height %.4g m, cw %.4g, rho %.4g kg/m3, g %.4g m/s2, Euler step %.4g s\r\n",
+                 m.mass, m.height, m.cw, m.rho, m.g, m.step);
+    std::fprintf(f, "    worst case A = %.6g m2: impact after %.1f ms\r\n", m.areaSmall, worst * 1000.0);
+    std::fprintf(f, "    best case  A = %.6g m2: impact after %.1f ms\r\n", m.areaLarge, best * 1000.0);
+    std::fprintf(f, "    drag free:                impact after %.1f ms\r\n\r\n", std::sqrt(2.0 * m.height / m.g) * 1000.0);
+    std::fprintf(f, "    impactWorstMs[i] / impactBestMs[i]: ms left until impact after i * IMPACT_STEP_MS\r\n"
+                    "    of free fall, rounded down.\r\n*/\r\n\r\n");
+    std::fprintf(f, "#if !defined(IMPACT_TABLE_H)\r\n#define IMPACT_TABLE_H\r\n\r\n#include \"imu_types.h\"\r\n\r\n");
+    std::fprintf(f, "#define IMPACT_STEP_MS      (%uu)\r\n", stepMs);
+    std::fprintf(f, "#define IMPACT_TABLE_LEN    (%uu)\r\n\r\n", entries);
+
+    const char *names[2] = { "impactWorstMs", "impactBestMs" };
+    const double impact[2] = { worst, best };
+
+    for(int table = 0; table < 2; table++)
+    {
+        std::fprintf(f, "static const uint16 %s[IMPACT_TABLE_LEN] =\r\n{", names[table]);
+        for(unsigned i = 0; i < entries; i++)
+        {
+            double left = impact[table] * 1000.0 - (double)(i * stepMs);
+            std::fprintf(f, "%s%s%4u", (i == 0) ? "" : ",", (i % 12 == 0) ? "\r\n    " : " ",
+                         (unsigned)((left > 0.0) ? std::floor(left) : 0.0));
+        }
+        std::fprintf(f, "\r\n};\r\n\r\n");
+    }
+
+    std::fprintf(f, "#endif\r\n\r\n/* [] END OF FILE */\r\n");
+
+    if(f != stdout)
+    {
+        std::fclose(f);
+    }
+
+    return 0;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,270 @@
+/* ========================================
+ *
+ * Copyright YOUR COMPANY, THE YEAR
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CONFIDENTIAL AND PROPRIETARY INFORMATION
+ * WHICH IS THE PROPERTY OF your company.
+ *
+ * ========================================
+*/
+
+/*
+    Compressed sample logs (imu_log.h) on the host.
+
+    encode  writes a trace (trace.h) as a .imul log, timestamps in us
+    decode  writes a log as CSV, one line per sample:
+                seq,t_us,ax,ay,az,gx,gy,gz,temp,mag,mx,my,mz
+    stats   encodes every trace, checks that the decoded samples match the
+            originals field by field, and reports per trace:
+                bytes/sample    of the log, keys included
+                ratio           raw MPU frame (14 bytes, 20 with the
+                                magnetometer) over the log, and the 58 byte
+                                telemetry sample packet over the log
+                ns/sample       host encode and decode, the best of
+                                --passes runs over the whole trace
+
+    The encode cost on the M3 is PROFILE_ENCODE (profile.h) with
+    TELEMETRY_COMPACT. There are no field recordings in the tree, these
+    numbers are from synthetic 100 Hz traces with the MPU-9250 datasheet
+    noise (accel 300 ug/sqrt(Hz) -> ~39 counts rms, gyro 0.01 dps/sqrt(Hz)
+    -> ~2.6 counts, 41 Hz DLPF, mag 2 counts): 60 s lying still, 60 s
+    carried around, and 10 drops of 3 s each. The CSV traces have no
+    temperature, so temp costs its minimum of one byte. One run on x86-64,
+    gcc -O2, --passes 20:
+
+        trace           samples  bytes/sample  ratio raw  ratio packet  enc ns  dec ns
+        still              6000         12.96       1.54          4.48    32.2    45.1
+        carried            6000         15.79       1.27          3.67    38.8    52.4
+        drops              3000         13.09       1.53          4.43    34.9    50.2
+        still, no mag      6000          9.99       1.40          5.81    35.8    46.2
+        carried, no mag    6000         12.82       1.09          4.53    34.7    46.4
+
+    Sensor noise sets the floor: every channel costs at least a byte, tag
+    and timestamp two more, and with ~55 counts of noise on the difference
+    of two accel samples a quarter of the accel deltas need a second byte.
+    The key every second adds 0.26. Against the raw frame that saves 10 to
+    35 %, the gain over the telemetry packet is mostly the fusion outputs
+    and seq that are not sent.
+
+    usage: imu_log encode trace out.imul
+           imu_log decode log.imul [out.csv]
+           imu_log stats [--passes N] trace...
+*/
+
+#include "trace.h"
+
+extern "C" {
+#include "imu_log.h"
+}
+
+#undef M_PI
+#undef dt
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#define PACKET_SIZE     (58.0)      // TELEMETRY_SAMPLE_SIZE
+
+static void Encode(const std::vector<IMU_FRAME> &frames, std::vector<uint8> &log)
+{
+    IMU_LOG_ENCODER enc;
+    uint8 record[IMU_LOG_MAX_RECORD];
+
+    ImuLog_InitEncoder(&enc);
+    log.clear();
+    for(const IMU_FRAME &f : frames)
+    {
+        uint16 len = ImuLog_Encode(&enc, record, &f);
+        log.insert(log.end(), record, record + len);
+    }
+}
+
+static bool Same(const IMU_FRAME &a, const IMU_FRAME &b)
+{
+    bool same = a.seq == b.seq && a.timestamp == b.timestamp && a.temp == b.temp && a.magValid == b.magValid;
+
+    for(int i = 0; i < 3; i++)
+    {
+        same = same && a.accel[i] == b.accel[i] && a.gyro[i] == b.gyro[i] && (!a.magValid || a.mag[i] == b.mag[i]);
+    }
+    return same;
+}
+
+static double BestNs(int passes, size_t samples, void (*run)(const void *), const void *arg)
+{
+    double best = 1e300;
+
+    for(int p = 0; p < passes; p++)
+    {
+        auto t0 = std::chrono::steady_clock::now();
+        run(arg);
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count();
+        best = (ns < best) ? ns : best;
+    }
+    return best / (double)samples;
+}
+
+static void EncodeOnly(const void *arg)
+{
+    static std::vector<uint8> log;
+    Encode(*(const std::vector<IMU_FRAME> *)arg, log);
+}
+
+static void DecodeOnly(const void *arg)
+{
+    static std::vector<IMU_FRAME> frames;
+    const std::vector<uint8> &log = *(const std::vector<uint8> *)arg;
+    std::string error;
+
+    frames.clear();
+    (void) Trace_ParseLog(log.data(), log.size(), frames, error);
+}
+
+static void Usage(void)
+{
+    std::fprintf(stderr, "usage: imu_log encode trace out.imul\n"
+                         "       imu_log decode log.imul [out.csv]\n"
+                         "       imu_log stats [--passes N] trace...\n");
+    std::exit(2);
+}
+
+static int Stats(int argc, char **argv)
+{
+    int passes = 5;
+    int failed = 0;
+
+    std::printf("trace                    samples  bytes/sample  ratio raw  ratio packet  enc ns  dec ns\n");
+    for(int i = 0; i < argc; i++)
+    {
+        if(std::strcmp(argv[i], "--passes") == 0 && i + 1 < argc)
+        {
+            passes = std::atoi(argv[++i]);
+            passes = (passes < 1) ? 1 : passes;
+            continue;
+        }
+
+        std::vector<IMU_FRAME> frames, decoded;
+        std::vector<uint8> log;
+        std::string error;
+
+        if(!Trace_Load(argv[i], frames, error) || frames.empty())
+        {
+            std::fprintf(stderr, "imu_log: %s: %s\n", argv[i], frames.empty() && error.empty() ? "no samples" : error.c_str());
+            failed = 1;
+            continue;
+        }
+
+        Encode(frames, log);
+        if(!Trace_ParseLog(log.data(), log.size(), decoded, error) || decoded.size() != frames.size())
+        {
+            std::fprintf(stderr, "imu_log: %s: decoded %zu of %zu samples %s\n", argv[i], decoded.size(), frames.size(), error.c_str());
+            failed = 1;
+            continue;
+        }
+        for(size_t k = 0; k < frames.size(); k++)
+        {
+            if(!Same(frames[k], decoded[k]))
+            {
+                std::fprintf(stderr, "imu_log: %s: sample %zu differs after decoding\n", argv[i], k);
+                failed = 1;
+                break;
+            }
+        }
+
+        double raw = 0.0;
+        for(const IMU_FRAME &f : frames)
+        {
+            raw += f.magValid ? 20.0 : 14.0;
+        }
+        double perSample = (double)log.size() / (double)frames.size();
+
+        std::printf("%-24s %7zu  %12.2f  %9.2f  %12.2f  %6.1f  %6.1f\n", argv[i], frames.size(), perSample,
+                    raw / (double)log.size(), PACKET_SIZE / perSample,
+                    BestNs(passes, frames.size(), EncodeOnly, &frames), BestNs(passes, frames.size(), DecodeOnly, &log));
+    }
+
+    return failed;
+}
+
+int main(int argc, char **argv)
+{
+    if(argc < 2)
+    {
+        Usage();
+    }
+
+    if(std::strcmp(argv[1], "stats") == 0)
+    {
+        return Stats(argc - 2, argv + 2);
+    }
+
+    if(std::strcmp(argv[1], "encode") == 0 && argc == 4)
+    {
+        std::vector<IMU_FRAME> frames;
+        std::vector<uint8> log;
+        std::string error;
+
+        if(!Trace_Load(argv[2], frames, error))
+        {
+            std::fprintf(stderr, "imu_log: %s: %s\n", argv[2], error.c_str());
+            return 1;
+        }
+        Encode(frames, log);
+
+        FILE *out = std::fopen(argv[3], "wb");
+        if(out == nullptr || std::fwrite(log.data(), 1, log.size(), out) != log.size())
+        {
+            std::fprintf(stderr, "imu_log: cannot write %s\n", argv[3]);
+            return 1;
+        }
+        std::fclose(out);
+        std::fprintf(stderr, "%zu samples, %zu bytes, %.2f bytes/sample\n", frames.size(), log.size(),
+                     frames.empty() ? 0.0 : (double)log.size() / (double)frames.size());
+        return 0;
+    }
+
+    if(std::strcmp(argv[1], "decode") == 0 && (argc == 3 || argc == 4))
+    {
+        std::vector<IMU_FRAME> frames;
+        std::string error;
+
+        if(!Trace_Load(argv[2], frames, error) && frames.empty())
+        {
+            std::fprintf(stderr, "imu_log: %s: %s\n", argv[2], error.c_str());
+            return 1;
+        }
+        if(!error.empty())
+        {
+            std::fprintf(stderr, "imu_log: %s: %s, %zu samples decoded\n", argv[2], error.c_str(), frames.size());
+        }
+
+        FILE *out = (argc == 4) ? std::fopen(argv[3], "w") : stdout;
+        if(out == nullptr)
+        {
+            std::fprintf(stderr, "imu_log: cannot write %s\n", argv[3]);
+            return 1;
+        }
+        std::fprintf(out, "seq,t_us,ax,ay,az,gx,gy,gz,temp,mag,mx,my,mz\n");
+        for(const IMU_FRAME &f : frames)
+        {
+            std::fprintf(out, "%u,%u,%d,%d,%d,%d,%d,%d,%d,%u,%d,%d,%d\n", f.seq, f.timestamp,
+                         f.accel[0], f.accel[1], f.accel[2], f.gyro[0], f.gyro[1], f.gyro[2], f.temp,
+                         f.magValid, f.mag[0], f.mag[1], f.mag[2]);
+        }
+        if(out != stdout)
+        {
+            std::fclose(out);
+        }
+        return 0;
+    }
+
+    Usage();
+    return 2;
+}
+
+/* [] END OF FILE */
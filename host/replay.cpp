@@ -0,0 +1,187 @@
+/* ========================================
+ *
+ * Copyright YOUR COMPANY, THE YEAR
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CONFIDENTIAL AND PROPRIETARY INFORMATION
+ * WHICH IS THE PROPERTY OF your company.
+ *
+ * ========================================
+*/
+
+/*
+    Replays a recorded IMU trace through the same fusion and detection code the
+    firmware runs, and writes one CSV line per sample:
+
+        seq,t_us,roll,pitch,q0,q1,q2,q3,accLim,rollLim,pitchLim,decision,actuator,state
+
+    roll/pitch are the 1st complementary stage (the estimated tilt for the
+    quaternion filters) in degrees, q0..q3 the normalized quaternion, decision is DETECT_HOLD/FIRE/CLEAR (0/1/2),
+    state the detector state after the sample (DETECT_IDLE..DETECT_INACTIVE, 0..4). The processing
+    throughput is reported on stderr, file reading and CSV output not included.
+
+    --fixed, --madgwick and --mahony select the estimator, default is the float
+    reference.
+
+    usage: replay [--fixed|--madgwick|--mahony] [--repeat N] [--quiet] trace [out.csv]
+*/
+
+#include "trace.h"
+
+extern "C" {
+#include "detect.h"
+#include "fixmath.h"
+#include "fusion.h"
+}
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+struct ReplayOut
+{
+    FUSION_OUT fused;
+    uint8 decision;
+    uint8 actuator;
+    uint8 state;
+};
+
+template <typename STATE>
+static void Run(const std::vector<IMU_FRAME> &frames, std::vector<ReplayOut> &out,
+                void (*init)(STATE *), void (*update)(STATE *, const IMU_FRAME *, FUSION_OUT *))
+{
+    STATE fusion;
+    DETECT_STATE detector;
+
+    init(&fusion);
+    Detect_Init(&detector);
+
+    for(size_t i = 0; i < frames.size(); i++)
+    {
+        update(&fusion, &frames[i], &out[i].fused);
+        out[i].decision = Detect_Update(&detector, &out[i].fused);
+        out[i].actuator = detector.actuator;
+        out[i].state = detector.state;
+    }
+}
+
+static void Usage(void)
+{
+    std::fprintf(stderr, "usage: replay [--fixed|--madgwick|--mahony] [--repeat N] [--quiet] trace.(csv|bin) [out.csv]\n");
+    std::exit(2);
+}
+
+int main(int argc, char **argv)
+{
+    const char *path = "float";
+    bool quiet = false;
+    long repeat = 1;
+    const char *tracePath = nullptr;
+    const char *outPath = nullptr;
+
+    for(int i = 1; i < argc; i++)
+    {
+        if(std::strcmp(argv[i], "--fixed") == 0 || std::strcmp(argv[i], "--madgwick") == 0 ||
+           std::strcmp(argv[i], "--mahony") == 0)
+        {
+            path = argv[i] + 2;
+        }
+        else if(std::strcmp(argv[i], "--quiet") == 0)
+        {
+            quiet = true;
+        }
+        else if(std::strcmp(argv[i], "--repeat") == 0 && i + 1 < argc)
+        {
+            repeat = std::strtol(argv[++i], nullptr, 10);
+        }
+        else if(argv[i][0] == '-')
+        {
+            Usage();
+        }
+        else if(tracePath == nullptr)
+        {
+            tracePath = argv[i];
+        }
+        else
+        {
+            outPath = argv[i];
+        }
+    }
+    if(tracePath == nullptr || repeat < 1)
+    {
+        Usage();
+    }
+
+    std::vector<IMU_FRAME> frames;
+    std::string error;
+    if(!Trace_Load(tracePath, frames, error))
+    {
+        std::fprintf(stderr, "replay: %s\n", error.c_str());
+        return 1;
+    }
+
+    std::vector<ReplayOut> out(frames.size());
+    auto start = std::chrono::steady_clock::now();
+
+    for(long r = 0; r < repeat; r++)
+    {
+        if(std::strcmp(path, "fixed") == 0)
+        {
+            Run<FUSION_FIXED_STATE>(frames, out, FusionFixed_Init, FusionFixed_Update);
+        }
+        else if(std::strcmp(path, "madgwick") == 0)
+        {
+            Run<FUSION_QUAT_STATE>(frames, out, FusionQuat_Init, FusionMadgwick_Update);
+        }
+        else if(std::strcmp(path, "mahony") == 0)
+        {
+            Run<FUSION_QUAT_STATE>(frames, out, FusionQuat_Init, FusionMahony_Update);
+        }
+        else
+        {
+            Run<FUSION_FLOAT_STATE>(frames, out, FusionFloat_Init, FusionFloat_Update);
+        }
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    double samples = (double)frames.size() * (double)repeat;
+
+    std::fprintf(stderr, "%s path: %.0f samples in %.3f s, %.3g samples/s\n",
+                 path, samples, seconds, seconds > 0 ? samples / seconds : 0.0);
+
+    if(quiet)
+    {
+        return 0;
+    }
+
+    FILE *f = (outPath != nullptr) ? std::fopen(outPath, "w") : stdout;
+    if(f == nullptr)
+    {
+        std::fprintf(stderr, "replay: cannot write %s\n", outPath);
+        return 1;
+    }
+
+    std::fprintf(f, "seq,t_us,roll,pitch,q0,q1,q2,q3,accLim,rollLim,pitchLim,decision,actuator,state\n");
+    for(size_t i = 0; i < frames.size(); i++)
+    {
+        const FUSION_OUT &o = out[i].fused;
+        std::fprintf(f, "%u,%u,%.4f,%.4f,%.6f,%.6f,%.6f,%.6f,%d,%d,%d,%u,%u,%u\n",
+                     (unsigned)frames[i].seq, (unsigned)frames[i].timestamp,
+                     o.rollQ16 / (double)FIX_Q16_ONE, o.pitchQ16 / (double)FIX_Q16_ONE,
+                     o.quat[0] / (double)FIX_Q30_ONE, o.quat[1] / (double)FIX_Q30_ONE,
+                     o.quat[2] / (double)FIX_Q30_ONE, o.quat[3] / (double)FIX_Q30_ONE,
+                     (int)o.accLim, (int)o.rollLim, (int)o.pitchLim,
+                     (unsigned)out[i].decision, (unsigned)out[i].actuator, (unsigned)out[i].state);
+    }
+
+    if(f != stdout)
+    {
+        std::fclose(f);
+    }
+
+    return 0;
+}
+
+/* [] END OF FILE */
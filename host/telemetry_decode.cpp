@@ -0,0 +1,385 @@
+/* ========================================
+ *
+ * Copyright YOUR COMPANY, THE YEAR
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CONFIDENTIAL AND PROPRIETARY INFORMATION
+ * WHICH IS THE PROPERTY OF your company.
+ *
+ * ========================================
+*/
+
+/*
+    Decodes a captured telemetry stream (telemetry.h), e.g. the raw bytes of
+    the UART saved with any serial terminal, and writes one CSV line per good
+    packet:
+
+        seq,t_us,ax,ay,az,gx,gy,gz,temp,roll,pitch,q0,q1,q2,q3,accLim,flags,mx,my,mz
+
+    t_us counts from the first packet, the 32 bit cycle timestamps are
+    unwrapped with --mhz (BUS_CLK, 64 by default). roll/pitch are in degrees,
+    q0..q3 normalized. Packets with a bad CRC or COBS framing and gaps in seq
+    are counted on stderr. A TELEMETRY_COMPACT stream (log packets) carries no
+    fusion outputs, its lines leave roll..flags empty.
+
+    --trace writes the samples as a t_us,ax,ay,az,gx,gy,gz trace for replay,
+    with mx,my,mz appended when the stream carries the magnetometer.
+
+    --blackbox writes the black-box records (blackbox.h) in the stream, one
+    line each:
+
+        event,index,length,trigger,seq,ax,ay,az,gx,gy,gz,roll,pitch,accNow,state,flags
+
+    roll/pitch in degrees. Windows with records missing are counted on stderr.
+
+    usage: telemetry_decode [--mhz N] [--trace trace.csv] [--blackbox bb.csv] capture [out.csv]
+*/
+
+extern "C" {
+#include "blackbox.h"
+#include "crc16.h"
+#include "imu_log.h"
+#include "telemetry.h"
+}
+
+#undef M_PI
+#undef dt
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+struct Sample
+{
+    IMU_FRAME frame;
+    int32 rollQ16, pitchQ16;
+    int32 quat[4];
+    int16 accLim;
+    uint8 flags;
+    bool fused;             // from a sample packet, not a log packet
+};
+
+struct Record
+{
+    uint16 event, index, length, trigger;
+    BLACKBOX_RECORD r;
+};
+
+static uint32 Get32(const uint8 *p)
+{
+    return (uint32)p[0] | ((uint32)p[1] << 8) | ((uint32)p[2] << 16) | ((uint32)p[3] << 24);
+}
+
+static uint16 Get16(const uint8 *p)
+{
+    return (uint16)(p[0] | (p[1] << 8));
+}
+
+static bool Unpack(const uint8 *p, uint16 len, Sample &s)
+{
+    if(len != TELEMETRY_SAMPLE_SIZE || p[0] != TELEMETRY_TYPE_SAMPLE ||
+       Crc16(p, TELEMETRY_SAMPLE_SIZE - 2u) != Get16(p + TELEMETRY_SAMPLE_SIZE - 2u))
+    {
+        return false;
+    }
+
+    s.frame.seq = Get32(p + 1);
+    s.frame.timestamp = Get32(p + 5);
+    for(int i = 0; i < 3; i++)
+    {
+        s.frame.accel[i] = (int16)Get16(p + 9 + 2 * i);
+        s.frame.gyro[i] = (int16)Get16(p + 15 + 2 * i);
+    }
+    s.frame.temp = (int16)Get16(p + 21);
+    s.rollQ16 = (int32)Get32(p + 23);
+    s.pitchQ16 = (int32)Get32(p + 27);
+    for(int i = 0; i < 4; i++)
+    {
+        s.quat[i] = (int32)Get32(p + 31 + 4 * i);
+    }
+    s.accLim = (int16)Get16(p + 47);
+    s.flags = p[49];
+    for(int i = 0; i < 3; i++)
+    {
+        s.frame.mag[i] = (int16)Get16(p + 50 + 2 * i);
+    }
+    s.frame.magValid = (s.flags & TELEMETRY_FLAG_MAG) != 0;
+    s.fused = true;
+
+    return true;
+}
+
+static bool UnpackLog(const uint8 *p, uint16 len, IMU_LOG_DECODER &dec, std::vector<Sample> &samples)
+{
+    // the records of a log packet, false and out of sync when it is not one or ends inside a record
+    if(len < 3u || p[0] != TELEMETRY_TYPE_LOG || Crc16(p, len - 2u) != Get16(p + len - 2u))
+    {
+        return false;
+    }
+
+    for(uint16 pos = 1; pos < len - 2u; )
+    {
+        Sample s = {};
+        uint8 ready;
+        uint16 used = ImuLog_Decode(&dec, p + pos, len - 2u - pos, &s.frame, &ready);
+
+        if(used == 0u)
+        {
+            ImuLog_Desync(&dec);
+            return false;
+        }
+        if(ready)
+        {
+            samples.push_back(s);
+        }
+        pos += used;
+    }
+
+    return true;
+}
+
+static bool UnpackRecord(const uint8 *p, uint16 len, Record &b)
+{
+    if(len != BLACKBOX_PACKET_SIZE || p[0] != TELEMETRY_TYPE_BLACKBOX ||
+       Crc16(p, BLACKBOX_PACKET_SIZE - 2u) != Get16(p + BLACKBOX_PACKET_SIZE - 2u))
+    {
+        return false;
+    }
+
+    b.event = Get16(p + 1);
+    b.index = Get16(p + 3);
+    b.length = Get16(p + 5);
+    b.trigger = Get16(p + 7);
+    b.r.seq = Get32(p + 9);
+    for(int i = 0; i < 3; i++)
+    {
+        b.r.accel[i] = (int16)Get16(p + 13 + 2 * i);
+        b.r.gyro[i] = (int16)Get16(p + 19 + 2 * i);
+    }
+    b.r.roll = (int16)Get16(p + 25);
+    b.r.pitch = (int16)Get16(p + 27);
+    b.r.accNow = Get16(p + 29);
+    b.r.state = p[31];
+    b.r.flags = p[32];
+
+    return true;
+}
+
+static void Usage(void)
+{
+    std::fprintf(stderr, "usage: telemetry_decode [--mhz N] [--trace trace.csv] [--blackbox bb.csv] capture [out.csv]\n");
+    std::exit(2);
+}
+
+int main(int argc, char **argv)
+{
+    double mhz = 64.0;
+    const char *tracePath = nullptr;
+    const char *blackboxPath = nullptr;
+    const char *capturePath = nullptr;
+    const char *outPath = nullptr;
+
+    for(int i = 1; i < argc; i++)
+    {
+        if(std::strcmp(argv[i], "--mhz") == 0 && i + 1 < argc)
+        {
+            mhz = std::strtod(argv[++i], nullptr);
+        }
+        else if(std::strcmp(argv[i], "--trace") == 0 && i + 1 < argc)
+        {
+            tracePath = argv[++i];
+        }
+        else if(std::strcmp(argv[i], "--blackbox") == 0 && i + 1 < argc)
+        {
+            blackboxPath = argv[++i];
+        }
+        else if(argv[i][0] == '-' && argv[i][1] != '\0')
+        {
+            Usage();
+        }
+        else if(capturePath == nullptr)
+        {
+            capturePath = argv[i];
+        }
+        else
+        {
+            outPath = argv[i];
+        }
+    }
+    if(capturePath == nullptr || mhz <= 0.0)
+    {
+        Usage();
+    }
+
+    FILE *in = (std::strcmp(capturePath, "-") == 0) ? stdin : std::fopen(capturePath, "rb");
+    if(in == nullptr)
+    {
+        std::fprintf(stderr, "telemetry_decode: cannot read %s\n", capturePath);
+        return 1;
+    }
+
+    // split at the 0 delimiters, the bytes before the first one may be the tail of a cut packet
+    std::vector<Sample> samples;
+    std::vector<Record> records;
+    IMU_LOG_DECODER logDecoder;
+    std::vector<uint8> chunk;
+    uint8 packet[TELEMETRY_MAX_ENCODED];
+    unsigned long bad = 0;
+    int c;
+
+    ImuLog_InitDecoder(&logDecoder);
+    while((c = std::fgetc(in)) != EOF)
+    {
+        if(c != 0)
+        {
+            chunk.push_back((uint8)c);
+            continue;
+        }
+        if(!chunk.empty())
+        {
+            Sample s;
+            Record b;
+            uint16 len = (chunk.size() <= TELEMETRY_MAX_ENCODED) ?
+                         Telemetry_CobsDecode(packet, sizeof(packet), chunk.data(), (uint16)chunk.size()) : 0u;
+
+            if(Unpack(packet, len, s))
+            {
+                samples.push_back(s);
+            }
+            else if(UnpackRecord(packet, len, b))
+            {
+                records.push_back(b);
+            }
+            else if(!UnpackLog(packet, len, logDecoder, samples))
+            {
+                ImuLog_Desync(&logDecoder);     // the records of this one are lost, wait for the next key
+                bad++;
+            }
+            chunk.clear();
+        }
+    }
+    if(in != stdin)
+    {
+        std::fclose(in);
+    }
+
+    FILE *out = (outPath != nullptr) ? std::fopen(outPath, "w") : stdout;
+    FILE *trace = (tracePath != nullptr) ? std::fopen(tracePath, "w") : nullptr;
+    if(out == nullptr || (tracePath != nullptr && trace == nullptr))
+    {
+        std::fprintf(stderr, "telemetry_decode: cannot write %s\n", (out == nullptr) ? outPath : tracePath);
+        return 1;
+    }
+
+    unsigned long lost = 0;
+    double tUs = 0.0;
+    bool mag = false;
+
+    for(const Sample &s : samples)
+    {
+        mag = mag || s.frame.magValid;
+    }
+
+    std::fprintf(out, "seq,t_us,ax,ay,az,gx,gy,gz,temp,roll,pitch,q0,q1,q2,q3,accLim,flags,mx,my,mz\n");
+    if(trace != nullptr)
+    {
+        std::fprintf(trace, mag ? "t_us,ax,ay,az,gx,gy,gz,mx,my,mz\n" : "t_us,ax,ay,az,gx,gy,gz\n");
+    }
+    for(size_t i = 0; i < samples.size(); i++)
+    {
+        const Sample &s = samples[i];
+
+        if(i > 0)
+        {
+            lost += s.frame.seq - samples[i - 1].frame.seq - 1u;
+            tUs += (uint32)(s.frame.timestamp - samples[i - 1].frame.timestamp) / mhz;
+        }
+
+        if(s.fused)
+        {
+            std::fprintf(out, "%u,%.0f,%d,%d,%d,%d,%d,%d,%d,%.4f,%.4f,%.6f,%.6f,%.6f,%.6f,%d,%u,%d,%d,%d\n",
+                         s.frame.seq, tUs, s.frame.accel[0], s.frame.accel[1], s.frame.accel[2],
+                         s.frame.gyro[0], s.frame.gyro[1], s.frame.gyro[2], s.frame.temp,
+                         s.rollQ16 / 65536.0, s.pitchQ16 / 65536.0,
+                         s.quat[0] / 1073741824.0, s.quat[1] / 1073741824.0,
+                         s.quat[2] / 1073741824.0, s.quat[3] / 1073741824.0, s.accLim, s.flags,
+                         s.frame.mag[0], s.frame.mag[1], s.frame.mag[2]);
+        }
+        else
+        {
+            std::fprintf(out, "%u,%.0f,%d,%d,%d,%d,%d,%d,%d,,,,,,,,,%d,%d,%d\n",
+                         s.frame.seq, tUs, s.frame.accel[0], s.frame.accel[1], s.frame.accel[2],
+                         s.frame.gyro[0], s.frame.gyro[1], s.frame.gyro[2], s.frame.temp,
+                         s.frame.mag[0], s.frame.mag[1], s.frame.mag[2]);
+        }
+        if(trace != nullptr)
+        {
+            std::fprintf(trace, "%.0f,%d,%d,%d,%d,%d,%d", tUs, s.frame.accel[0], s.frame.accel[1],
+                         s.frame.accel[2], s.frame.gyro[0], s.frame.gyro[1], s.frame.gyro[2]);
+            if(mag)
+            {
+                std::fprintf(trace, ",%d,%d,%d", s.frame.mag[0], s.frame.mag[1], s.frame.mag[2]);
+            }
+            std::fprintf(trace, "\n");
+        }
+    }
+
+    if(out != stdout)
+    {
+        std::fclose(out);
+    }
+    if(trace != nullptr)
+    {
+        std::fclose(trace);
+    }
+
+    if(blackboxPath != nullptr)
+    {
+        FILE *bb = std::fopen(blackboxPath, "w");
+        unsigned long windows = 0;
+        unsigned long incomplete = 0;
+
+        if(bb == nullptr)
+        {
+            std::fprintf(stderr, "telemetry_decode: cannot write %s\n", blackboxPath);
+            return 1;
+        }
+        std::fprintf(bb, "event,index,length,trigger,seq,ax,ay,az,gx,gy,gz,roll,pitch,accNow,state,flags\n");
+        for(size_t i = 0; i < records.size(); i++)
+        {
+            const Record &b = records[i];
+
+            // a window is complete when its records arrive as index 0 .. length - 1
+            if(i == 0 || b.event != records[i - 1].event)
+            {
+                size_t n = 0;
+
+                windows++;
+                while(i + n < records.size() && records[i + n].event == b.event && records[i + n].index == n)
+                {
+                    n++;
+                }
+                if(n != b.length)
+                {
+                    incomplete++;
+                }
+            }
+            std::fprintf(bb, "%u,%u,%u,%u,%u,%d,%d,%d,%d,%d,%d,%.2f,%.2f,%u,%u,%u\n",
+                         b.event, b.index, b.length, b.trigger, b.r.seq,
+                         b.r.accel[0], b.r.accel[1], b.r.accel[2], b.r.gyro[0], b.r.gyro[1], b.r.gyro[2],
+                         b.r.roll / 100.0, b.r.pitch / 100.0, b.r.accNow, b.r.state, b.r.flags);
+        }
+        std::fclose(bb);
+        std::fprintf(stderr, "%zu black-box records in %lu windows, %lu incomplete\n",
+                     records.size(), windows, incomplete);
+    }
+
+    std::fprintf(stderr, "%zu packets, %lu bad (CRC or framing), %lu samples missing in seq\n",
+                 samples.size(), bad, lost);
+
+    return 0;
+}
+
+/* [] END OF FILE */
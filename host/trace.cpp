@@ -0,0 +1,249 @@
+/* ========================================
+ *
+ * Copyright YOUR COMPANY, THE YEAR
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CONFIDENTIAL AND PROPRIETARY INFORMATION
+ * WHICH IS THE PROPERTY OF your company.
+ *
+ * ========================================
+*/
+
+#include "trace.h"
+
+extern "C" {
+#include "imu_log.h"
+}
+
+#include <cctype>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+bool Trace_IsCsv(const std::string &path)
+{
+    size_t dot = path.rfind('.');
+    std::string ext = (dot == std::string::npos) ? "" : path.substr(dot + 1);
+
+    return ext == "csv" || ext == "txt";
+}
+
+bool Trace_IsLog(const std::string &path)
+{
+    size_t dot = path.rfind('.');
+
+    return dot != std::string::npos && path.substr(dot + 1) == "imul";
+}
+
+bool Trace_ParseCsv(const char *text, size_t size, std::vector<IMU_FRAME> &frames, std::string &error)
+{
+    const char *p = text;
+    const char *end = text + size;
+    unsigned lineNo = 0;
+
+    while(p < end)
+    {
+        const char *eol = p;
+        while(eol < end && *eol != '\n')
+        {
+            eol++;
+        }
+        lineNo++;
+
+        const char *q = p;
+        while(q < eol && (*q == ' ' || *q == '\t'))
+        {
+            q++;
+        }
+
+        if(q < eol && *q != '#' && *q != '\r' && !std::isalpha((unsigned char)*q))
+        {
+            long v[10];
+            int n = 0;
+
+            while(n < 10 && q < eol)
+            {
+                char *next;
+                v[n] = std::strtol(q, &next, 10);
+                if(next == q)
+                {
+                    break;
+                }
+                n++;
+                q = next;
+                while(q < eol && (*q == ',' || *q == ' ' || *q == '\t' || *q == ';'))
+                {
+                    q++;
+                }
+            }
+
+            if(n != 6 && n != 7 && n != 9 && n != 10)
+            {
+                error = "line " + std::to_string(lineNo) + ": expected 6, 7, 9 or 10 columns";
+                return false;
+            }
+
+            IMU_FRAME f = {};
+            int o = n % 3;              // 1 with the time column
+            f.seq = (uint32)frames.size();
+            f.timestamp = (o == 1) ? (uint32)v[0] : f.seq * TRACE_PERIOD_US;
+            for(int i = 0; i < 3; i++)
+            {
+                f.accel[i] = (int16)v[o + i];
+                f.gyro[i] = (int16)v[o + 3 + i];
+                f.mag[i] = (n - o == 9) ? (int16)v[o + 6 + i] : 0;
+            }
+            f.magValid = (n - o == 9);
+            frames.push_back(f);
+        }
+
+        p = eol + 1;
+    }
+
+    return true;
+}
+
+void Trace_ParseBinary(const unsigned char *data, size_t size, std::vector<IMU_FRAME> &frames)
+{
+    size_t count = size / TRACE_RECORD_SIZE;
+
+    frames.reserve(frames.size() + count);
+    for(size_t r = 0; r < count; r++)
+    {
+        const unsigned char *b = data + r * TRACE_RECORD_SIZE;
+        IMU_FRAME f = {};
+
+        f.seq = (uint32)frames.size();
+        f.timestamp = f.seq * TRACE_PERIOD_US;
+        for(int i = 0; i < 3; i++)
+        {
+            f.accel[i] = (int16)(uint16)(b[2*i] | (b[2*i + 1] << 8));
+            f.gyro[i] = (int16)(uint16)(b[6 + 2*i] | (b[6 + 2*i + 1] << 8));
+        }
+        frames.push_back(f);
+    }
+}
+
+bool Trace_ParseLog(const unsigned char *data, size_t size, std::vector<IMU_FRAME> &frames, std::string &error)
+{
+    // a file is one unbroken stream, so anything skipped or cut off is an error
+    IMU_LOG_DECODER dec;
+    size_t pos = 0;
+
+    ImuLog_InitDecoder(&dec);
+    while(pos < size)
+    {
+        IMU_FRAME f;
+        uint8 ready;
+        uint16 len = (size - pos > 0xFFFFu) ? 0xFFFFu : (uint16)(size - pos);
+        uint16 used = ImuLog_Decode(&dec, data + pos, len, &f, &ready);
+
+        if(used == 0u)
+        {
+            error = "log cut off in the last record at byte " + std::to_string(pos);
+            return false;
+        }
+        if(ready)
+        {
+            frames.push_back(f);
+        }
+        pos += used;
+    }
+    if(dec.skipped != 0u)
+    {
+        error = "log corrupted, " + std::to_string(dec.skipped) + " bytes skipped";
+        return false;
+    }
+
+    return true;
+}
+
+bool Trace_Load(const std::string &path, std::vector<IMU_FRAME> &frames, std::string &error)
+{
+    std::ifstream in(path, std::ios::binary);
+
+    if(!in)
+    {
+        error = "cannot open " + path;
+        return false;
+    }
+
+    std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+    if(Trace_IsCsv(path))
+    {
+        return Trace_ParseCsv(data.data(), data.size(), frames, error);
+    }
+
+    if(Trace_IsLog(path))
+    {
+        return Trace_ParseLog((const unsigned char *)data.data(), data.size(), frames, error);
+    }
+
+    Trace_ParseBinary((const unsigned char *)data.data(), data.size(), frames);
+    return true;
+}
+
+bool Trace_Map(const std::string &path, std::vector<IMU_FRAME> &frames, std::string &error)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    struct stat st;
+
+    if(fd < 0 || fstat(fd, &st) != 0)
+    {
+        if(fd >= 0)
+        {
+            close(fd);
+        }
+        error = "cannot open " + path;
+        return false;
+    }
+
+    size_t size = (size_t)st.st_size;
+    if(size == 0)
+    {
+        close(fd);
+        return true;
+    }
+
+    void *map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(map == MAP_FAILED)
+    {
+        return Trace_Load(path, frames, error);
+    }
+    (void) madvise(map, size, MADV_SEQUENTIAL);
+
+    const char *text = (const char *)map;
+    bool ok = true;
+
+    if(Trace_IsCsv(path))
+    {
+        // strtol stops at the first non-digit, past the end only when the last line has no newline and fills its page
+        if(text[size - 1] != '\n' && size % (size_t)sysconf(_SC_PAGESIZE) == 0)
+        {
+            munmap(map, size);
+            return Trace_Load(path, frames, error);
+        }
+        ok = Trace_ParseCsv(text, size, frames, error);
+    }
+    else if(Trace_IsLog(path))
+    {
+        ok = Trace_ParseLog((const unsigned char *)map, size, frames, error);
+    }
+    else
+    {
+        Trace_ParseBinary((const unsigned char *)map, size, frames);
+    }
+
+    munmap(map, size);
+    return ok;
+}
+
+/* [] END OF FILE */
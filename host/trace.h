@@ -0,0 +1,61 @@
+/* ========================================
+ *
+ * Copyright YOUR COMPANY, THE YEAR
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CONFIDENTIAL AND PROPRIETARY INFORMATION
+ * WHICH IS THE PROPERTY OF your company.
+ *
+ * ========================================
+*/
+
+/*
+    Recorded IMU traces for the host tools.
+
+    CSV     one sample per line, either
+                ax,ay,az,gx,gy,gz
+            or
+                t_us,ax,ay,az,gx,gy,gz
+            raw int16 counts as in AccelXYZ/GyroXYZ, optionally followed by
+            mx,my,mz (IMU_FRAME.mag, sets magValid). Lines starting with '#'
+            and a header line starting with a letter are skipped.
+
+    Log     .imul, the compressed sample log of imu_log.h with timestamps
+            in microseconds (host/imu_log encode). Every field of IMU_FRAME
+            as recorded, seq included.
+
+    Binary  anything else. Back to back 12 byte records of six little
+            endian int16: ax ay az gx gy gz.
+
+    Without a time column samples are TRACE_PERIOD_US apart (the 10 ms dt of
+    the firmware). IMU_FRAME.timestamp is in microseconds on the host.
+
+    Trace_Map parses straight from a read-only mmap of the file instead of a
+    copy, for tools that go through many large traces (batch_eval).
+*/
+
+#if !defined(TRACE_H)
+#define TRACE_H
+
+extern "C" {
+#include "imu_types.h"
+}
+
+#include <string>
+#include <vector>
+
+#define TRACE_PERIOD_US     (10000u)
+#define TRACE_RECORD_SIZE   (12u)
+
+bool Trace_Load(const std::string &path, std::vector<IMU_FRAME> &frames, std::string &error);
+bool Trace_Map(const std::string &path, std::vector<IMU_FRAME> &frames, std::string &error);
+bool Trace_ParseCsv(const char *text, size_t size, std::vector<IMU_FRAME> &frames, std::string &error);
+void Trace_ParseBinary(const unsigned char *data, size_t size, std::vector<IMU_FRAME> &frames);
+bool Trace_ParseLog(const unsigned char *data, size_t size, std::vector<IMU_FRAME> &frames, std::string &error);
+bool Trace_IsCsv(const std::string &path);
+bool Trace_IsLog(const std::string &path);
+
+#endif
+
+/* [] END OF FILE */
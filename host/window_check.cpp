@@ -0,0 +1,183 @@
+/* ========================================
+ *
+ * Copyright YOUR COMPANY, THE YEAR
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CONFIDENTIAL AND PROPRIETARY INFORMATION
+ * WHICH IS THE PROPERTY OF your company.
+ *
+ * ========================================
+*/
+
+/*
+    Checks the sliding window statistics (window_stats.c) against a brute
+    force window. After every push the count, sum, min, max, mean and
+    variance must equal the same values recomputed from the last
+    WINDOW_STATS_LEN samples, the variance with exact 128 bit integers.
+
+    Each pattern starts from a fresh window, so the partly filled start is
+    covered too. Samples stay within +-65535, the range window_stats.h
+    allows:
+
+        uniform     uniform over the whole range
+        walk        random walk with steps up to 2000, clamped at the ends
+        runs        monotonic runs up and down of random length, with
+                    repeated values, the worst case for the deques
+        extremes    only -65535, 0 and 65535, the largest sums and variance
+        counts      |a| as it comes from the sensor, 1 g +- noise with
+                    short free-fall dips
+
+    Prints the mismatches per pattern and exits with status 1 on any.
+
+    usage: window_check [--samples N] [--seed S]
+*/
+
+extern "C" {
+#include "window_stats.h"
+}
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <random>
+
+#define CHECK_RANGE     (65535)
+
+struct Expected
+{
+    int64 sum;
+    int32 min, max, mean;
+    uint32 variance;
+};
+
+static Expected BruteForce(const std::deque<int32> &window)
+{
+    Expected e = { 0, 0, 0, 0, 0 };
+    __int128 n = (__int128)window.size();
+    __int128 sumSq = 0;
+
+    e.min = *std::min_element(window.begin(), window.end());
+    e.max = *std::max_element(window.begin(), window.end());
+    for(int32 x : window)
+    {
+        e.sum += x;
+        sumSq += (__int128)x * x;
+    }
+    // mean rounded to nearest, halves away from zero
+    e.mean = (int32)((e.sum >= 0) ? (e.sum + (int64)n / 2) / (int64)n : -((-e.sum + (int64)n / 2) / (int64)n));
+    e.variance = (uint32)((n * sumSq - (__int128)e.sum * e.sum) / (n * n));
+
+    return e;
+}
+
+static size_t Check(const char *name, size_t samples, std::mt19937 &rng)
+{
+    std::uniform_int_distribution<int32> uniform(-CHECK_RANGE, CHECK_RANGE);
+    std::uniform_int_distribution<int32> step(-2000, 2000);
+    std::uniform_int_distribution<int32> runLen(1, 3 * WINDOW_STATS_LEN);
+    std::uniform_int_distribution<int32> pick(0, 2);
+    std::normal_distribution<double> noise(0.0, 40.0);
+    WINDOW_STATS w;
+    std::deque<int32> window;
+    size_t mismatches = 0;
+    int32 x = 0;
+    int32 dir = 1;
+    int32 left = 0;
+
+    WindowStats_Init(&w);
+
+    for(size_t n = 0; n < samples; n++)
+    {
+        if(!strcmp(name, "uniform"))
+        {
+            x = uniform(rng);
+        }
+        else if(!strcmp(name, "walk"))
+        {
+            x = std::min(CHECK_RANGE, std::max(-CHECK_RANGE, x + step(rng)));
+        }
+        else if(!strcmp(name, "runs"))
+        {
+            if(left-- <= 0)
+            {
+                left = runLen(rng);
+                dir = -dir;
+            }
+            x = std::min(CHECK_RANGE, std::max(-CHECK_RANGE, x + dir * pick(rng) * 500));   // steps of 0 repeat values
+        }
+        else if(!strcmp(name, "extremes"))
+        {
+            x = (pick(rng) - 1) * CHECK_RANGE;
+        }
+        else
+        {
+            x = (int32)((n % 500u < 30u) ? 400.0 + noise(rng) : 16384.0 + noise(rng));
+        }
+
+        WindowStats_Push(&w, x);
+        window.push_back(x);
+        if(window.size() > WINDOW_STATS_LEN)
+        {
+            window.pop_front();
+        }
+
+        Expected e = BruteForce(window);
+
+        if(WindowStats_Count(&w) != window.size() || WindowStats_Sum(&w) != e.sum ||
+           WindowStats_Min(&w) != e.min || WindowStats_Max(&w) != e.max ||
+           WindowStats_Mean(&w) != e.mean || WindowStats_Variance(&w) != e.variance)
+        {
+            if(mismatches == 0u)
+            {
+                fprintf(stderr, "%s: sample %zu: min %d/%d max %d/%d mean %d/%d var %u/%u\n", name, n,
+                        WindowStats_Min(&w), e.min, WindowStats_Max(&w), e.max,
+                        WindowStats_Mean(&w), e.mean, WindowStats_Variance(&w), e.variance);
+            }
+            mismatches++;
+        }
+    }
+
+    printf("%-10s %8zu samples %6zu mismatches\n", name, samples, mismatches);
+
+    return mismatches;
+}
+
+int main(int argc, char **argv)
+{
+    static const char *patterns[] = { "uniform", "walk", "runs", "extremes", "counts" };
+    size_t samples = 100000u;
+    unsigned seed = 1;
+    size_t mismatches = 0;
+
+    for(int a = 1; a < argc; a++)
+    {
+        if(!strcmp(argv[a], "--samples") && a + 1 < argc)
+        {
+            samples = strtoul(argv[++a], NULL, 0);
+        }
+        else if(!strcmp(argv[a], "--seed") && a + 1 < argc)
+        {
+            seed = (unsigned)strtoul(argv[++a], NULL, 0);
+        }
+        else
+        {
+            fprintf(stderr, "usage: window_check [--samples N] [--seed S]\n");
+            return 2;
+        }
+    }
+
+    std::mt19937 rng(seed);
+
+    printf("WINDOW_STATS_LEN %u\n", (unsigned)WINDOW_STATS_LEN);
+    for(const char *p : patterns)
+    {
+        mismatches += Check(p, samples, rng);
+    }
+
+    return (mismatches == 0u) ? 0 : 1;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,485 @@
+/* ========================================
+ *
+ * Copyright YOUR COMPANY, THE YEAR
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CONFIDENTIAL AND PROPRIETARY INFORMATION
+ * WHICH IS THE PROPERTY OF your company.
+ *
+ * ========================================
+*/
+
+#include "i2c_engine.h"
+#include "timebase.h"
+
+#if defined(Master_DATA_RATE) && (Master_DATA_RATE != I2C_BUS_KHZ)
+    #error "I2C_BUS_KHZ does not match the Data rate of the Master component"
+#endif
+
+#define PHASE_ADDRESS   (0u)    // register address being written, bus held for restart
+#define PHASE_DATA      (1u)    // data being read or written
+
+// Fixed function block timeout, Master_FF__TMOUT_x in I2C_test.svd
+#define TMOUT_SCL_EN    (0x01u)
+#define TMOUT_SDA_EN    (0x02u)
+#define TMOUT_INT_EN    (0x04u)
+#define TMOUT_SR_MASK   (0x03u)                 // SCL/SDA timeout status, write 1 to clear
+#define TMOUT_PERIOD    ((I2C_STUCK_TIMEOUT_US * BCLK__BUS_CLK__MHZ) / 1024u)   // 12 bits, units of 1024 bus clocks
+
+#define PIN_SCL         (0x01u)                 // Data_pins(0)
+#define PIN_SDA         (0x02u)                 // Data_pins(1)
+
+#define RECOVERY_IDLE       (0u)
+#define RECOVERY_PENDING    (1u)                // the block is stopped, the next poll recovers the bus
+#define RECOVERY_RUNNING    (2u)                // a poll is clocking the bus free
+
+static I2C_REQUEST *queue[I2C_QUEUE_SIZE];
+static uint8 queueHead = 0;
+static uint8 queueTail = 0;
+static uint8 queueCount = 0;
+
+static I2C_REQUEST * volatile active = NULL;   // request on the bus, NULL when idle
+static uint8 phase = PHASE_ADDRESS;
+static uint32 startTime = 0;
+static uint8 txBuffer[I2C_MAX_WRITE + 1u];      // register address followed by write data
+static uint8 retriesLeft = 0;
+static volatile uint8 recovery = RECOVERY_IDLE;
+static uint8 recoveryStatus = I2C_STATUS_IDLE;  // error that made the recovery necessary
+
+I2C_STATS i2cStats;
+
+static void StartNext(void);
+static void StartTransfer(void);
+static void Fail(uint8 status);
+static void Retry(uint8 status);
+static void Finish(uint8 status);
+static void TimeoutEnable(void);
+static void BusRecover(void);
+
+void I2cEngine_Init(void)
+{
+    queueHead = 0;
+    queueTail = 0;
+    queueCount = 0;
+    active = NULL;
+    recovery = RECOVERY_IDLE;
+
+    (void) Master_MasterClearStatus();
+    TimeoutEnable();
+}
+
+uint8 I2cEngine_Submit(I2C_REQUEST *req)
+{
+    /*
+        Queues a request and starts it right away if the bus is idle. Safe to call
+        from interrupts and main. Returns I2C_STATUS_QUEUED when accepted. A request
+        still in flight can not be submitted again, I2C_STATUS_IN_PROGRESS is
+        returned instead so a slow bus shows up as a skipped sample.
+    */
+
+    uint8 result = I2C_STATUS_QUEUED;
+    uint8 intState = CyEnterCriticalSection();
+
+    if(I2C_STATUS_PENDING(req->status))
+    {
+        result = I2C_STATUS_IN_PROGRESS;
+    }
+    else if((queueCount >= I2C_QUEUE_SIZE) || ((req->direction == I2C_DIR_WRITE) && (req->cnt > I2C_MAX_WRITE)))
+    {
+        result = I2C_STATUS_QUEUE_FULL;
+    }
+    else
+    {
+        req->status = I2C_STATUS_QUEUED;
+        req->faults = 0;
+        queue[queueTail] = req;
+        queueTail = (queueTail + 1u) % I2C_QUEUE_SIZE;
+        queueCount++;
+
+        if(active == NULL)
+        {
+            StartNext();
+        }
+    }
+
+    CyExitCriticalSection(intState);
+
+    return result;
+}
+
+void I2cEngine_Poll(void)
+{
+    /*
+        Aborts the active transfer if it has been on the bus longer than its
+        timeout or the hardware timeout saw a stuck line, recovers the bus after
+        a failed attempt and retries. Call it periodically, the sampling
+        interrupt does it every period. The recovery runs with interrupts
+        enabled, only a caller of lower priority than this one waits for it.
+    */
+
+    uint8 recover = 0u;
+    uint8 intState = CyEnterCriticalSection();
+
+    if(recovery == RECOVERY_PENDING)
+    {
+        recovery = RECOVERY_RUNNING;            // a nested poll leaves it to this one
+        recover = 1u;
+    }
+    else if((recovery == RECOVERY_IDLE) && (active != NULL))
+    {
+        if((CY_GET_REG8(Master_FF__TMOUT_SR) & TMOUT_SR_MASK) != 0u)
+        {
+            i2cStats.stuck++;
+            Fail(I2C_STATUS_TIMEOUT);
+        }
+        else if((Timebase_Now() - startTime) > TIMEBASE_TICKS(active->timeoutUs))
+        {
+            i2cStats.timeouts++;
+            Fail(I2C_STATUS_TIMEOUT);
+        }
+        else
+        {
+            // still within its time
+        }
+    }
+    else
+    {
+        // idle, or another poll is recovering the bus
+    }
+
+    CyExitCriticalSection(intState);
+
+    if(recover != 0u)
+    {
+        BusRecover();                           // the request stays active, new ones only queue behind it
+
+        intState = CyEnterCriticalSection();
+        recovery = RECOVERY_IDLE;
+        Retry(recoveryStatus);
+        CyExitCriticalSection(intState);
+    }
+}
+
+uint8 I2cEngine_Wait(I2C_REQUEST *req)
+{
+    // Spins until the request is finished or timed out. Not for interrupt context.
+    while(I2C_STATUS_PENDING(req->status))
+    {
+        I2cEngine_Poll();
+    }
+
+    return req->status;
+}
+
+static void StartNext(void)
+{
+    // Must be called with interrupts locked
+    while((active == NULL) && (queueCount > 0u))
+    {
+        active = queue[queueHead];
+        queueHead = (queueHead + 1u) % I2C_QUEUE_SIZE;
+        queueCount--;
+
+        retriesLeft = I2C_RETRIES;
+        StartTransfer();                        // on a final error active is cleared, loop moves on
+    }
+}
+
+static void StartTransfer(void)
+{
+    // Must be called with interrupts locked. (Re)starts the active request from its first byte.
+    uint8 result;
+
+    active->status = I2C_STATUS_IN_PROGRESS;
+    startTime = Timebase_Now();
+    txBuffer[0] = active->registerAddress;
+
+    (void) Master_MasterClearStatus();
+
+    if(active->direction == I2C_DIR_READ)
+    {
+        phase = PHASE_ADDRESS;
+        result = Master_MasterWriteBuf(active->slaveAddress, txBuffer, 1u, Master_MODE_NO_STOP);
+    }
+    else
+    {
+        for(uint8 i = 0; i < active->cnt; i++)
+        {
+            txBuffer[i + 1u] = active->data[i];
+        }
+        phase = PHASE_DATA;
+        result = Master_MasterWriteBuf(active->slaveAddress, txBuffer, active->cnt + 1u, Master_MODE_COMPLETE_XFER);
+    }
+
+    if(result != Master_MSTR_NO_ERROR)
+    {
+        i2cStats.busErrors++;                   // bus busy, usually a line held low
+        Fail(I2C_STATUS_BUS_ERROR);
+    }
+}
+
+static void Fail(uint8 status)
+{
+    /*
+        Must be called with interrupts locked. The active attempt failed. If the
+        slave simply did not answer the block has sent the stop already and the
+        request is retried at once. Otherwise the block is stopped and the bus
+        left to the next I2cEngine_Poll, which recovers it outside of any
+        critical section and then retries.
+    */
+
+    active->faults++;
+
+    if(status != I2C_STATUS_NAK)
+    {
+        Master_Stop();                          // no more Master interrupts until the recovery is done
+        recoveryStatus = status;
+        recovery = RECOVERY_PENDING;
+        return;
+    }
+
+    Retry(status);
+}
+
+static void Retry(uint8 status)
+{
+    // Must be called with interrupts locked. Starts the failed request again or finishes it with status
+    if(retriesLeft != 0u)
+    {
+        retriesLeft--;
+        i2cStats.retries++;
+        StartTransfer();
+    }
+    else
+    {
+        i2cStats.failed++;
+        Finish(status);
+    }
+}
+
+static void Finish(uint8 status)
+{
+    // Must be called with interrupts locked
+    I2C_REQUEST *req = active;
+
+    active = NULL;
+    req->status = status;
+
+    if(req->callback != NULL)
+    {
+        req->callback(req);
+    }
+
+    StartNext();
+}
+
+static void TimeoutEnable(void)
+{
+    // Master_Init does not touch the timeout registers, they are set up after every init
+    CY_SET_REG8(Master_FF__TMOUT_CFG0, LO8(TMOUT_PERIOD));
+    CY_SET_REG8(Master_FF__TMOUT_CFG1, HI8(TMOUT_PERIOD) & 0x0Fu);
+    CY_SET_REG8(Master_FF__TMOUT_SR, TMOUT_SR_MASK);
+    CY_SET_REG8(Master_FF__TMOUT_CSR, TMOUT_SCL_EN | TMOUT_SDA_EN | TMOUT_INT_EN);
+}
+
+static void BusRecover(void)
+{
+    /*
+        Called by I2cEngine_Poll with interrupts enabled and the block stopped.
+        A slave that lost clocks in the middle of a byte holds SDA low until it
+        has shifted out the rest of it, the block can neither start nor stop
+        then. The pins are switched from the block to their data register
+        (bypass off), SCL is pulsed until SDA is released, then a stop is sent
+        by hand and the block is re-initialized. Busy waits for at most
+        (2 * I2C_RECOVERY_CLOCKS + 5) * I2C_RECOVERY_HALF_US = 115 us, longer
+        only if interrupts come in between, which just slows the clock down.
+    */
+
+    uint8 clocks = 0;
+
+    i2cStats.recoveries++;
+
+    Data_pins_Write(PIN_SCL | PIN_SDA);         // open drain, both released
+    Data_pins_BYP &= (uint8) ~Data_pins_MASK;
+    CyDelayUs(I2C_RECOVERY_HALF_US);
+
+    while(((Data_pins_Read() & PIN_SDA) == 0u) && (clocks < I2C_RECOVERY_CLOCKS))
+    {
+        Data_pins_Write(PIN_SDA);               // SCL low
+        CyDelayUs(I2C_RECOVERY_HALF_US);
+        Data_pins_Write(PIN_SCL | PIN_SDA);     // SCL high, slave shifts the next bit
+        CyDelayUs(I2C_RECOVERY_HALF_US);
+        clocks++;
+    }
+    if(clocks != 0u)
+    {
+        i2cStats.unjammed++;
+    }
+
+    // Stop: SCL low first so that SDA may change, SDA low, SCL up, then SDA up while SCL is high
+    Data_pins_Write(PIN_SDA);
+    CyDelayUs(I2C_RECOVERY_HALF_US);
+    Data_pins_Write(0u);
+    CyDelayUs(I2C_RECOVERY_HALF_US);
+    Data_pins_Write(PIN_SCL);
+    CyDelayUs(I2C_RECOVERY_HALF_US);
+    Data_pins_Write(PIN_SCL | PIN_SDA);
+    CyDelayUs(I2C_RECOVERY_HALF_US);
+
+    Data_pins_BYP |= Data_pins_MASK;            // pins back to the block
+    Master_Init();
+    Master_Enable();
+    (void) Master_MasterClearStatus();
+    TimeoutEnable();
+}
+
+void Master_ISR_ExitCallback(void)
+{
+    /*
+        Called by the Master component at the end of every one of its interrupts.
+        Moves the active request on when the component reports the current
+        transfer as complete. The hardware timeout raises this interrupt too.
+    */
+
+    uint8 intState;
+    uint8 mstat;
+
+    if(recovery != RECOVERY_IDLE)
+    {
+        return;                                 // left over from the failed attempt, the bus is being recovered
+    }
+
+    if((CY_GET_REG8(Master_FF__TMOUT_SR) & TMOUT_SR_MASK) != 0u)
+    {
+        intState = CyEnterCriticalSection();
+
+        if(active != NULL)
+        {
+            i2cStats.stuck++;
+            Fail(I2C_STATUS_TIMEOUT);
+        }
+        else
+        {
+            CY_SET_REG8(Master_FF__TMOUT_SR, TMOUT_SR_MASK);    // idle, the next transfer finds out
+        }
+
+        CyExitCriticalSection(intState);
+        return;
+    }
+
+    if(active == NULL)
+    {
+        return;
+    }
+
+    mstat = Master_MasterStatus();
+
+    if((mstat & Master_MSTAT_XFER_INP) != 0u)
+    {
+        return;                                 // transfer still running
+    }
+
+    intState = CyEnterCriticalSection();
+
+    if((mstat & Master_MSTAT_ERR_ADDR_NAK) != 0u)
+    {
+        i2cStats.naks++;
+        Fail(I2C_STATUS_NAK);
+    }
+    else if((mstat & Master_MSTAT_ERR_MASK) != 0u)
+    {
+        i2cStats.busErrors++;
+        Fail(I2C_STATUS_BUS_ERROR);
+    }
+    else if((phase == PHASE_ADDRESS) && ((mstat & Master_MSTAT_WR_CMPLT) != 0u))
+    {
+        phase = PHASE_DATA;                     // address sent, bus is held, read with repeated start
+        (void) Master_MasterClearStatus();
+
+        if(Master_MSTR_NO_ERROR != Master_MasterReadBuf(active->slaveAddress, active->data, active->cnt, Master_MODE_REPEAT_START))
+        {
+            i2cStats.busErrors++;
+            Fail(I2C_STATUS_BUS_ERROR);
+        }
+    }
+    else if((mstat & (Master_MSTAT_RD_CMPLT | Master_MSTAT_WR_CMPLT)) != 0u)
+    {
+        Finish(I2C_STATUS_DONE);
+    }
+    else
+    {
+        // Interrupt not related to the end of a transfer
+    }
+
+    CyExitCriticalSection(intState);
+}
+
+// Blocking wrappers for startup code /////////////////////////////////////////////////////////////////
+
+ uint8 WriteByteToSlave(uint8 slaveAddress, uint8 registerAddress, uint8 wrData )
+ {
+    /*
+        Writes a single byte to a register of the slave and waits for the transfer.
+        Returns I2C_STATUS_DONE on success, otherwise the I2C_STATUS_x error code.
+    */
+
+    return WriteBytesToSlave(slaveAddress, registerAddress, &wrData, 1u);
+ }
+
+ uint8 WriteBytesToSlave(uint8 slaveAddress, uint8 registerAddress, uint8 *wrData, uint8 cnt)
+ {
+    /*
+        Writes cnt (up to I2C_MAX_WRITE) consecutive registers of the slave in one
+        transaction, the slave increments the register address, and waits for the
+        transfer. Returns I2C_STATUS_DONE on success, otherwise the I2C_STATUS_x
+        error code.
+    */
+
+    I2C_REQUEST req = {0};
+    uint8 status;
+
+    req.slaveAddress = slaveAddress;
+    req.registerAddress = registerAddress;
+    req.direction = I2C_DIR_WRITE;
+    req.cnt = cnt;
+    req.data = wrData;
+    req.timeoutUs = I2C_DEFAULT_TIMEOUT_US;
+
+    status = I2cEngine_Submit(&req);
+    if(status == I2C_STATUS_QUEUED)
+    {
+        status = I2cEngine_Wait(&req);
+    }
+
+    return status;
+ }
+
+ uint8 ReadBytesFromSlave(uint8 slaveAddress, uint8 registerAddress, uint8 *rData, uint8 cnt)
+ {
+   /*
+        Reads cnt consecutive registers of the slave in one transaction and waits
+        for the transfer. Returns I2C_STATUS_DONE on success, otherwise the
+        I2C_STATUS_x error code.
+    */
+
+    I2C_REQUEST req = {0};
+    uint8 status;
+
+    req.slaveAddress = slaveAddress;
+    req.registerAddress = registerAddress;
+    req.direction = I2C_DIR_READ;
+    req.cnt = cnt;
+    req.data = rData;
+    req.timeoutUs = I2C_DEFAULT_TIMEOUT_US;
+
+    status = I2cEngine_Submit(&req);
+    if(status == I2C_STATUS_QUEUED)
+    {
+        status = I2cEngine_Wait(&req);
+    }
+
+    return status;
+ }
+
+/* [] END OF FILE */
@@ -0,0 +1,131 @@
+/* ========================================
+ *
+ * Copyright YOUR COMPANY, THE YEAR
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CONFIDENTIAL AND PROPRIETARY INFORMATION
+ * WHICH IS THE PROPERTY OF your company.
+ *
+ * ========================================
+*/
+
+/*
+    Interrupt driven I2C transfer engine on top of the Master component's
+    buffered API (Master_MasterWriteBuf/Master_MasterReadBuf).
+
+    Callers fill in an I2C_REQUEST and submit it. The engine queues it, runs the
+    transfer from the Master interrupt and calls the request callback (interrupt
+    context) when it is finished. Nothing blocks except the ReadBytesFromSlave/
+    WriteByteToSlave/WriteBytesToSlave wrappers, which are meant for startup
+    code only.
+
+    A register read is done as a write of the register address without stop,
+    followed by a repeated start read. A register write is one transfer with the
+    register address in front of the data.
+
+    The bus runs at I2C_BUS_KHZ, standard mode 100 kHz. The rate itself is the
+    Data rate of the Master component in TopDesign: i2c_engine.c refuses to
+    build when the generated Master_DATA_RATE differs, and the software
+    timeouts are derived from it. Fast mode (400 kHz, the MPU-9250 maximum)
+    needs the Data rate and I2C_BUS_KHZ changed together, 1 MHz (fast mode
+    plus) is not an option.
+
+    Faults: the hardware timeout of the fixed function block watches for SCL or
+    SDA held low longer than I2C_STUCK_TIMEOUT_US, the software timeout
+    (timeoutUs, checked by I2cEngine_Poll) for transfers that never complete.
+    After a timeout or bus error the block is stopped and the next
+    I2cEngine_Poll recovers the bus with interrupts enabled: the pins are taken
+    away from the block, SCL is clocked until the slave lets go of SDA (at most
+    9 clocks), a stop is generated and the component is re-initialized, 115 us
+    at most. A failed transfer is then retried up to I2C_RETRIES times before
+    the request finishes with the error, so a fault costs one late or missed
+    sample, never a hung bus.
+*/
+
+#if !defined(I2C_ENGINE_H)
+#define I2C_ENGINE_H
+
+#include "project.h"
+
+/***************************************
+*            Constants
+****************************************/
+
+// Request status codes
+#define I2C_STATUS_IDLE         (0u)    // never submitted
+#define I2C_STATUS_DONE         (1u)    // finished without error
+#define I2C_STATUS_QUEUED       (2u)    // waiting for the bus
+#define I2C_STATUS_IN_PROGRESS  (3u)    // on the bus now
+#define I2C_STATUS_NAK          (4u)    // slave did not acknowledge its address
+#define I2C_STATUS_BUS_ERROR    (5u)    // arbitration lost, short transfer or bus error
+#define I2C_STATUS_TIMEOUT      (6u)    // not finished within timeoutUs, bus was reset
+#define I2C_STATUS_QUEUE_FULL   (7u)    // submit rejected, no room in queue
+#define I2C_STATUS_PENDING(s)   (((s) == I2C_STATUS_QUEUED) || ((s) == I2C_STATUS_IN_PROGRESS))
+
+#define I2C_DIR_WRITE           (0u)
+#define I2C_DIR_READ            (1u)
+
+#define I2C_QUEUE_SIZE          (8u)    // requests that can wait for the bus at once
+#define I2C_MAX_WRITE           (16u)   // data bytes in one register write
+
+#define I2C_BUS_KHZ             (100u)  // Master component Data rate
+#define I2C_BYTES_US(n)         (((n) * 9u * 1000u) / I2C_BUS_KHZ)    // n bytes with their ack bits on the bus
+#define I2C_DEFAULT_BYTES       (32u)   // longest transfer the default timeout covers, addresses included
+#define I2C_DEFAULT_TIMEOUT_US  (2u * I2C_BYTES_US(I2C_DEFAULT_BYTES))  // twice its bus time, 5.76 ms at 100 kHz
+#define I2C_STUCK_TIMEOUT_US    (1000u) // SCL or SDA low this long is a stuck bus
+#define I2C_RETRIES             (1u)    // attempts after the first one failed
+#define I2C_RECOVERY_CLOCKS     (9u)    // SCL pulses to free a slave that holds SDA
+#define I2C_RECOVERY_HALF_US    (5u)    // recovery clock runs at 100 kHz
+
+/***************************************
+*            Types
+****************************************/
+
+typedef struct I2C_REQUEST I2C_REQUEST;
+typedef void (*I2C_CALLBACK)(I2C_REQUEST *req);
+
+struct I2C_REQUEST
+{
+    uint8 slaveAddress;         // 7 bit address
+    uint8 registerAddress;      // first register, auto incremented by the slave
+    uint8 direction;            // I2C_DIR_READ or I2C_DIR_WRITE
+    uint8 cnt;                  // bytes to read or write
+    uint8 *data;                // read destination or write source
+    uint16 timeoutUs;           // max time on the bus before the transfer is aborted
+    volatile uint8 status;      // I2C_STATUS_x, written by the engine
+    I2C_CALLBACK callback;      // called in interrupt context when finished, may be NULL
+    void *context;              // free for the owner of the request
+    uint8 faults;               // failed attempts of the last submit, retried ones included
+};
+
+typedef struct
+{
+    uint32 naks;                // attempts the slave did not acknowledge
+    uint32 busErrors;           // attempts that ended in arbitration loss or a bus error
+    uint32 timeouts;            // attempts aborted by the software timeout
+    uint32 stuck;               // hardware timeouts, SCL or SDA held low
+    uint32 retries;             // attempts repeated after a fault
+    uint32 recoveries;          // bus recoveries
+    uint32 unjammed;            // recoveries that had to clock SDA free
+    uint32 failed;              // requests that finished with an error after all retries
+} I2C_STATS;
+
+/***************************************
+*        Function Prototypes
+****************************************/
+
+void I2cEngine_Init(void);
+uint8 I2cEngine_Submit(I2C_REQUEST *req);
+void I2cEngine_Poll(void);
+uint8 I2cEngine_Wait(I2C_REQUEST *req);
+
+uint8 WriteByteToSlave(uint8 slaveAddress, uint8 registerAddress, uint8 wrData);                // Write to a register on MPU
+uint8 WriteBytesToSlave(uint8 slaveAddress, uint8 registerAddress, uint8 *wrData, uint8 cnt);   // Write consecutive registers on MPU
+uint8 ReadBytesFromSlave(uint8 slaveAddress, uint8 registerAddress, uint8 *rData, uint8 cnt);   // Return bytes from MPU register
+
+extern I2C_STATS i2cStats;
+
+#endif
+
+/* [] END OF FILE */
@@ -0,0 +1,44 @@
+/* ========================================
+ *
+ * Copyright YOUR COMPANY, THE YEAR
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CONFIDENTIAL AND PROPRIETARY INFORMATION
+ * WHICH IS THE PROPERTY OF your company.
+ *
+ * ========================================
+*/
+
+#include "impact.h"
+#include "impact_table.h"
+
+uint32 Impact_TimeLeftMs(uint32 fallMs, uint8 worstCase)
+{
+    /*
+        fallMs is the free-fall time so far. Between two table entries the
+        time left falls by exactly the time elapsed, so the remainder of the
+        step is subtracted instead of interpolating.
+    */
+
+    const uint16 *table = worstCase ? impactWorstMs : impactBestMs;
+    uint32 i = fallMs / IMPACT_STEP_MS;
+    uint32 part = fallMs - i * IMPACT_STEP_MS;
+
+    if(i >= IMPACT_TABLE_LEN)
+    {
+        return 0u;
+    }
+
+    return (table[i] > part) ? table[i] - part : 0u;
+}
+
+uint32 Impact_FireDelayMs(uint32 fallMs)
+{
+    // delay from now until the actuator has to be switched on, 0 when it is already late
+    uint32 left = Impact_TimeLeftMs(fallMs, TRUE);
+
+    return (left > IMPACT_ACTUATOR_LEAD_MS) ? left - IMPACT_ACTUATOR_LEAD_MS : 0u;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,48 @@
+/* ========================================
+ *
+ * Copyright YOUR COMPANY, THE YEAR
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CONFIDENTIAL AND PROPRIETARY INFORMATION
+ * WHICH IS THE PROPERTY OF your company.
+ *
+ * ========================================
+*/
+
+/*
+    Time to impact from the Freefall.m drop model.
+
+    The tables in impact_table.h are generated by host/gen_impact (make -C host
+    impact-table) for the device mass, the smallest and largest cross-section
+    and the design drop height. They give the time left until impact for every
+    elapsed free-fall time in IMPACT_STEP_MS steps, so a lookup is one index.
+
+    The actuator is scheduled from the worst case (least drag, earliest
+    impact) so that it has IMPACT_ACTUATOR_LEAD_MS to deploy before the earliest
+    possible impact. 175 ms reproduces the old fixed 43 ms delay for a
+    detection after ~100 ms of free fall from 0.5 m.
+*/
+
+#if !defined(IMPACT_H)
+#define IMPACT_H
+
+#include "imu_types.h"
+#include "main.h"
+
+/***************************************
+*            Constants
+****************************************/
+
+#define IMPACT_ACTUATOR_LEAD_MS (175u)  // actuator on to fully deployed
+
+/***************************************
+*        Function Prototypes
+****************************************/
+
+uint32 Impact_TimeLeftMs(uint32 fallMs, uint8 worstCase);
+uint32 Impact_FireDelayMs(uint32 fallMs);
+
+#endif
+
+/* [] END OF FILE */
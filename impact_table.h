@@ -0,0 +1,49 @@
+/* ========================================
+ *
+ * Copyright YOUR COMPANY, THE YEAR
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CONFIDENTIAL AND PROPRIETARY INFORMATION
+ * WHICH IS THE PROPERTY OF your company.
+ *
+ * ========================================
+*/
+
+/*
+    Generated by host/gen_impact from the Freefall.m model, do not edit.
+
+    mass 0.197 kg, height 0.5 m, cw 1.05, rho 1.225 kg/m3, g 9.82 m/s2, Euler step 0.0001 s
+    worst case A = 0.00064 m2: impact after 319.2 ms
+    best case  A = 0.01201 m2: impact after 320.2 ms
+    drag free:                impact after 319.1 ms
+
+    impactWorstMs[i] / impactBestMs[i]: ms left until impact after i * IMPACT_STEP_MS
+    of free fall, rounded down.
+*/
+
+#if !defined(IMPACT_TABLE_H)
+#define IMPACT_TABLE_H
+
+#include "imu_types.h"
+
+#define IMPACT_STEP_MS      (10u)
+#define IMPACT_TABLE_LEN    (33u)
+
+static const uint16 impactWorstMs[IMPACT_TABLE_LEN] =
+{
+     319,  309,  299,  289,  279,  269,  259,  249,  239,  229,  219,  209,
+     199,  189,  179,  169,  159,  149,  139,  129,  119,  109,   99,   89,
+      79,   69,   59,   49,   39,   29,   19,    9,    0
+};
+
+static const uint16 impactBestMs[IMPACT_TABLE_LEN] =
+{
+     320,  310,  300,  290,  280,  270,  260,  250,  240,  230,  220,  210,
+     200,  190,  180,  170,  160,  150,  140,  130,  120,  110,  100,   90,
+      80,   70,   60,   50,   40,   30,   20,   10,    0
+};
+
+#endif
+
+/* [] END OF FILE */
@@ -0,0 +1,307 @@
+/* ========================================
+ *
+ * Copyright YOUR COMPANY, THE YEAR
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CONFIDENTIAL AND PROPRIETARY INFORMATION
+ * WHICH IS THE PROPERTY OF your company.
+ *
+ * ========================================
+*/
+
+#include "imu_log.h"
+#include "crc16.h"
+
+// GetVarint results
+#define VARINT_OK       (0u)
+#define VARINT_SHORT    (1u)    // in ends inside the varint
+#define VARINT_BAD      (2u)    // longer than a uint32
+
+static uint32 Zigzag(int32 d)
+{
+    return ((uint32)d << 1) ^ (uint32)(d >> 31);
+}
+
+static int32 Unzigzag(uint32 z)
+{
+    return (int32)(z >> 1) ^ -(int32)(z & 1u);
+}
+
+static uint8 *PutVarint(uint8 *p, uint32 x)
+{
+    while(x >= 0x80u)
+    {
+        *p++ = (uint8)(x | 0x80u);
+        x >>= 7;
+    }
+    *p++ = (uint8)x;
+    return p;
+}
+
+static uint8 GetVarint(const uint8 *in, uint16 len, uint16 *pos, uint32 *x)
+{
+    uint32 v = 0;
+
+    for(uint8 shift = 0; shift < 35u; shift += 7u)
+    {
+        uint8 b;
+
+        if(*pos >= len)
+        {
+            return VARINT_SHORT;
+        }
+        b = in[(*pos)++];
+        v |= (uint32)(b & 0x7Fu) << shift;
+        if((b & 0x80u) == 0u)
+        {
+            *x = v;
+            return VARINT_OK;
+        }
+    }
+
+    return VARINT_BAD;
+}
+
+static uint8 *Put16(uint8 *p, uint16 x)
+{
+    p[0] = (uint8)x;
+    p[1] = (uint8)(x >> 8);
+    return p + 2;
+}
+
+static uint8 *Put32(uint8 *p, uint32 x)
+{
+    p[0] = (uint8)x;
+    p[1] = (uint8)(x >> 8);
+    p[2] = (uint8)(x >> 16);
+    p[3] = (uint8)(x >> 24);
+    return p + 4;
+}
+
+static uint16 Get16(const uint8 *p)
+{
+    return (uint16)(p[0] | (p[1] << 8));
+}
+
+static uint32 Get32(const uint8 *p)
+{
+    return (uint32)p[0] | ((uint32)p[1] << 8) | ((uint32)p[2] << 16) | ((uint32)p[3] << 24);
+}
+
+void ImuLog_InitEncoder(IMU_LOG_ENCODER *enc)
+{
+    IMU_FRAME zero = { 0 };
+
+    enc->last = zero;
+    enc->step = 0;
+    enc->sinceKey = 0;
+    enc->started = FALSE;
+    enc->keyNext = TRUE;
+}
+
+void ImuLog_Resync(IMU_LOG_ENCODER *enc)
+{
+    // records since the last key were lost on the way, start over with a key
+    enc->keyNext = TRUE;
+}
+
+uint16 ImuLog_Encode(IMU_LOG_ENCODER *enc, uint8 *out, const IMU_FRAME *frame)
+{
+    // one record for frame, out has room for IMU_LOG_MAX_RECORD. Returns its length
+    uint8 contiguous = enc->started && frame->seq == enc->last.seq + 1u;
+    uint32 step = contiguous ? frame->timestamp - enc->last.timestamp : 0u;
+    const int16 *mag = frame->magValid ? frame->mag : enc->last.mag;
+    uint8 *p = out;
+
+    if(enc->keyNext || !contiguous || enc->sinceKey >= IMU_LOG_KEY_INTERVAL)
+    {
+        *p++ = IMU_LOG_TAG_KEY;
+        p = Put32(p, frame->seq);
+        p = Put32(p, frame->timestamp);
+        p = Put32(p, step);
+        for(uint8 i = 0; i < 3u; i++)
+        {
+            p = Put16(p, (uint16)frame->accel[i]);
+        }
+        for(uint8 i = 0; i < 3u; i++)
+        {
+            p = Put16(p, (uint16)frame->gyro[i]);
+        }
+        p = Put16(p, (uint16)frame->temp);
+        for(uint8 i = 0; i < 3u; i++)
+        {
+            p = Put16(p, (uint16)mag[i]);
+        }
+        *p++ = frame->magValid ? IMU_LOG_MAG : 0u;
+        p = Put16(p, Crc16(out, (uint16)(p - out)));
+
+        enc->sinceKey = 1;
+        enc->keyNext = FALSE;
+    }
+    else
+    {
+        *p++ = IMU_LOG_TAG_DELTA | (frame->magValid ? IMU_LOG_MAG : 0u);
+        p = PutVarint(p, Zigzag((int32)(step - enc->step)));
+        for(uint8 i = 0; i < 3u; i++)
+        {
+            p = PutVarint(p, Zigzag((int32)frame->accel[i] - enc->last.accel[i]));
+        }
+        for(uint8 i = 0; i < 3u; i++)
+        {
+            p = PutVarint(p, Zigzag((int32)frame->gyro[i] - enc->last.gyro[i]));
+        }
+        p = PutVarint(p, Zigzag((int32)frame->temp - enc->last.temp));
+        if(frame->magValid)
+        {
+            for(uint8 i = 0; i < 3u; i++)
+            {
+                p = PutVarint(p, Zigzag((int32)frame->mag[i] - enc->last.mag[i]));
+            }
+        }
+
+        enc->sinceKey++;
+    }
+
+    enc->last.seq = frame->seq;
+    enc->last.timestamp = frame->timestamp;
+    for(uint8 i = 0; i < 3u; i++)
+    {
+        enc->last.accel[i] = frame->accel[i];
+        enc->last.gyro[i] = frame->gyro[i];
+        enc->last.mag[i] = mag[i];
+    }
+    enc->last.temp = frame->temp;
+    enc->step = step;
+    enc->started = TRUE;
+
+    return (uint16)(p - out);
+}
+
+void ImuLog_InitDecoder(IMU_LOG_DECODER *dec)
+{
+    IMU_FRAME zero = { 0 };
+
+    dec->last = zero;
+    dec->step = 0;
+    dec->synced = FALSE;
+    dec->keys = 0;
+    dec->deltas = 0;
+    dec->skipped = 0;
+}
+
+static uint8 DecodeDelta(IMU_LOG_DECODER *dec, const uint8 *in, uint16 len, uint16 *pos)
+{
+    // the varints after a delta tag into dec->last, VARINT_OK when they were all there
+    uint8 magValid = (in[0] & IMU_LOG_MAG) != 0u;
+    uint8 channels = magValid ? 11u : 8u;
+    uint32 z[11];
+    IMU_FRAME *f = &dec->last;
+
+    for(uint8 c = 0; c < channels; c++)
+    {
+        uint8 result = GetVarint(in, len, pos, &z[c]);
+
+        if(result != VARINT_OK)
+        {
+            return result;
+        }
+    }
+
+    dec->step += (uint32)Unzigzag(z[0]);
+    f->seq++;
+    f->timestamp += dec->step;
+    for(uint8 i = 0; i < 3u; i++)
+    {
+        f->accel[i] = (int16)(f->accel[i] + Unzigzag(z[1 + i]));
+        f->gyro[i] = (int16)(f->gyro[i] + Unzigzag(z[4 + i]));
+        if(magValid)
+        {
+            f->mag[i] = (int16)(f->mag[i] + Unzigzag(z[8 + i]));
+        }
+    }
+    f->temp = (int16)(f->temp + Unzigzag(z[7]));
+    f->magValid = magValid;
+
+    return VARINT_OK;
+}
+
+uint16 ImuLog_Decode(IMU_LOG_DECODER *dec, const uint8 *in, uint16 len, IMU_FRAME *frame, uint8 *ready)
+{
+    /*
+        One record from the front of in. Returns the bytes it used, with
+        *ready set when frame holds a sample. 0 when in ends inside the
+        record, call again with more. Bytes that are neither a good key nor
+        (once synced) a delta are skipped one at a time.
+    */
+
+    uint16 pos = 1;
+
+    *ready = FALSE;
+    if(len == 0u)
+    {
+        return 0u;
+    }
+
+    if(in[0] == IMU_LOG_TAG_KEY)
+    {
+        if(len < IMU_LOG_KEY_SIZE)
+        {
+            return 0u;
+        }
+        if(Crc16(in, IMU_LOG_KEY_SIZE - 2u) == Get16(in + IMU_LOG_KEY_SIZE - 2u))
+        {
+            IMU_FRAME *f = &dec->last;
+
+            f->seq = Get32(in + 1);
+            f->timestamp = Get32(in + 5);
+            dec->step = Get32(in + 9);
+            for(uint8 i = 0; i < 3u; i++)
+            {
+                f->accel[i] = (int16)Get16(in + 13 + 2 * i);
+                f->gyro[i] = (int16)Get16(in + 19 + 2 * i);
+                f->mag[i] = (int16)Get16(in + 27 + 2 * i);
+            }
+            f->temp = (int16)Get16(in + 25);
+            f->magValid = (in[33] & IMU_LOG_MAG) != 0u;
+            pos = IMU_LOG_KEY_SIZE;
+            dec->synced = TRUE;
+            dec->keys++;
+            *ready = TRUE;
+        }
+    }
+    else if(dec->synced && (in[0] & (uint8)~IMU_LOG_MAG) == IMU_LOG_TAG_DELTA)
+    {
+        uint8 result = DecodeDelta(dec, in, len, &pos);
+
+        if(result == VARINT_SHORT)
+        {
+            return 0u;
+        }
+        if(result == VARINT_OK)
+        {
+            dec->deltas++;
+            *ready = TRUE;
+        }
+    }
+
+    if(!*ready)
+    {
+        dec->synced = FALSE;
+        dec->skipped++;
+        return 1u;
+    }
+
+    *frame = dec->last;
+    if(!frame->magValid)
+    {
+        for(uint8 i = 0; i < 3u; i++)
+        {
+            frame->mag[i] = 0;      // dec->last keeps the last valid one for the next delta
+        }
+    }
+
+    return pos;
+}
+
+/* [] END OF FILE */
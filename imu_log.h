@@ -0,0 +1,116 @@
+/* ========================================
+ *
+ * Copyright YOUR COMPANY, THE YEAR
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CONFIDENTIAL AND PROPRIETARY INFORMATION
+ * WHICH IS THE PROPERTY OF your company.
+ *
+ * ========================================
+*/
+
+/*
+    Compressed IMU sample log: lossless for every IMU_FRAME field, a byte
+    stream that decodes front to back without any index.
+
+    Consecutive samples differ by little more than the sensor noise, so each
+    sample after a keyframe is coded as the difference to the one before it,
+    per channel, as a zigzag varint:
+
+        zigzag(d)   (d << 1) ^ (d >> 31), small |d| gives a small unsigned
+        varint      7 bits per byte, low group first, bit 7 set on all but
+                    the last byte: 0..127 is one byte, an int16 delta at most 3
+
+    The timestamp is coded as the change of its step (delta of delta), so a
+    steady sample clock costs a byte. seq is not stored, a delta record is
+    always seq + 1.
+
+    Records, all fixed fields little endian:
+
+        key     0   uint8   IMU_LOG_TAG_KEY
+                1   uint32  seq
+                5   uint32  timestamp
+                9   int32   step            timestamp - the one before, 0 unknown
+                13  int16   accel[3]
+                19  int16   gyro[3]
+                25  int16   temp
+                27  int16   mag[3]          last valid sample without IMU_LOG_MAG
+                33  uint8   flags           IMU_LOG_MAG: mag is this sample's
+                34  uint16  crc             Crc16 (crc16.h) over bytes 0..33
+
+        delta   0   uint8   IMU_LOG_TAG_DELTA | IMU_LOG_MAG when mag follows
+                    varint  zigzag(step - previous step)
+                    varint  zigzag(accel[0..2] - previous), gyro[0..2], temp
+                    varint  zigzag(mag[0..2] - last valid mag), only with IMU_LOG_MAG
+
+    The encoder writes a key on the first sample, every IMU_LOG_KEY_INTERVAL
+    samples, after a gap in seq and after ImuLog_Resync. A decoder that lost
+    its place (start in the middle, bytes missing, a bad key CRC) skips bytes
+    until a key with a good CRC. Deltas carry no CRC: a corrupted delta
+    shows up as wrong samples until the next key, at most
+    IMU_LOG_KEY_INTERVAL samples. Where bytes can get lost, frame the stream
+    with a CRC and call ImuLog_Desync after a bad frame (telemetry.h).
+
+    Encoding is a few shifts and compares per channel, no multiply or divide.
+    Cost per sample on the target is PROFILE_ENCODE with TELEMETRY_COMPACT,
+    sizes and host timing on traces come from host/imu_log.
+*/
+
+#if !defined(IMU_LOG_H)
+#define IMU_LOG_H
+
+#include "imu_types.h"
+#include "main.h"
+
+/***************************************
+*            Constants
+****************************************/
+
+#define IMU_LOG_TAG_KEY         (0xA5u)
+#define IMU_LOG_TAG_DELTA       (0x10u)
+#define IMU_LOG_MAG             (0x01u)     // delta tag / key flags: a magnetometer sample
+
+#define IMU_LOG_KEY_SIZE        (36u)
+#define IMU_LOG_MAX_RECORD      (36u)       // key, or a delta of 1 + 5 + 10 * 3 bytes
+#define IMU_LOG_KEY_INTERVAL    (100u)      // samples, 1 s at 100 Hz
+
+/***************************************
+*            Types
+****************************************/
+
+typedef struct
+{
+    IMU_FRAME last;                 // previous sample as coded, mag the last valid one
+    uint32 step;                    // timestamp step of the previous sample
+    uint16 sinceKey;                // records since the last key, the key included
+    uint8 started;                  // last holds a sample
+    uint8 keyNext;                  // the next record is a key
+} IMU_LOG_ENCODER;
+
+typedef struct
+{
+    IMU_FRAME last;                 // previous sample as decoded, mag the last valid one
+    uint32 step;
+    uint8 synced;                   // a key has been seen since the last loss
+    uint32 keys;                    // records decoded
+    uint32 deltas;
+    uint32 skipped;                 // bytes thrown away looking for a key
+} IMU_LOG_DECODER;
+
+/***************************************
+*        Function Prototypes
+****************************************/
+
+void ImuLog_InitEncoder(IMU_LOG_ENCODER *enc);
+void ImuLog_Resync(IMU_LOG_ENCODER *enc);
+uint16 ImuLog_Encode(IMU_LOG_ENCODER *enc, uint8 *out, const IMU_FRAME *frame);
+
+void ImuLog_InitDecoder(IMU_LOG_DECODER *dec);
+uint16 ImuLog_Decode(IMU_LOG_DECODER *dec, const uint8 *in, uint16 len, IMU_FRAME *frame, uint8 *ready);
+
+#define ImuLog_Desync(dec)      ((dec)->synced = FALSE)     // bytes were lost, wait for the next key
+
+#endif
+
+/* [] END OF FILE */
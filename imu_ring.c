@@ -0,0 +1,74 @@
+/* ========================================
+ *
+ * Copyright YOUR COMPANY, THE YEAR
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CONFIDENTIAL AND PROPRIETARY INFORMATION
+ * WHICH IS THE PROPERTY OF your company.
+ *
+ * ========================================
+*/
+
+#include "imu_ring.h"
+#include "main.h"
+
+#if (IMU_RING_SIZE & (IMU_RING_SIZE - 1u)) != 0u
+    #error "IMU_RING_SIZE must be a power of two"
+#endif
+
+#define RING_MASK   (IMU_RING_SIZE - 1u)
+
+static IMU_ROUND ring[IMU_RING_SIZE];
+static volatile uint32 head = 0;        // written by the producer only, free running
+static volatile uint32 tail = 0;        // written by the consumer only, free running
+static volatile uint32 overruns = 0;    // rounds dropped because the ring was full
+
+uint8 ImuRing_Push(const IMU_ROUND *round)
+{
+    // Producer side, called from the acquisition interrupt. Returns FALSE if the round was dropped.
+    uint32 h = head;
+    
+    if((h - tail) >= IMU_RING_SIZE)
+    {
+        overruns++;
+        return FALSE;
+    }
+    
+    ring[h & RING_MASK] = *round;
+    __DMB();                            // round must be in memory before the consumer can see the new head
+    head = h + 1u;
+    
+    return TRUE;
+}
+
+uint8 ImuRing_Pop(IMU_ROUND *round)
+{
+    // Consumer side, called from the main loop. Returns FALSE when the ring is empty.
+    uint32 t = tail;
+    
+    if(head == t)
+    {
+        return FALSE;
+    }
+    
+    __DMB();                            // read the round only after head was seen
+    *round = ring[t & RING_MASK];
+    __DMB();                            // done with the slot before handing it back to the producer
+    tail = t + 1u;
+    
+    return TRUE;
+}
+
+uint8 ImuRing_Pending(void)
+{
+    // Consumer side, TRUE while a round is waiting for ImuRing_Pop
+    return (head != tail) ? TRUE : FALSE;
+}
+
+uint32 ImuRing_Overruns(void)
+{
+    return overruns;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,57 @@
+/* ========================================
+ *
+ * Copyright YOUR COMPANY, THE YEAR
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CONFIDENTIAL AND PROPRIETARY INFORMATION
+ * WHICH IS THE PROPERTY OF your company.
+ *
+ * ========================================
+*/
+
+/*
+    Lock-free single producer / single consumer ring of sample rounds, one
+    IMU_FRAME per MPU (mpu9250.h).
+
+    The producer is the acquisition interrupt (ImuRing_Push), the consumer is the
+    main loop (ImuRing_Pop). Each side only writes its own index, so no critical
+    sections are needed. When the ring is full the new round is dropped and
+    counted, the consumer sees the gap in the sequence numbers.
+*/
+
+#if !defined(IMU_RING_H)
+#define IMU_RING_H
+
+#include "imu_types.h"
+#include "main.h"
+
+/***************************************
+*            Constants
+****************************************/
+
+#define IMU_RING_SIZE   (16u)   // rounds, must be a power of two. 160 ms at 100 Hz
+
+/***************************************
+*            Types
+****************************************/
+
+// One sample period of all devices. Every frame has the round's seq and timestamp
+typedef struct
+{
+    IMU_FRAME frame[MPU_DEVICE_COUNT];
+    uint8 valid;                // bit i set: frame[i] was read without error
+} IMU_ROUND;
+
+/***************************************
+*        Function Prototypes
+****************************************/
+
+uint8 ImuRing_Push(const IMU_ROUND *round);
+uint8 ImuRing_Pop(IMU_ROUND *round);
+uint8 ImuRing_Pending(void);
+uint32 ImuRing_Overruns(void);
+
+#endif
+
+/* [] END OF FILE */
@@ -0,0 +1,57 @@
+/* ========================================
+ *
+ * Copyright YOUR COMPANY, THE YEAR
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CONFIDENTIAL AND PROPRIETARY INFORMATION
+ * WHICH IS THE PROPERTY OF your company.
+ *
+ * ========================================
+*/
+
+#if !defined(IMU_TYPES_H)
+#define IMU_TYPES_H
+
+#if defined(HOST_BUILD)
+    // Same names as cytypes.h so the processing core also builds on the host (host/Makefile)
+    #include <stdint.h>
+    typedef uint8_t     uint8;
+    typedef uint16_t    uint16;
+    typedef uint32_t    uint32;
+    typedef uint64_t    uint64;
+    typedef int8_t      int8;
+    typedef int16_t     int16;
+    typedef int32_t     int32;
+    typedef int64_t     int64;
+    #define CY_INLINE   inline
+#else
+    #include "project.h"
+#endif
+
+/***************************************
+*            Constants
+****************************************/
+
+#define IMU_FULL_SCALE      (32767)     // |raw| accel or gyro at or above this is saturated
+
+/***************************************
+*            Types
+****************************************/
+
+// One decoded MPU sample as handed from the acquisition interrupt to the main loop
+typedef struct
+{
+    uint32 timestamp;       // Timebase cycles when the read of this sample was started
+    uint32 seq;             // +1 per published sample, a gap means samples were lost
+    int16 accel[3];         // XYZ for accelerometer, raw counts
+    int16 gyro[3];          // XYZ for gyroscope, raw counts
+    int16 temp;             // Die temperature, raw counts
+    int16 mag[3];           // XYZ for magnetometer in the accel/gyro axes, 0.15 uT counts (MAGNETOMETER)
+    uint8 magValid;         // mag holds a magnetometer sample, FALSE without one
+    uint8 saturated;        // an accel or gyro axis was at IMU_FULL_SCALE before Calib_Update corrected it
+} IMU_FRAME;
+
+#endif
+
+/* [] END OF FILE */
@@ -13,287 +13,362 @@
 
 #include "project.h"
 #include "main.h"
+#include "i2c_engine.h"
+#include "imu_ring.h"
+#include "detect.h"
+#include "fusion.h"
+#include "mpu9250.h"
+#include "profile.h"
+#include "deferred.h"
+#include "power.h"
+#include "telemetry.h"
+#include "calib.h"
+#include "vote.h"
+#include "timebase.h"
+#include "scheduler.h"
+#include "blackbox.h"
 #include <stdio.h>
-#include <math.h>
 #include "stdlib.h"
 
+#define SAMPLE_PERIOD_MS        (1000u / MPU_SAMPLE_RATE_HZ)
+#define MAINTENANCE_PERIOD_MS   (1000u)
 
+// Rate groups, index = priority. The fall path drains from its last stage, a round is only taken once the previous one is decided
+#define TASK_DETECT             (0u)
+#define TASK_FUSE               (1u)
+#define TASK_ACQUIRE            (2u)
+#define TASK_TELEMETRY          (3u)
+
+static void FireActuator(DEFERRED_ACTION *action);
+static void DetectTask(void);
+static void FuseTask(void);
+static void AcquireTask(void);
+static void MaintenanceTask(void);
+#ifdef TELEMETRY
+    static void TelemetryTask(void);
+#endif
+
+static const SCHEDULER_TASK tasks[] =
+{
+    { DetectTask,       NULL,               0u,                     SAMPLE_PERIOD_MS },         // released by FuseTask
+    { FuseTask,         NULL,               0u,                     SAMPLE_PERIOD_MS },         // released by AcquireTask
+    { AcquireTask,      ImuRing_Pending,    0u,                     SAMPLE_PERIOD_MS },         // a round in the ring
+#ifdef TELEMETRY
+    { TelemetryTask,    NULL,               0u,                     SAMPLE_PERIOD_MS },         // released by DetectTask
+#endif
+    { MaintenanceTask,  NULL,               MAINTENANCE_PERIOD_MS,  MAINTENANCE_PERIOD_MS },    // flash, sleep, reports
+};
 
-// Function declaration 
 
-uint8 WriteByteToSlave(uint8 slaveAddress, uint8 registerAddress, uint8 wrData );                   // Write to a register on MPU
-uint8 ReadBytesFromSlave(uint8 slaveAddress, uint8 registerAddress, uint16* wrData, uint8 cnt );     // Return bytes from MPU register
     
 /* Global variable declaration */
-    uint16 SensorDrop[12];  // For fetching data from MPU
-    int16 AccelXYZ[3];     // XYZ for accelerometer
-    int16 GyroXYZ[3];      // XYZ for gyroscope
-    int16 accOff[3];
-    int16 accPre[3] = {0};
+    IMU_ROUND imuRound;         // Samples of all MPUs being processed
+    IMU_FRAME frame;            // Sample of the device the vote chose
+    uint32 expectedSeq = 0;     // Sequence number of the next round
+    uint32 lostFrames = 0;      // Rounds that never reached the main loop
 
-    float acc[10] = {0};      // Accelerometer array
-    
-    float accAvg = 0;
-    int accLim = 0;
-    float sum = 0;
-    int accPos = 0;
-    
-    float accCurrent = 0;
-    float accTmp = 0;
-    
-    double roll , pitch;
+    VOTE_STATE vote;            // Orientation filters per MPU and the vote between them
+    FUSION_OUT fused;           // Voted result for the current round
+    DETECT_STATE detector;      // Free-fall decision
+    DEFERRED_ACTION fireAction = { FireActuator, NULL, 0, FALSE };  // actuator on, detector.fireDelayMs after detection
+    uint8 calibSaveRequested = FALSE;   // offsets changed, write them once the ring is empty
+    uint16 schedulerLoad = 0;           // busy share of the last maintenance period, permille (scheduler.h)
     
-    float phi = 0;
-    float theta = 0;
-    long int pre_ts=0;
+#ifdef LOW_POWER
+    uint8 sleepRequested = FALSE;   // still long enough, sleep once the ring is empty
+#endif
     
-    float phi_n_1, theta_n_1;
-    float phi_dot, theta_dot, phi_quat, theta_quat;
-    long gyro_x_cal, gyro_y_cal;
+#ifdef BLACKBOX
+    BLACKBOX_STATE blackbox;        // raw samples, frozen around the last fall until drained
+#endif
     
-    float Q[4] = {1,0,0,0} ; 
-    float Q_dot [4] ;
-    float Q_pre [4] = {1,0,0,0};
+#ifdef TELEMETRY
+    IMU_FRAME telemetryFrame;       // copy of the decided round, the next one may overwrite frame/fused first
+    FUSION_OUT telemetryOut;
+    uint8 telemetryFlags;
+#endif
     
-    int filtered_roll = 0;
-    int filtered_pitch = 0;
+#ifdef FUSION_COMPARE
+    // All fusion paths on every frame, cycles in Timebase ticks. Read with the debugger.
+    FUSION_FLOAT_STATE cmpFloat;
+    FUSION_FIXED_STATE cmpFixed;
+    FUSION_QUAT_STATE cmpMadgwick;
+    FUSION_QUAT_STATE cmpMahony;
+    uint32 cmpFloatTicks = 0;       // sum over cmpFrames
+    uint32 cmpFixedTicks = 0;
+    uint32 cmpMadgwickTicks = 0;
+    uint32 cmpMahonyTicks = 0;
+    uint32 cmpFrames = 0;
+    int32 cmpMaxAngleErr = 0;       // max |roll/pitch| difference, deg Q16
+    uint32 cmpLimMismatch = 0;      // frames where accLim/rollLim/pitchLim differ
+#endif
     
-    int pitchLim = 0;
-    int rollLim = 0;
-    
-    // Variables for UART tx
-    int8 txX = 0;
-    int8 txY = 0;
-    int8 txZ = 0;
-    int8 txRoll = 0;
-    int8 txPitch = 0;
-    
-    uint32 sysStart=0, sysStop=0; // Variables for code timing
+#ifdef PROFILE
+    // Profile_Format of every stage, refreshed by MaintenanceTask. Watch with the debugger.
+    char profileReport[PROFILE_STAGES][PROFILE_LINE_SIZE];
+    uint32 sampleStart;             // AcquireTask took the round, PROFILE_SAMPLE ends in DetectTask
+#endif
     
 
+static void FireActuator(DEFERRED_ACTION *action)
+{
+    // SysTick interrupt, the detection has not been cleared before the time to impact (impact.h) ran out
+    LED_GREEN_Write(TRUE);
+}
+
  CY_ISR(DATA_polling) // periodic polling interrupt
 {
-    ReadBytesFromSlave(MPU_ADDRESS,0x3b,SensorDrop,6); //read accel data from MPU to an array
-    
-    ReadBytesFromSlave(MPU_ADDRESS,0x43,&SensorDrop[6],6);
-    
-    for(uint8 i=0,j=0;i<=2;i++,j+=2)   // combines high and low bytes to one number
-    {      
-        AccelXYZ[i]=((SensorDrop[j]<< HIGH_BYTE_OFFSET)|(SensorDrop[j+LOW_BYTE_OFFSET]));
-        
-        GyroXYZ[i]=((SensorDrop[j+GYRO_ARRAY_OFFSET_H]<< HIGH_BYTE_OFFSET)|SensorDrop[j+GYRO_ARRAY_OFFSET_L]);
+    I2cEngine_Poll();       // abort a transfer that has overrun its timeout
+#ifdef DATA_READY_SAMPLING
+    if(!MPU_DataReadyAlive())   // data-ready has stopped, keep sampling on the timer
+    {
+        uint8 intState = CyEnterCriticalSection();  // mpuAcq is shared with the other interrupts
+
+        mpuAcq.fallbackReads++;
+        CyExitCriticalSection(intState);
+        MPU_StartFrameRead();
     }
+#else
+    MPU_StartFrameRead();   // only kicks the burst read, the Master interrupt publishes the frame
+#endif
     
     Sampling_timer_ReadStatusRegister(); // reads the status register to clear interrupt
 }    
     
+#ifdef MPU_INT_PIN
+CY_ISR(DATA_ready) // MPU INT rising edge, new sample in the MPU
+{
+    MPU_DataReady();        // timestamps the sample, starts the read with DATA_READY_SAMPLING
+    
+    MPU_INT_ClearInterrupt(); // clears the pin interrupt
+}
+#endif
+
 int main(void)
 {
     CyGlobalIntEnable; /* Enable global interrupts. */
     
     /* Initialization/startup code */
+    Timebase_Start();                       // Cycle counter for I2C timeouts and profiling
+    Deferred_Init();                        // SysTick for the delayed actuator
+    Profile_Reset();
     Master_Start();                         // Initialize I2C component
+    if(!MPU_Init())                         // Transfer engine, MPU configuration and acquisition
+    {
+        LED_RED_Write(TRUE);                // an MPU did not take its configuration, see mpuDevices[].configErrors
+    }
+    Calib_Init();                           // Stored accel offset and gyro bias
+    Vote_Init(&vote);                       // Orientation filters
+    Detect_Init(&detector);
+#ifdef BLACKBOX
+    BlackBox_Init(&blackbox);
+#ifndef TELEMETRY
+    BlackBox_Start();                       // flash behind the stored window
+#endif
+#endif
+#ifdef LOW_POWER
+    Power_Init();
+#endif
+#ifdef FUSION_COMPARE
+    FusionFloat_Init(&cmpFloat);
+    FusionFixed_Init(&cmpFixed);
+    FusionQuat_Init(&cmpMadgwick);
+    FusionQuat_Init(&cmpMahony);
+#endif
+#ifdef TELEMETRY
+    Telemetry_Start();                      // UART and TX_DMA
+#endif
+#ifdef MPU_INT_PIN
+    Data_ready_intr_StartEx(DATA_ready);    // data-ready edges from the MPU
+#endif
     Poll_intr_StartEx(DATA_polling);        // ISR start call
     Sampling_timer_Start();                  // Timer for periodic interrupt
     
-    /* Infinite loop  */
-    for(;;)
-    {    
-        CySysTickClear(); // Clock counter
-        sysStart=CySysTickGetValue(); // Start counter for timing
-        
-        //__Fald detektions modul______________________________________________//
-        // check if new data is available and run there is
-        if(accPre[0] != AccelXYZ[0] || accPre[1] != AccelXYZ[1] || accPre[2] != AccelXYZ[2])
+    Scheduler_Start(tasks, sizeof(tasks) / sizeof(tasks[0]));    // after Deferred_Init, shares its SysTick
+    Scheduler_Run();                            // never returns
+}
+
+static void AcquireTask(void)
+{
+    // One round from the ring, the rest waits until this one is decided
+    if(!ImuRing_Pop(&imuRound))
+    {
+        return;
+    }
+#ifdef PROFILE
+    sampleStart = Timebase_Now();
+#endif
+    lostFrames += imuRound.frame[0].seq - expectedSeq;  // gap in sequence = overrun in the ring
+    expectedSeq = imuRound.frame[0].seq + 1u;
+
+    for(uint8 d = 0; d < MPU_DEVICE_COUNT; d++)
+    {
+        if((imuRound.valid & (1u << d)) && Calib_Update(d, &imuRound.frame[d]))  // refines on still samples, corrects in place
         {
-            accPre[0] = AccelXYZ[0];
-            accPre[1] = AccelXYZ[1];
-            accPre[2] = AccelXYZ[2];
-        
-            // Caltulates the absolute power with Pythagoras theorem and saves it to array
-            accTmp = acc[accPos];
-            
-            accCurrent = (sqrt(pow((float)AccelXYZ[0], 2) + pow((float)AccelXYZ[1], 2) + pow((float)AccelXYZ[2], 2))) / ACCELEROMETER_SENSITIVITY;
-            acc[accPos] = accCurrent;
-            
-            sum = (sum + acc[accPos] - accTmp);
-            
-            accLim = (int)sum * 10; // Ganges med 10 for at kunne finde 5% afvig i grænserne
-   
-            accPos++;
-            
-            if (accPos > 9)
-            {
-                accPos = 0;
-            }
-      
-            //__Orienterings modul______________________________________________//     
-            float accelX = AccelXYZ[0];
-            float accelY = AccelXYZ[1];
-            float accelZ = AccelXYZ[2];
-            float gyroX = GyroXYZ[0]/57.3;
-            float gyroY = GyroXYZ[1]/57.3;
-            float gyroZ = GyroXYZ[2]/57.3;
-            
-            // NORMALIZE ACCEL VALUES
-            float naccel = sqrt(pow(accelX, 2) + pow(accelY, 2) + pow(accelZ, 2));
-            accelX = accelX / naccel;
-            accelY = accelY / naccel;
-            accelZ = accelZ / naccel;
-            
-            //  Euler angle from accel
-            roll = atan2 (-accelX ,( sqrt((accelY * accelY) + (accelZ * accelZ))));
-            pitch = atan2 (accelY ,( sqrt((accelX * accelX) + (accelZ * accelZ))));
-            
-            // 1st step sensor fusion using complimentary filter
-            pitch = (0.98 * (pitch + gyroY * dt / 1000.0f) + 0.02 * (accelY)) * 57.3;
-            roll =  (0.98 * (roll + gyroX * dt / 1000.0f) + 0.02 * (accelX)) * 57.3;
-            
-            // Calculate quaternions
-            Q_dot[0] = -0.5* ((gyroX*Q_pre[1]) + (gyroY*Q_pre[2]) + (Q_pre[3]*gyroZ));
-            Q_dot[1] =  0.5* ((gyroX*Q_pre[0]) + (gyroZ*Q_pre[2]) - (Q_pre[3]*gyroY));
-            Q_dot[2] =  0.5* ((gyroY*Q_pre[0]) - (gyroZ*Q_pre[1]) + (Q_pre[3]*gyroX));
-            Q_dot[3] =  0.5* ((gyroZ*Q_pre[0]) + (gyroY*Q_pre[1]) - (Q_pre[2]*gyroX));
-            
-            // Store quaternions
-            Q[0] = Q_pre[0] + (Q_dot[0] * dt / 1000.0);
-            Q_pre[0] = Q[0];
-            Q[1] = Q_pre[1] + (Q_dot[1] * dt / 1000.0);
-            Q_pre[1] = Q[1];
-            Q[2] = Q_pre[2] + (Q_dot[2] * dt / 1000.0);
-            Q_pre[2] = Q[2];
-            Q[3] = Q_pre[3] + (Q_dot[3] * dt / 1000.0);
-            Q_pre[3] = Q[3];
-
-            // Normalize quaternions
-            double n = (sqrt((Q[0]*Q[0]) + (Q[1]*Q[1]) + (Q[2]*Q[2]) + (Q[3]*Q[3])));
-            float Q0 = Q[0] / n;
-            float Q1 = Q[1] / n;
-            float Q2 = Q[2] / n;
-            float Q3 = Q[3] / n;
-            
-            // Quaternion angles
-            phi_quat = atan2 (2*((Q0*Q1)+(Q2*Q3)), (0.5f-(Q1*Q1)-(Q2*Q2)));
-            theta_quat = asin (2*((Q0*Q2)-(Q1*Q3)));
-            
-            // 2nd step sensor fusion using complimentary filter
-            phi_quat = (0.98 * (phi_quat + gyroX * dt / 1000.0f) + 0.02 * (accelX)) * 57.3;
-            theta_quat = (0.98 * (theta_quat + gyroY * dt / 1000.0f) + 0.02 * (accelY)) * 57.3;
-
-            // Final filtration using complimentary filter
-            filtered_roll = 0.99 * (roll + roll * dt / 1000.0f) + 0.01 * (phi_quat);
-            filtered_pitch = 0.99 * (pitch + pitch * dt / 1000.0f) + 0.01 * (theta_quat);
-            
-            // Convert to absolute values
-            rollLim = abs(filtered_roll);
-            pitchLim = abs(filtered_pitch);
-            
-            // Offset to generate values form 0-180 instead of +-90
-            if(accelZ < 0)
-            {
-                rollLim = 180 - abs(filtered_roll);
-                pitchLim = 180 - abs(filtered_pitch);
-            }
-            
-            // if the average acceleration is between the given values, activate actuator
-            if(accLim < 5) // accLim avg of 10 datasets to minimize risk of false positive.
-            {
-                if(rollLim < 85 && pitchLim < 85)
-                {
-                    CyDelay(43);
-                    LED_GREEN_Write(TRUE);
-                }
-                if(rollLim > 85 || pitchLim > 85)
-                {
-                  LED_GREEN_Write(FALSE);
-                }
-            } 
-            if(accLim >= 5)
-            {
-                LED_GREEN_Write(FALSE);
-            }
-        }        
-        
-        #ifdef I2C_DEBUG
-        
-            //CyDelay(500);
-            //LED_BLUE_write(FALSE);
-            //LED_GREEN_Write(FALSE);
-            //LED_RED_Write(FALSE);
-        
-        #endif
-    }    
+            calibSaveRequested = TRUE;
+        }
+    }
+
+    Scheduler_Release(TASK_FUSE);
 }
 
-// Funktion definitions ///////////////////////////////////////////////////////////////////////////////
+static void FuseTask(void)
+{
+    uint8 chosen = Vote_Round(&vote, &imuRound, &fused);
 
- uint8 WriteByteToSlave(uint8 slaveAddress, uint8 registerAddress, uint8 wrData )
- {
-    uint8 status = I2C_ERROR;     
-       
-    (void) Master_MasterClearStatus();          // clears master status register 
-    
-    if(Master_MSTR_NO_ERROR == Master_MasterSendStart(slaveAddress,I2C_WRITE))
+    if(chosen == VOTE_NONE)
     {
-    Master_MasterWriteByte(registerAddress);    // write the register adress to slave
-    Master_MasterWriteByte(wrData);             // Write the actual byte to register
-    Master_MasterSendStop();                    // send stop condition
-    
-    status = I2C_SUCCES;
+        Detect_Skip(&detector);     // no usable sample, counted in vote.noneHealthy. The detector clock goes on
+        return;
     }
-    
-    return (status);
- }
-
- uint8 ReadBytesFromSlave(uint8 slaveAddress, uint8 registerAddress, uint16 *rData, uint8 cnt)
- { 
-   /* 
-        This funktion Sends a single byte to a given register, overwriting the register
-        of the MPU. The funktion has the following input: 
-    
-        uint8 slaveAddress      : The address of the slave/MPU
-    
-        uint8 registerAdresss   : Address of the register being written to
-    
-        uint8 wrData            : 8 bit byte written to register, given as a interger
-    
-        if the master starts communication the function will return a 1, and a 0 if failed
-    
-    */ 
-    
-   uint8 status = I2C_ERROR;
+    frame = imuRound.frame[chosen];
 
-   (void) Master_MasterClearStatus();          // clears master status register 
-    
-   if(Master_MSTR_NO_ERROR == Master_MasterSendStart(slaveAddress,I2C_READ))
+#ifdef FUSION_COMPARE
     {
-        Master_MasterWriteByte(registerAddress);    // send the register address to the MPU 
-        Master_MasterSendRestart(slaveAddress,1);   // send repeat start and read request
-        while(cnt--)
+        FUSION_OUT outFloat, outFixed, outQuat;
+        uint32 t0 = Timebase_Now();
+        FusionFloat_Update(&cmpFloat, &frame, &outFloat);
+        uint32 t1 = Timebase_Now();
+        FusionFixed_Update(&cmpFixed, &frame, &outFixed);
+        uint32 t2 = Timebase_Now();
+        FusionMadgwick_Update(&cmpMadgwick, &frame, &outQuat);
+        uint32 t3 = Timebase_Now();
+        FusionMahony_Update(&cmpMahony, &frame, &outQuat);
+        uint32 t4 = Timebase_Now();
+
+        cmpFloatTicks += t1 - t0;
+        cmpFixedTicks += t2 - t1;
+        cmpMadgwickTicks += t3 - t2;
+        cmpMahonyTicks += t4 - t3;
+        cmpFrames++;
+        if(abs(outFloat.rollQ16 - outFixed.rollQ16) > cmpMaxAngleErr)
+        {
+            cmpMaxAngleErr = abs(outFloat.rollQ16 - outFixed.rollQ16);
+        }
+        if(abs(outFloat.pitchQ16 - outFixed.pitchQ16) > cmpMaxAngleErr)
+        {
+            cmpMaxAngleErr = abs(outFloat.pitchQ16 - outFixed.pitchQ16);
+        }
+        if(outFloat.accLim != outFixed.accLim || outFloat.rollLim != outFixed.rollLim || outFloat.pitchLim != outFixed.pitchLim)
         {
-            if(cnt==0)                              // check if its the lasst byte sent, and send NAK
+            cmpLimMismatch++;
+        }
+    }
+#endif
+
+    Scheduler_Release(TASK_DETECT);
+}
+
+static void DetectTask(void)
+{
+    PROFILE_START(mark);
+    uint8 wasFiring = detector.actuator;
+    switch(Detect_Update(&detector, &fused))
+    {
+        case DETECT_FIRE:
+            if(!wasFiring)
             {
-                *rData++ = Master_MasterReadByte(Master_NAK_DATA);
+                (void) Deferred_Schedule(&fireAction, detector.fireDelayMs); // processing goes on meanwhile
             }
-            else                                    // Reads a byte from slave and return ack to slave
-            {
-                *rData++ = Master_MasterReadByte(Master_ACK_DATA);
-            }              
+            break;
+        case DETECT_CLEAR:
+            (void) Deferred_Cancel(&fireAction);    // later samples contradict the detection
+            LED_GREEN_Write(FALSE);
+            break;
+        default:
+            break;
+    }
+    PROFILE_LAP(PROFILE_DECISION, mark);
+    PROFILE_SINCE(PROFILE_SAMPLE, sampleStart);
+
+#ifdef BLACKBOX
+    BlackBox_Record(&blackbox, &frame, &fused, detector.state,
+                    (detector.actuator ? BLACKBOX_FLAG_ACTUATOR : 0u) | (fireAction.pending ? BLACKBOX_FLAG_PENDING : 0u));
+    if(detector.actuator && !wasFiring)
+    {
+        BlackBox_Trigger(&blackbox);        // freezes the samples around this one
+    }
+#endif
+
+#ifdef TELEMETRY
+    telemetryFrame = frame;
+    telemetryOut = fused;
+    telemetryFlags = (detector.actuator ? TELEMETRY_FLAG_ACTUATOR : 0u) | (fireAction.pending ? TELEMETRY_FLAG_PENDING : 0u);
+    Scheduler_Release(TASK_TELEMETRY);
+#endif
+
+#ifdef LOW_POWER
+    sleepRequested = Power_Update(&frame, detector.actuator || fireAction.pending);
+#endif
+}
+
+#ifdef TELEMETRY
+static void TelemetryTask(void)
+{
+#ifdef TELEMETRY_COMPACT
+    (void) Telemetry_SendLog(&telemetryFrame);
+#else
+    (void) Telemetry_Send(&telemetryFrame, &telemetryOut, telemetryFlags);
+#endif
+
+#ifdef BLACKBOX
+    // a frozen window goes out one record per sample, ~9700 bytes/s on the line together
+    const BLACKBOX_RECORD *record;
+    if(BlackBox_Peek(&blackbox, &record))
+    {
+        uint8 packet[BLACKBOX_PACKET_SIZE];
+
+        if(Telemetry_SendPacket(packet, BlackBox_Pack(packet, &blackbox, record)))
+        {
+            BlackBox_Consume(&blackbox, 1u);
         }
-        
-        Master_MasterSendStop();                    // Sends the stop condition and 
-        
-        status = I2C_SUCCES;
     }
-    
+#endif
+}
+#endif
 
-    
-    
-    return status;    
- }
+static void MaintenanceTask(void)
+{
+    // Once per MAINTENANCE_PERIOD_MS, only runs while the fall path has nothing waiting
+    schedulerLoad = Scheduler_LoadPermille();
 
+#ifdef PROFILE
+    for(uint8 s = 0; s < PROFILE_STAGES; s++)
+    {
+        (void) Profile_Format(s, profileReport[s], PROFILE_LINE_SIZE);
+    }
+#endif
 
-//////////////////////////////////////////////////////////////////////////////////////////////////////
+    if(calibSaveRequested && !detector.actuator && !fireAction.pending
+        && (detector.state == DETECT_IDLE || detector.state == DETECT_INACTIVE))
+    {
+        calibSaveRequested = FALSE;
+        Calib_Save();           // blocks for the flash write
+    }
+
+#if defined(BLACKBOX) && !defined(TELEMETRY)
+    if(!detector.actuator && !fireAction.pending && (detector.state == DETECT_IDLE || detector.state == DETECT_INACTIVE))
+    {
+        BlackBox_Store(&blackbox);  // a part of a frozen window, blocks for the flash write
+    }
+#endif
 
+#ifdef LOW_POWER
+    if(sleepRequested)
+    {
+        sleepRequested = FALSE;
+        Power_Sleep();          // back here when the MPU sees motion
+    }
+#endif
+
+    #ifdef I2C_DEBUG
+
+        //CyDelay(500);
+        //LED_BLUE_write(FALSE);
+        //LED_GREEN_Write(FALSE);
+        //LED_RED_Write(FALSE);
+
+    #endif
+}
 
 /* [] END OF FILE */
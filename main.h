@@ -20,28 +20,48 @@
 *            Constants
 ****************************************/
 
-// I2C relevant constants
-#define I2C_WRITE  (1)
-#define I2C_READ   (0)
-
-#define I2C_ERROR  (0u)
-#define I2C_SUCCES (1u)
-#define I2C_READ_BUFFER_MISMATCH (3)
-
 // MPU-9250 config
 #define MPU_ADDRESS         (0x68u)
+#define MPU_ADDRESS_ALT     (0x69u)     // second MPU-9250 with AD0 high
 #define ACCEL_START         (0x3b)
-#define GYRO_ARRAY_OFFSET_H (6u)
-#define GYRO_ARRAY_OFFSET_L (7u)
+#define GYRO_START          (0x43)
+#define MPU_FRAME_SIZE      (14u)       // ACCEL_XOUT_H (0x3b) through GYRO_ZOUT_L (0x48)
+#define ACCEL_SIZE          (6u)
+#define GYRO_SIZE           (6u)
+#define TEMP_ARRAY_OFFSET_H (6u)
+#define TEMP_ARRAY_OFFSET_L (7u)
+#define GYRO_ARRAY_OFFSET_H (8u)
+#define GYRO_ARRAY_OFFSET_L (9u)
 #define HIGH_BYTE_OFFSET    (8)
 #define LOW_BYTE_OFFSET     (1) 
-#define ACCELEROMETER_SENSITIVITY   (16384.0)   // 32768/2g
-#define GYROSCOPE_SENSITIVITY       (32.8)      // 32768/1000dps
+#define MPU_ACCEL_FS_SEL    (0u)        // ACCEL_CONFIG ACCEL_FS_SEL: 0 +-2 g, 1 +-4 g, 2 +-8 g, 3 +-16 g
+#define MPU_GYRO_FS_SEL     (2u)        // GYRO_CONFIG GYRO_FS_SEL: 0 +-250, 1 +-500, 2 +-1000, 3 +-2000 dps
+
+// Scale factors follow the full scale the configuration table (mpu9250.c) writes, never set them by hand
+#define MPU_ACCEL_LSB_PER_G         (16384 >> MPU_ACCEL_FS_SEL)
+#define ACCELEROMETER_SENSITIVITY   ((double)MPU_ACCEL_LSB_PER_G)   // 32768/2g at ACCEL_FS_SEL 0
+#define GYROSCOPE_SENSITIVITY       ((MPU_GYRO_FS_SEL == 0u) ? 131.0 : (MPU_GYRO_FS_SEL == 1u) ? 65.5 : \
+                                     (MPU_GYRO_FS_SEL == 2u) ? 32.8 : 16.4)     // LSB/dps, datasheet
 #define M_PI (3.14)	                    // Pi
 #define dt (0.01)							        // 10 ms sample rate!
 
 
 
+// Acquisition
+#define MPU_DEVICE_COUNT 1       // MPU-9250s read every sample period, at MPU_ADDRESS and MPU_ADDRESS_ALT (mpu9250.h, vote.h)
+#define MAGNETOMETER             // AK8963 read by the MPU's aux I2C master, in the same burst as accel and gyro (mpu9250.h)
+// #define MPU_INT_PIN          // MPU INT wired to the MPU_INT pin (rising edge) with the Data_ready_intr isr in TopDesign
+// #define DATA_READY_SAMPLING  // start reads on data-ready instead of Sampling_timer, needs MPU_INT_PIN
+// #define LOW_POWER            // sleep with the MPU in wake-on-motion while lying still (power.h), needs MPU_INT_PIN
+
+// Fusion
+// #define FUSION_FIXED_POINT   // integer-only fusion path (fusion_fixed.c) instead of the float reference
+// #define FUSION_COMPARE       // run all fusion paths on every frame, count cycles and deviations (main.c)
+#define FUSION_FAST_MATH         // polynomial sqrt/atan2/asin kernels (fastmath.h) instead of soft-float libm
+#define FUSION_ESTIMATOR 0       // 0 complementary filters (above), 1 Madgwick, 2 Mahony (fusion_quat.c)
+#define BLACKBOX                 // last 10 s of samples in SRAM, the window around a fall drained over TELEMETRY or to flash (blackbox.h)
+
+
 // system general 
 #define TRUE       (1u)
 #define FALSE      (0u)
@@ -49,6 +69,10 @@
 
 // Debugging
  #define I2C_DEBUG
-// #define TIMER_DEBUG
+// #define TIMER_DEBUG      // measure I2C bus time per sample with the cycle counter (see busTicks in mpu9250.c)
+// #define PROFILE          // per-stage cycle counts and log2 histograms (profile.h, profileReport in main.c)
+// #define SPLIT_READ       // old two-transaction accel/gyro read, for comparing bus time against the burst read
+// #define TELEMETRY        // every sample COBS framed on the UART through TX_DMA (telemetry.h), needs UART/TX_DMA/Tx_done_intr in TopDesign
+// #define TELEMETRY_COMPACT    // with TELEMETRY: raw samples delta coded (imu_log.h), ~13.5 bytes instead of 60, no fusion outputs
 
 /* [] END OF FILE */
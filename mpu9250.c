@@ -0,0 +1,547 @@
+/* ========================================
+ *
+ * Copyright YOUR COMPANY, THE YEAR
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CONFIDENTIAL AND PROPRIETARY INFORMATION
+ * WHICH IS THE PROPERTY OF your company.
+ *
+ * ========================================
+*/
+
+#include "mpu9250.h"
+#include "main.h"
+#include "i2c_engine.h"
+#include "imu_ring.h"
+#include "profile.h"
+#include "timebase.h"
+
+static void FrameComplete(I2C_REQUEST *req);
+static uint8 ApplyConfig(uint8 address);
+#ifdef MAGNETOMETER
+    static void MagInit(MPU_DEVICE *dev);
+    static void MagMode(const MPU_DEVICE *dev, uint8 mode);
+#endif
+
+/*
+    Register configuration of every MPU, written in this order. Entries with
+    consecutive register addresses form one run, written and read back in one
+    transaction each.
+*/
+static const MPU_REG_VALUE mpuConfig[] =
+{
+    { MPU_REG_PWR_MGMT_1,       MPU_PWR1_CLK_AUTO },                        // 0x6B awake, also after wake-on-motion
+    { MPU_REG_PWR_MGMT_2,       0x00u },                                    // 0x6C accel and gyro on
+    { MPU_REG_SMPLRT_DIV,       (MPU_INTERNAL_RATE_HZ / MPU_SAMPLE_RATE_HZ) - 1u },   // 0x19 1 kHz down to 100 Hz
+    { MPU_REG_CONFIG,           MPU_DLPF_41HZ },                            // 0x1A below the 50 Hz Nyquist limit
+    { MPU_REG_GYRO_CONFIG,      MPU_GYRO_FS_SEL << MPU_FS_SEL_SHIFT },      // 0x1B GYROSCOPE_SENSITIVITY
+    { MPU_REG_ACCEL_CONFIG,     MPU_ACCEL_FS_SEL << MPU_FS_SEL_SHIFT },     // 0x1C ACCELEROMETER_SENSITIVITY
+    { MPU_REG_ACCEL_CONFIG2,    MPU_A_DLPF_45HZ },                          // 0x1D
+    { MPU_REG_INT_PIN_CFG,      MPU_INT_PULSE_HIGH },                       // 0x37
+    { MPU_REG_INT_ENABLE,       MPU_INT_CONFIG },                           // 0x38
+    { MPU_REG_MOT_DETECT_CTRL,  0x00u },                                    // 0x69 wake-on-motion off
+};
+
+#define MPU_CONFIG_LEN  (sizeof(mpuConfig) / sizeof(mpuConfig[0]))
+
+/* Global variable declaration */
+    static const uint8 deviceAddress[] = { MPU_ADDRESS, MPU_ADDRESS_ALT };
+    static IMU_ROUND reading;               // round being read
+    static volatile uint8 roundPending = 0; // device reads of the round not finished yet
+    static uint32 kickTime = 0;     // when the read of the pending round was started
+    static uint32 sampleSeq = 0;    // sequence number of the next published round
+    
+    MPU_DEVICE mpuDevices[MPU_DEVICE_COUNT];
+    volatile uint32 frameErrors = 0;
+    volatile uint32 frameSkips = 0;
+
+#ifdef MPU_INT_PIN
+    static volatile uint32 drdyTime = 0;    // last data-ready edge
+    static volatile uint32 drdyCount = 0;   // data-ready edges since the last read start
+    static uint32 sampleTime = 0;           // data-ready edge of the sample being read
+    static uint8 sampleTimed = FALSE;       // sampleTime is valid
+
+    MPU_ACQ_STATS mpuAcq = { 0, 0xFFFFFFFFu, 0, 0xFFFFFFFFu, 0, 0, 0, 0, 0, 0 };
+
+#endif
+
+#ifdef LOW_POWER
+    static volatile uint8 womMode = FALSE;      // MPU in wake-on-motion, INT means motion not data ready
+    static volatile uint8 motionWake = FALSE;   // wake-on-motion pulse seen
+#endif
+
+#if MPU_DEVICE_COUNT < 1 || MPU_DEVICE_COUNT > 2
+    #error "MPU_DEVICE_COUNT: one I2C bus, the MPU-9250 has two addresses"
+#endif
+
+#if (MPU_BURST_SIZE + 3u) > I2C_DEFAULT_BYTES
+    #error "MPU_BURST_SIZE: the burst with its three address bytes outgrows I2C_DEFAULT_TIMEOUT_US"
+#endif
+
+#ifdef TIMER_DEBUG
+    // I2C bus time per sample in cycles, from kick to completion. Divide by TIMEBASE_TICKS_PER_US for us.
+    // Build once with and once without SPLIT_READ and compare busTicksSum/busReads.
+    volatile uint32 busTicks = 0;
+    volatile uint32 busTicksMax = 0;
+    volatile uint32 busTicksSum = 0;
+    volatile uint32 busReads = 0;
+#endif
+
+static void InitRequest(I2C_REQUEST *req, MPU_DEVICE *dev, uint8 reg, uint8 cnt, uint8 *data, I2C_CALLBACK callback)
+{
+    req->slaveAddress = dev->address;
+    req->registerAddress = reg;
+    req->direction = I2C_DIR_READ;
+    req->cnt = cnt;
+    req->data = data;
+    req->timeoutUs = I2C_DEFAULT_TIMEOUT_US;
+    req->status = I2C_STATUS_IDLE;
+    req->callback = callback;
+    req->context = dev;
+}
+
+uint8 MPU_Init(void)
+{
+    // Blocking. TRUE when every device holds the configuration table
+    uint8 configured = TRUE;
+
+    I2cEngine_Init();
+
+    for(uint8 i = 0; i < MPU_DEVICE_COUNT; i++)
+    {
+        MPU_DEVICE *dev = &mpuDevices[i];
+
+        dev->address = deviceAddress[i];
+        dev->index = i;
+        dev->errors = 0;
+#ifdef SPLIT_READ
+        InitRequest(&dev->accelReq, dev, ACCEL_START, ACCEL_SIZE, dev->raw, NULL);
+        InitRequest(&dev->frameReq, dev, GYRO_START, GYRO_SIZE + (MPU_BURST_SIZE - MPU_FRAME_SIZE), &dev->raw[GYRO_ARRAY_OFFSET_H], FrameComplete);
+#else
+        InitRequest(&dev->frameReq, dev, ACCEL_START, MPU_BURST_SIZE, dev->raw, FrameComplete);
+#endif
+        dev->configErrors = ApplyConfig(dev->address);
+        if(dev->configErrors != 0u)
+        {
+            configured = FALSE;
+        }
+#ifdef MAGNETOMETER
+        MagInit(dev);
+#endif
+    }
+
+    return configured;
+}
+
+static uint8 RunLength(uint8 first)
+{
+    // entries from first on with consecutive register addresses, at most one I2C write
+    uint8 n = 1;
+
+    while((first + n < MPU_CONFIG_LEN) && (n < I2C_MAX_WRITE) &&
+          (mpuConfig[first + n].reg == (uint8)(mpuConfig[first + n - 1u].reg + 1u)))
+    {
+        n++;
+    }
+
+    return n;
+}
+
+static uint8 ApplyConfig(uint8 address)
+{
+    /*
+        Blocking. Writes mpuConfig run by run, then reads every run back. Returns
+        the number of registers that do not hold their value, a failed read
+        counts its whole run.
+    */
+
+    uint8 buffer[I2C_MAX_WRITE];
+    uint8 errors = 0;
+    uint8 i;
+    uint8 n;
+
+    for(i = 0; i < MPU_CONFIG_LEN; i += n)
+    {
+        n = RunLength(i);
+        for(uint8 k = 0; k < n; k++)
+        {
+            buffer[k] = mpuConfig[i + k].value;
+        }
+        (void) WriteBytesToSlave(address, mpuConfig[i].reg, buffer, n);
+    }
+
+    for(i = 0; i < MPU_CONFIG_LEN; i += n)
+    {
+        n = RunLength(i);
+        if(ReadBytesFromSlave(address, mpuConfig[i].reg, buffer, n) != I2C_STATUS_DONE)
+        {
+            errors += n;
+            continue;
+        }
+        for(uint8 k = 0; k < n; k++)
+        {
+            if(buffer[k] != mpuConfig[i + k].value)
+            {
+                errors++;
+            }
+        }
+    }
+
+    return errors;
+}
+
+#ifdef MAGNETOMETER
+static void MagInit(MPU_DEVICE *dev)
+{
+    /*
+        Blocking, startup only. Talks to the AK8963 through the bypass, then
+        hands it to the MPU's I2C master. Without an answer magAdj stays 0 and
+        the frames of this device have magValid FALSE.
+    */
+
+    uint8 address = dev->address;
+    uint8 id = 0;
+    uint8 present;
+
+    dev->magSeen = FALSE;
+    for(uint8 i = 0; i < 3u; i++)
+    {
+        dev->magAdj[i] = 0;
+        dev->mag[i] = 0;
+    }
+
+    (void) WriteByteToSlave(address, MPU_REG_USER_CTRL, 0x00u);
+    (void) WriteByteToSlave(address, MPU_REG_INT_PIN_CFG, MPU_INT_BYPASS_EN);
+
+    present = (ReadBytesFromSlave(AK_ADDRESS, AK_REG_WIA, &id, 1u) == I2C_STATUS_DONE) && (id == AK_WIA_VALUE);
+    if(present)
+    {
+        (void) WriteByteToSlave(AK_ADDRESS, AK_REG_CNTL1, AK_CNTL1_POWER_DOWN);
+        CyDelayUs(AK_MODE_DELAY_US);
+        (void) WriteByteToSlave(AK_ADDRESS, AK_REG_CNTL1, AK_CNTL1_FUSE_ROM);
+        CyDelayUs(AK_MODE_DELAY_US);
+        present = (ReadBytesFromSlave(AK_ADDRESS, AK_REG_ASAX, dev->magAdj, 3u) == I2C_STATUS_DONE);
+        (void) WriteByteToSlave(AK_ADDRESS, AK_REG_CNTL1, AK_CNTL1_POWER_DOWN);
+        CyDelayUs(AK_MODE_DELAY_US);
+        (void) WriteByteToSlave(AK_ADDRESS, AK_REG_CNTL1, AK_CNTL1_16BIT_100HZ);
+    }
+
+    (void) WriteByteToSlave(address, MPU_REG_INT_PIN_CFG, MPU_INT_PULSE_HIGH);    // bypass off again
+
+    if(!present)
+    {
+        dev->magAdj[0] = dev->magAdj[1] = dev->magAdj[2] = 0;
+        return;
+    }
+
+    (void) WriteByteToSlave(address, MPU_REG_I2C_MST_CTRL, MPU_MST_WAIT_400KHZ);
+    (void) WriteByteToSlave(address, MPU_REG_I2C_SLV0_ADDR, MPU_SLV_READ | AK_ADDRESS);
+    (void) WriteByteToSlave(address, MPU_REG_I2C_SLV0_REG, AK_REG_ST1);
+    (void) WriteByteToSlave(address, MPU_REG_I2C_SLV0_CTRL, MPU_SLV_EN | MPU_MAG_SIZE);
+    (void) WriteByteToSlave(address, MPU_REG_USER_CTRL, MPU_USER_I2C_MST_EN);
+}
+
+static void MagMode(const MPU_DEVICE *dev, uint8 mode)
+{
+    // Blocking. New AK8963 CNTL1 mode through the bypass, the I2C master runs again unless powered down
+    if(dev->magAdj[0] == 0u)
+    {
+        return;
+    }
+
+    (void) WriteByteToSlave(dev->address, MPU_REG_USER_CTRL, 0x00u);
+    (void) WriteByteToSlave(dev->address, MPU_REG_INT_PIN_CFG, MPU_INT_BYPASS_EN);
+    (void) WriteByteToSlave(AK_ADDRESS, AK_REG_CNTL1, AK_CNTL1_POWER_DOWN);
+    CyDelayUs(AK_MODE_DELAY_US);
+    if(mode != AK_CNTL1_POWER_DOWN)
+    {
+        (void) WriteByteToSlave(AK_ADDRESS, AK_REG_CNTL1, mode);
+    }
+    (void) WriteByteToSlave(dev->address, MPU_REG_INT_PIN_CFG, MPU_INT_PULSE_HIGH);
+    if(mode != AK_CNTL1_POWER_DOWN)
+    {
+        (void) WriteByteToSlave(dev->address, MPU_REG_USER_CTRL, MPU_USER_I2C_MST_EN);
+    }
+}
+
+static void DecodeMag(MPU_DEVICE *dev, IMU_FRAME *frame, const uint8 *ext)
+{
+    // EXT_SENS_DATA: ST1, HXL, HXH, HYL, HYH, HZL, HZH, ST2. Little endian, unlike the MPU's own registers
+    if(((ext[0] & AK_ST1_DRDY) != 0u) && ((ext[7] & AK_ST2_HOFL) == 0u))
+    {
+        int32 h[3];
+
+        for(uint8 i = 0; i < 3u; i++)
+        {
+            int16 v = (int16)(ext[1u + 2u * i] | (ext[2u + 2u * i] << HIGH_BYTE_OFFSET));
+
+            h[i] = ((int32)v * ((int32)dev->magAdj[i] + 128)) >> 8;    // H * ((ASA - 128) / 256 + 1)
+        }
+        dev->mag[0] = (int16)h[1];
+        dev->mag[1] = (int16)h[0];
+        dev->mag[2] = (int16)-h[2];
+        dev->magSeen = TRUE;
+    }
+
+    frame->mag[0] = dev->mag[0];
+    frame->mag[1] = dev->mag[1];
+    frame->mag[2] = dev->mag[2];
+    frame->magValid = dev->magSeen;
+}
+#endif
+
+#ifdef LOW_POWER
+void MPU_EnterWakeOnMotion(void)
+{
+    /*
+        Accel-only low power cycling with the wake-on-motion interrupt, the
+        sequence from the MPU-9250 register map (Wake-on-Motion Interrupt). The
+        INT pin then pulses once when any axis changes by more than
+        MPU_WOM_THRESHOLD between two low power samples.
+    */
+
+    motionWake = FALSE;
+    womMode = TRUE;             // MPU_DataReady only flags the wake from here on
+
+#ifdef MAGNETOMETER
+    for(uint8 i = 0; i < MPU_DEVICE_COUNT; i++)
+    {
+        MagMode(&mpuDevices[i], AK_CNTL1_POWER_DOWN);   // the I2C master would keep the MPU busy
+    }
+#endif
+    for(uint8 i = 1; i < MPU_DEVICE_COUNT; i++)
+    {
+        (void) WriteByteToSlave(mpuDevices[i].address, MPU_REG_PWR_MGMT_1, MPU_PWR1_SLEEP);  // only device 0 watches
+    }
+    (void) WriteByteToSlave(MPU_ADDRESS, MPU_REG_PWR_MGMT_1, 0x00u);
+    (void) WriteByteToSlave(MPU_ADDRESS, MPU_REG_PWR_MGMT_2, MPU_PWR2_GYRO_OFF);
+    (void) WriteByteToSlave(MPU_ADDRESS, MPU_REG_ACCEL_CONFIG2, MPU_A_DLPF_WOM);
+    (void) WriteByteToSlave(MPU_ADDRESS, MPU_REG_INT_ENABLE, MPU_INT_WOM_EN);
+    (void) WriteByteToSlave(MPU_ADDRESS, MPU_REG_MOT_DETECT_CTRL, MPU_ACCEL_INTEL_COMPARE);
+    (void) WriteByteToSlave(MPU_ADDRESS, MPU_REG_WOM_THR, MPU_WOM_THRESHOLD);
+    (void) WriteByteToSlave(MPU_ADDRESS, MPU_REG_LP_ACCEL_ODR, MPU_WOM_ODR);
+    (void) WriteByteToSlave(MPU_ADDRESS, MPU_REG_PWR_MGMT_1, MPU_PWR1_CYCLE);
+}
+
+void MPU_ExitWakeOnMotion(void)
+{
+    // Back to full rate accel and gyro. The gyro needs ~35 ms to settle, the accel is valid at once
+    for(uint8 i = 0; i < MPU_DEVICE_COUNT; i++)
+    {
+        mpuDevices[i].configErrors = ApplyConfig(mpuDevices[i].address);    // the table wakes and restores everything
+#ifdef MAGNETOMETER
+        MagMode(&mpuDevices[i], AK_CNTL1_16BIT_100HZ);
+#endif
+    }
+
+    womMode = FALSE;
+}
+
+uint8 MPU_MotionWake(void)
+{
+    return motionWake;
+}
+#endif
+
+#ifdef MPU_INT_PIN
+void MPU_DataReady(void)
+{
+    // Data_ready_intr, rising edge of the MPU INT pin: a new sample is in the output registers
+#ifdef LOW_POWER
+    if(womMode)
+    {
+        motionWake = TRUE;      // wake-on-motion pulse, the I2C block may be asleep
+        return;
+    }
+#endif
+    drdyTime = Timebase_Now();
+    drdyCount++;
+
+#ifdef DATA_READY_SAMPLING
+    (void) MPU_StartFrameRead();
+#endif
+}
+
+uint8 MPU_DataReadyAlive(void)
+{
+    // FALSE when no data-ready edge has come for MPU_DRDY_TIMEOUT_PERIODS sample periods
+    return (Timebase_Now() - drdyTime) < TIMEBASE_TICKS(MPU_DRDY_TIMEOUT_PERIODS * (1000000u / MPU_SAMPLE_RATE_HZ));
+}
+
+static void AcqStart(uint32 now)
+{
+    /*
+        Counts the data-ready edges since the previous read start. drdyCount/drdyTime
+        are shared with Data_ready_intr and mpuAcq is also written by the Master and
+        Sampling_timer interrupts, so all of it is updated in one critical section.
+    */
+    uint32 period = now - kickTime;
+    uint32 edges;
+    uint8 intState = CyEnterCriticalSection();
+
+    edges = drdyCount;
+    drdyCount = 0;
+    sampleTime = drdyTime;
+
+    if(mpuAcq.reads != 0u)
+    {
+        if(period < mpuAcq.periodMin)
+        {
+            mpuAcq.periodMin = period;
+        }
+        if(period > mpuAcq.periodMax)
+        {
+            mpuAcq.periodMax = period;
+        }
+    }
+    mpuAcq.reads++;
+
+    if(edges == 0u)
+    {
+        mpuAcq.duplicates++;        // same sample as last time
+        sampleTimed = FALSE;
+    }
+    else
+    {
+        mpuAcq.missed += edges - 1u;
+        sampleTimed = TRUE;
+    }
+    CyExitCriticalSection(intState);
+}
+#endif
+
+static void DeviceDone(void)
+{
+    // a device read of the round has finished, the last one publishes the round
+    if(--roundPending != 0u)
+    {
+        return;
+    }
+
+#ifdef TIMER_DEBUG
+    busTicks = Timebase_Now() - kickTime;   // whole round
+    busTicksSum += busTicks;
+    busReads++;
+    if(busTicks > busTicksMax)
+    {
+        busTicksMax = busTicks;
+    }
+#endif
+
+    reading.frame[0].seq = sampleSeq;
+    for(uint8 i = 1; i < MPU_DEVICE_COUNT; i++)
+    {
+        reading.frame[i].timestamp = reading.frame[0].timestamp;
+        reading.frame[i].seq = sampleSeq;
+    }
+    sampleSeq++;                        // counts dropped rounds too, so the consumer sees the gap
+
+    (void) ImuRing_Push(&reading);        // a full ring is counted in ImuRing_Overruns()
+    PROFILE_SINCE(PROFILE_ACQUIRE, kickTime);
+}
+
+uint8 MPU_StartFrameRead(void)
+{
+    /*
+        Queues the burst reads of one round and returns without waiting for the bus.
+        If the previous round is still running the period is skipped and counted.
+    */
+    
+    uint8 status = I2C_STATUS_QUEUED;
+    uint8 intState;
+    
+    if(roundPending != 0u)
+    {
+        frameSkips++;               // previous round still on the bus, keep its timestamp
+        return I2C_STATUS_IN_PROGRESS;
+    }
+    
+#ifdef MPU_INT_PIN
+    AcqStart(Timebase_Now());
+#endif
+    kickTime = Timebase_Now();
+#ifdef MPU_INT_PIN
+    reading.frame[0].timestamp = sampleTimed ? sampleTime : kickTime;  // when the MPU took the sample, if known
+#else
+    reading.frame[0].timestamp = kickTime;
+#endif
+    reading.valid = 0;
+    roundPending = MPU_DEVICE_COUNT;    // before the first submit, the callbacks count it down
+
+    for(uint8 i = 0; i < MPU_DEVICE_COUNT; i++)
+    {
+        MPU_DEVICE *dev = &mpuDevices[i];
+        uint8 result;
+
+#ifdef SPLIT_READ
+        (void) I2cEngine_Submit(&dev->accelReq);    // accel in one transaction, gyro in another
+#endif
+        result = I2cEngine_Submit(&dev->frameReq);  // accel, temp and gyro in one repeated-start transaction
+        if(result != I2C_STATUS_QUEUED)
+        {
+            status = result;
+            intState = CyEnterCriticalSection();    // the Master interrupt counts down too
+            dev->errors++;
+            frameErrors++;
+            DeviceDone();
+            CyExitCriticalSection(intState);
+        }
+    }
+    
+    return status;
+}
+
+static void FrameComplete(I2C_REQUEST *req)
+{
+    // Runs in the Master interrupt when the burst of one device is in its raw buffer
+    MPU_DEVICE *dev = (MPU_DEVICE *)req->context;
+    IMU_FRAME *frame = &reading.frame[dev->index];
+    const uint8 *raw = dev->raw;
+    
+    if(req->status != I2C_STATUS_DONE)
+    {
+        dev->errors++;
+        frameErrors++;
+        DeviceDone();
+        return;
+    }
+    
+    for(uint8 i=0,j=0;i<=2;i++,j+=2)   // combines high and low bytes to one number
+    {      
+        frame->accel[i]=((raw[j]<< HIGH_BYTE_OFFSET)|(raw[j+LOW_BYTE_OFFSET]));
+        
+        frame->gyro[i]=((raw[j+GYRO_ARRAY_OFFSET_H]<< HIGH_BYTE_OFFSET)|raw[j+GYRO_ARRAY_OFFSET_L]);
+    }
+    frame->temp=((raw[TEMP_ARRAY_OFFSET_H]<< HIGH_BYTE_OFFSET)|raw[TEMP_ARRAY_OFFSET_L]);
+#ifdef MAGNETOMETER
+    DecodeMag(dev, frame, &raw[MPU_FRAME_SIZE]);
+#else
+    frame->magValid = FALSE;
+#endif
+    reading.valid |= (uint8)(1u << dev->index);
+    
+#ifdef MPU_INT_PIN
+    if(sampleTimed && dev->index == 0u)
+    {
+        uint32 latency = Timebase_Now() - sampleTime;
+        uint8 intState = CyEnterCriticalSection();   // mpuAcq is shared with the read start
+
+        if(latency < mpuAcq.latencyMin)
+        {
+            mpuAcq.latencyMin = latency;
+        }
+        if(latency > mpuAcq.latencyMax)
+        {
+            mpuAcq.latencyMax = latency;
+        }
+        mpuAcq.latencySum += latency;
+        mpuAcq.latencyCount++;
+        CyExitCriticalSection(intState);
+    }
+#endif
+    
+    DeviceDone();
+}
+
+/* [] END OF FILE */
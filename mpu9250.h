@@ -0,0 +1,212 @@
+/* ========================================
+ *
+ * Copyright YOUR COMPANY, THE YEAR
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CONFIDENTIAL AND PROPRIETARY INFORMATION
+ * WHICH IS THE PROPERTY OF your company.
+ *
+ * ========================================
+*/
+
+/*
+    MPU-9250 acquisition. MPU_StartFrameRead only queues the burst read on the
+    I2C engine, the frame is decoded and pushed to the IMU ring (imu_ring.h) from
+    the completion callback.
+
+    MPU_Init writes the register configuration table (mpuConfig in mpu9250.c)
+    to every device and reads it back. Adjacent registers go out as one auto
+    increment write and come back as one read. The full scale ranges in the
+    table are MPU_ACCEL_FS_SEL/MPU_GYRO_FS_SEL from main.h, the same macros the
+    sensitivities are derived from. A register that does not read back as
+    written counts in configErrors of its device and MPU_Init returns FALSE.
+
+    Reads are started either by Sampling_timer (polled) or, with
+    DATA_READY_SAMPLING, by the MPU's data-ready interrupt on the MPU_INT pin.
+    The MPU runs at MPU_SAMPLE_RATE_HZ behind its DLPF. With MPU_INT_PIN
+    every data-ready edge is timestamped in both modes, so mpuAcq shows what
+    the polled mode costs: duplicate reads of the same sample, missed samples,
+    and the latency from the sensor sample to the decoded frame.
+
+    Every sample period is one round over the MPU_DEVICE_COUNT devices in
+    mpuDevices: all burst reads are queued on the engine back to back and the
+    round goes into the ring as one IMU_ROUND once the last read has finished,
+    with or without error. All devices share the completion callback, the
+    request context points at the device. Data-ready and wake-on-motion use the
+    INT pin of device 0 only, the others are read in the same round and sleep
+    during wake-on-motion.
+
+    MAGNETOMETER: the AK8963 inside every MPU-9250 sits on the MPU's auxiliary
+    I2C bus. MPU_Init reads its sensitivity adjustment (fuse ROM) through the
+    bypass, starts it in 100 Hz continuous mode and hands it to the MPU's own
+    I2C master: slave 0 copies ST1..ST2 into EXT_SENS_DATA_00..07 after every
+    sample. Those registers follow GYRO_ZOUT_L, so the burst read just grows to
+    MPU_BURST_SIZE bytes and the PSoC never addresses the AK8963 again. The
+    magnetometer axes are swapped to the accel/gyro axes (x and y exchanged, z
+    negated) and the sensitivity adjustment applied when the frame is decoded.
+    A read without a new magnetometer sample (ST1 DRDY clear) or with a
+    magnetic overflow (ST2 HOFL) repeats the previous value.
+*/
+
+#if !defined(MPU9250_H)
+#define MPU9250_H
+
+#include "project.h"
+#include "main.h"
+#include "i2c_engine.h"
+
+/***************************************
+*            Constants
+****************************************/
+
+#define MPU_REG_SMPLRT_DIV      (0x19u)
+#define MPU_REG_CONFIG          (0x1Au)
+#define MPU_REG_GYRO_CONFIG     (0x1Bu)
+#define MPU_REG_ACCEL_CONFIG    (0x1Cu)
+#define MPU_REG_ACCEL_CONFIG2   (0x1Du)
+#define MPU_REG_INT_PIN_CFG     (0x37u)
+#define MPU_REG_INT_ENABLE      (0x38u)
+#define MPU_REG_LP_ACCEL_ODR    (0x1Eu)
+#define MPU_REG_WOM_THR         (0x1Fu)
+#define MPU_REG_MOT_DETECT_CTRL (0x69u)
+#define MPU_REG_PWR_MGMT_1      (0x6Bu)
+#define MPU_REG_PWR_MGMT_2      (0x6Cu)
+#define MPU_PWR1_SLEEP          (0x40u)     // PWR_MGMT_1: sleep
+#define MPU_PWR1_CLK_AUTO       (0x01u)     // PWR_MGMT_1: awake, gyro PLL clock once it is ready
+#define MPU_FS_SEL_SHIFT        (3u)        // GYRO_CONFIG/ACCEL_CONFIG: full scale select bits 4:3
+
+#define MPU_SAMPLE_RATE_HZ      (100u)      // matches dt and the Sampling_timer period
+#define MPU_INTERNAL_RATE_HZ    (1000u)     // gyro/accel rate with the DLPF enabled
+#define MPU_DLPF_41HZ           (0x03u)     // CONFIG: gyro 41 Hz bandwidth, below the 50 Hz Nyquist limit
+#define MPU_A_DLPF_45HZ         (0x03u)     // ACCEL_CONFIG2: accel 44.8 Hz bandwidth
+#define MPU_INT_PULSE_HIGH      (0x00u)     // INT_PIN_CFG: active high, push-pull, 50 us pulse per sample
+#define MPU_INT_RAW_RDY_EN      (0x01u)     // INT_ENABLE: data ready
+#ifdef MPU_INT_PIN
+    #define MPU_INT_CONFIG      (MPU_INT_RAW_RDY_EN)
+#else
+    #define MPU_INT_CONFIG      (0x00u)     // INT pin not wired, no interrupt source
+#endif
+
+#define MPU_DRDY_TIMEOUT_PERIODS (3u)       // data-ready silent this long, the timer takes over
+
+// Wake-on-motion (LOW_POWER)
+#define MPU_PWR1_CYCLE          (0x20u)     // PWR_MGMT_1: accel low power cycling
+#define MPU_PWR2_GYRO_OFF       (0x07u)     // PWR_MGMT_2: gyro x/y/z disabled, accel on
+#define MPU_A_DLPF_WOM          (0x09u)     // ACCEL_CONFIG2: FCHOICE_B = 1, A_DLPF_CFG = 1 as the register map asks for
+#define MPU_INT_WOM_EN          (0x40u)     // INT_ENABLE: wake on motion
+#define MPU_ACCEL_INTEL_COMPARE (0xC0u)     // MOT_DETECT_CTRL: enable, compare with the previous sample
+#define MPU_WOM_THRESHOLD       (32u)       // WOM_THR, 4 mg/LSB: 128 mg, a drop into free fall is 1 g
+#define MPU_WOM_ODR             (8u)        // LP_ACCEL_ODR: 62.5 Hz, motion seen within 16 ms
+
+// Magnetometer through the auxiliary I2C master (MAGNETOMETER)
+#define MPU_REG_I2C_MST_CTRL    (0x24u)
+#define MPU_REG_I2C_SLV0_ADDR   (0x25u)
+#define MPU_REG_I2C_SLV0_REG    (0x26u)
+#define MPU_REG_I2C_SLV0_CTRL   (0x27u)
+#define MPU_REG_USER_CTRL       (0x6Au)
+#define MPU_INT_BYPASS_EN       (0x02u)     // INT_PIN_CFG: aux bus connected to the main bus
+#define MPU_MST_WAIT_400KHZ     (0x4Du)     // I2C_MST_CTRL: data ready waits for the slaves, aux bus at 400 kHz
+#define MPU_SLV_READ            (0x80u)     // I2C_SLVx_ADDR: read
+#define MPU_SLV_EN              (0x80u)     // I2C_SLVx_CTRL: enable, length in the low bits
+#define MPU_USER_I2C_MST_EN     (0x20u)     // USER_CTRL: aux I2C master on, bypass off
+
+#define AK_ADDRESS              (0x0Cu)
+#define AK_REG_WIA              (0x00u)
+#define AK_REG_ST1              (0x02u)     // ST1, HXL..HZH, ST2: MPU_MAG_SIZE bytes
+#define AK_REG_CNTL1            (0x0Au)
+#define AK_REG_ASAX             (0x10u)     // sensitivity adjustment x, y, z (fuse ROM)
+#define AK_WIA_VALUE            (0x48u)
+#define AK_CNTL1_POWER_DOWN     (0x00u)
+#define AK_CNTL1_FUSE_ROM       (0x0Fu)
+#define AK_CNTL1_16BIT_100HZ    (0x16u)     // 16 bit output (0.15 uT/LSB), continuous measurement mode 2
+#define AK_MODE_DELAY_US        (100u)      // after every CNTL1 change
+#define AK_ST1_DRDY             (0x01u)
+#define AK_ST2_HOFL             (0x08u)
+#define MPU_MAG_SIZE            (8u)
+
+#ifdef MAGNETOMETER
+    #define MPU_BURST_SIZE      (MPU_FRAME_SIZE + MPU_MAG_SIZE)    // ACCEL_XOUT_H through EXT_SENS_DATA_07
+#else
+    #define MPU_BURST_SIZE      (MPU_FRAME_SIZE)
+#endif
+
+/***************************************
+*            Types
+****************************************/
+
+typedef struct
+{
+    uint8 reg;
+    uint8 value;
+} MPU_REG_VALUE;
+
+typedef struct
+{
+    uint8 address;          // 7 bit I2C address
+    uint8 index;            // position in IMU_ROUND.frame
+    uint8 raw[MPU_BURST_SIZE];  // accel+temp+gyro(+magnetometer) burst as on the bus
+    I2C_REQUEST frameReq;
+#ifdef SPLIT_READ
+    I2C_REQUEST accelReq;
+#endif
+    uint32 errors;          // reads that finished with an error or timeout, or were not accepted
+    uint8 configErrors;     // registers of mpuConfig that did not read back as written, last MPU_Init
+#ifdef MAGNETOMETER
+    uint8 magAdj[3];        // AK8963 ASAX..ASAZ, 0 when no magnetometer answered
+    int16 mag[3];           // last magnetometer sample, accel/gyro axes, adjusted
+    uint8 magSeen;          // mag holds a sample
+#endif
+} MPU_DEVICE;
+
+typedef struct
+{
+    uint32 reads;           // reads started
+    uint32 periodMin;       // time between read starts, Timebase cycles. Jitter is max - min
+    uint32 periodMax;
+    uint32 latencyMin;      // data-ready edge to decoded frame, Timebase cycles
+    uint32 latencyMax;
+    uint64 latencySum;
+    uint32 latencyCount;
+    uint32 duplicates;      // reads with no new sample since the previous read
+    uint32 missed;          // samples the MPU produced that were never read
+    uint32 fallbackReads;   // DATA_READY_SAMPLING: reads started by the timer because data-ready stopped
+} MPU_ACQ_STATS;            // written from several interrupts, every update is in a critical section
+
+/***************************************
+*        Function Prototypes
+****************************************/
+
+uint8 MPU_Init(void);
+uint8 MPU_StartFrameRead(void);
+#ifdef MPU_INT_PIN
+    void MPU_DataReady(void);
+    uint8 MPU_DataReadyAlive(void);
+#endif
+#ifdef LOW_POWER
+    void MPU_EnterWakeOnMotion(void);
+    void MPU_ExitWakeOnMotion(void);
+    uint8 MPU_MotionWake(void);
+#endif
+
+/***************************************
+*        External variables
+****************************************/
+
+extern MPU_DEVICE mpuDevices[MPU_DEVICE_COUNT];
+extern volatile uint32 frameErrors;     // device reads that failed, all devices
+extern volatile uint32 frameSkips;      // periods skipped because the previous round was still running
+#ifdef MPU_INT_PIN
+    extern MPU_ACQ_STATS mpuAcq;
+#endif
+
+#ifdef TIMER_DEBUG
+    extern volatile uint32 busTicks;
+    extern volatile uint32 busTicksMax;
+    extern volatile uint32 busTicksSum;
+    extern volatile uint32 busReads;
+#endif
+
+#endif
+
+/* [] END OF FILE */
@@ -0,0 +1,143 @@
+/* ========================================
+ *
+ * Copyright YOUR COMPANY, THE YEAR
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CONFIDENTIAL AND PROPRIETARY INFORMATION
+ * WHICH IS THE PROPERTY OF your company.
+ *
+ * ========================================
+*/
+
+#include "project.h"
+#include "power.h"
+#include "mpu9250.h"
+#include "timebase.h"
+#include "stdlib.h"
+
+#ifdef LOW_POWER
+
+#ifndef MPU_INT_PIN
+    #error "LOW_POWER needs the MPU INT pin (MPU_INT_PIN) to wake up"
+#endif
+
+/* Global variable declaration */
+    static int16 stillRef[3];       // accel when the still period started
+    static uint32 stillFrames = 0;
+    static uint32 lastNow = 0;
+    static uint8 waking = FALSE;    // next sample is the first after a wake
+    static uint32 wakeTime = 0;
+
+    POWER_STATS powerStats = { 0, 0, 0, 0xFFFFFFFFu, 0, 0 };
+
+void Power_Init(void)
+{
+    stillFrames = 0;
+    lastNow = Timebase_Now();
+}
+
+uint8 Power_Update(const IMU_FRAME *frame, uint8 busy)
+{
+    /*
+        Once per sample from the main loop. busy is TRUE while the actuator is
+        on or pending, the device never sleeps then. Returns TRUE when the
+        device has been still long enough to call Power_Sleep.
+    */
+
+    uint32 now = Timebase_Now();
+    uint8 moved = FALSE;
+
+    powerStats.activeTicks += now - lastNow;
+    lastNow = now;
+
+    if(waking && (int32)(frame->timestamp - wakeTime) >= 0)     // not a frame read before the sleep
+    {
+        waking = FALSE;
+        powerStats.wakeLatencyLast = now - wakeTime;
+        if(powerStats.wakeLatencyLast < powerStats.wakeLatencyMin)
+        {
+            powerStats.wakeLatencyMin = powerStats.wakeLatencyLast;
+        }
+        if(powerStats.wakeLatencyLast > powerStats.wakeLatencyMax)
+        {
+            powerStats.wakeLatencyMax = powerStats.wakeLatencyLast;
+        }
+    }
+
+    for(uint8 i = 0; i < 3u; i++)
+    {
+        if(abs(frame->accel[i] - stillRef[i]) > POWER_STILL_ACC)
+        {
+            moved = TRUE;
+        }
+    }
+
+    if(moved || busy || stillFrames == 0u)
+    {
+        for(uint8 i = 0; i < 3u; i++)
+        {
+            stillRef[i] = frame->accel[i];
+        }
+        stillFrames = (moved || busy) ? 0u : 1u;
+        return FALSE;
+    }
+
+    stillFrames++;
+
+    return (stillFrames >= POWER_STILL_FRAMES);
+}
+
+void Power_Sleep(void)
+{
+    /*
+        Blocks until the MPU reports motion. Only call from the main loop with
+        no actuator action pending, SysTick is stopped while asleep.
+    */
+
+    uint8 interruptState;
+
+    powerStats.sleeps++;
+    stillFrames = 0;
+
+    Sampling_timer_Stop();                      // no more reads, the last one finishes below
+    MPU_EnterWakeOnMotion();                    // blocking register writes, queue behind any read
+
+    Master_Sleep();
+    CyPmSaveClocks();
+
+    /*
+        The flag is tested with interrupts masked so a wake-on-motion pulse
+        taken by the data-ready ISR between the test and CyPmSleep can not be
+        lost: the pin interrupt stays pending and ends the sleep at once, the
+        ISR then runs when the critical section is left.
+    */
+    interruptState = CyEnterCriticalSection();
+    while(!MPU_MotionWake())
+    {
+        CyPmSleep(PM_SLEEP_TIME_CTW_1024MS, PM_SLEEP_SRC_PICU | PM_SLEEP_SRC_CTW);
+        CyExitCriticalSection(interruptState);  // the data-ready ISR takes the pulse here
+
+        if((CyPmReadStatus(CY_PM_CTW_INT) & CY_PM_CTW_INT) != 0u)
+        {
+            powerStats.sleepPeriods++;          // timewheel, still lying there
+        }
+
+        interruptState = CyEnterCriticalSection();
+    }
+    CyExitCriticalSection(interruptState);
+
+    CyPmRestoreClocks();
+    Master_Wakeup();
+
+    wakeTime = Timebase_Now();
+    lastNow = wakeTime;
+    waking = TRUE;
+
+    MPU_ExitWakeOnMotion();                     // full rate accel and gyro, data-ready back on
+    Sampling_timer_Start();
+}
+
+#endif
+
+/* [] END OF FILE */
@@ -0,0 +1,77 @@
+/* ========================================
+ *
+ * Copyright YOUR COMPANY, THE YEAR
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CONFIDENTIAL AND PROPRIETARY INFORMATION
+ * WHICH IS THE PROPERTY OF your company.
+ *
+ * ========================================
+*/
+
+/*
+    Low power mode while the device lies still (LOW_POWER in main.h).
+
+    Power_Update watches the accel. After POWER_STILL_FRAMES samples without
+    any axis moving more than POWER_STILL_ACC from where the still period
+    started, and with the actuator off, it asks for sleep. Power_Sleep then puts
+    the MPU into accel-only wake-on-motion (MPU_EnterWakeOnMotion), stops the
+    sampling timer and the I2C block and keeps the PSoC in CyPmSleep until the
+    MPU INT pin wakes it. The central timewheel wakes it every
+    POWER_CTW_PERIOD_MS as well, only to count the time spent asleep.
+
+    Worst case from the start of a fall to the first full rate sample is one
+    wake-on-motion period (16 ms at MPU_WOM_ODR), the wake-up and the
+    configuration table written and read back (a few ms at I2C_BUS_KHZ) and
+    one sample period. The free-fall window then
+    fills as usual. The gyro needs ~35 ms after wake to settle (datasheet), the
+    detector works on the accel and is not affected.
+
+    powerStats has the residency and the measured wake-to-first-sample latency.
+    The average current has to be measured on the supply. MPU-9250 datasheet
+    typicals for the sensor side: 3.2 mA gyro + accel at full rate, 19.8 uA
+    accel low power at 31.25 Hz.
+*/
+
+#if !defined(POWER_H)
+#define POWER_H
+
+#include "imu_types.h"
+#include "main.h"
+
+/***************************************
+*            Constants
+****************************************/
+
+#define POWER_STILL_FRAMES      (500u)      // 5 s at 100 Hz
+#define POWER_STILL_ACC         (MPU_ACCEL_LSB_PER_G / 20)      // 0.05 g in accel counts
+#define POWER_CTW_PERIOD_MS     (1024u)     // matches PM_SLEEP_TIME_CTW_1024MS
+
+/***************************************
+*            Types
+****************************************/
+
+typedef struct
+{
+    uint32 sleeps;              // times Power_Sleep was entered
+    uint32 sleepPeriods;        // timewheel wakes while asleep, POWER_CTW_PERIOD_MS each (ILO accuracy)
+    uint64 activeTicks;         // Timebase cycles awake. The DWT stops in sleep
+    uint32 wakeLatencyMin;      // wake to first decoded sample, Timebase cycles
+    uint32 wakeLatencyMax;
+    uint32 wakeLatencyLast;
+} POWER_STATS;
+
+/***************************************
+*        Function Prototypes
+****************************************/
+
+void Power_Init(void);
+uint8 Power_Update(const IMU_FRAME *frame, uint8 busy);
+void Power_Sleep(void);
+
+extern POWER_STATS powerStats;
+
+#endif
+
+/* [] END OF FILE */
@@ -0,0 +1,90 @@
+/* ========================================
+ *
+ * Copyright YOUR COMPANY, THE YEAR
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CONFIDENTIAL AND PROPRIETARY INFORMATION
+ * WHICH IS THE PROPERTY OF your company.
+ *
+ * ========================================
+*/
+
+#include "profile.h"
+
+#if defined(PROFILE) && !defined(HOST_BUILD)
+
+#include <stdio.h>
+
+static const char * const stageName[PROFILE_STAGES] = { "acq", "window", "euler", "quat", "decide", "sample", "encode" };
+
+/* Global variable declaration */
+    PROFILE_STATS profileStats[PROFILE_STAGES];
+
+void Profile_Reset(void)
+{
+    uint8 intState = CyEnterCriticalSection();     // PROFILE_ACQUIRE is recorded in the Master ISR
+
+    for(uint8 s = 0; s < PROFILE_STAGES; s++)
+    {
+        profileStats[s].count = 0;
+        profileStats[s].min = 0xFFFFFFFFu;
+        profileStats[s].max = 0;
+        profileStats[s].sum = 0;
+        for(uint8 b = 0; b < PROFILE_BUCKETS; b++)
+        {
+            profileStats[s].hist[b] = 0;
+        }
+    }
+
+    CyExitCriticalSection(intState);
+}
+
+void Profile_Record(uint8 stage, uint32 ticks)
+{
+    // Each stage has a single writer, main loop or ISR, so no locking here
+    PROFILE_STATS *p = &profileStats[stage];
+
+    p->count++;
+    p->sum += ticks;
+    if(ticks < p->min)
+    {
+        p->min = ticks;
+    }
+    if(ticks > p->max)
+    {
+        p->max = ticks;
+    }
+    p->hist[(ticks == 0u) ? 0u : (31u - __CLZ(ticks))]++;
+}
+
+uint16 Profile_Format(uint8 stage, char *buf, uint16 size)
+{
+    /*
+        One line per stage, cycles:
+            quat n=1000 min=812 mean=901 max=1406 h10=988 h11=12
+        hN is the number of samples between 2^N and 2^(N+1)-1 cycles, empty
+        buckets are left out. Returns the length written, truncated to size.
+    */
+
+    const PROFILE_STATS *p = &profileStats[stage];
+    uint32 mean = (p->count != 0u) ? (uint32)(p->sum / p->count) : 0u;
+    int len;
+
+    len = snprintf(buf, size, "%s n=%lu min=%lu mean=%lu max=%lu", stageName[stage], (unsigned long)p->count,
+                   (unsigned long)((p->count != 0u) ? p->min : 0u), (unsigned long)mean, (unsigned long)p->max);
+
+    for(uint8 b = 0; b < PROFILE_BUCKETS && len > 0 && len < (int)size; b++)
+    {
+        if(p->hist[b] != 0u)
+        {
+            len += snprintf(&buf[len], size - (uint16)len, " h%u=%lu", (unsigned)b, (unsigned long)p->hist[b]);
+        }
+    }
+
+    return (len < 0) ? 0u : ((len < (int)size) ? (uint16)len : (uint16)(size - 1u));
+}
+
+#endif
+
+/* [] END OF FILE */
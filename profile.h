@@ -0,0 +1,99 @@
+/* ========================================
+ *
+ * Copyright YOUR COMPANY, THE YEAR
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CONFIDENTIAL AND PROPRIETARY INFORMATION
+ * WHICH IS THE PROPERTY OF your company.
+ *
+ * ========================================
+*/
+
+/*
+    Per-stage cycle counts of the sample pipeline.
+
+    Define PROFILE in main.h to enable. Without it every macro below is empty and
+    nothing is linked in. Each stage keeps count, min, max, sum and a log2
+    histogram (bucket n holds times of 2^n to 2^(n+1)-1 cycles), all in Timebase
+    cycles. Read profileStats with the debugger, or format a stage with
+    Profile_Format.
+
+    Usage inside a function:
+
+        PROFILE_START(mark);                // takes the start time
+        ...
+        PROFILE_LAP(PROFILE_WINDOW, mark);  // records since mark, restarts mark
+        ...
+        PROFILE_LAP(PROFILE_EULER, mark);
+
+    The time spent in Profile_Record itself is not charged to the next stage.
+    With FUSION_COMPARE the fusion stages mix all estimators. Host builds never
+    profile, they have no DWT.
+*/
+
+#if !defined(PROFILE_H)
+#define PROFILE_H
+
+#include "imu_types.h"
+#include "main.h"
+
+/***************************************
+*            Constants
+****************************************/
+
+#define PROFILE_ACQUIRE     (0u)    // kick of the I2C burst until the frame is decoded (ISR)
+#define PROFILE_WINDOW      (1u)    // |a| and the running window
+#define PROFILE_EULER       (2u)    // accel angles and 1st filter / angle output
+#define PROFILE_QUAT        (3u)    // quaternion update, 2nd and final filter
+#define PROFILE_DECISION    (4u)    // Detect_Update and actuator
+#define PROFILE_SAMPLE      (5u)    // acquisition, fusion and detection tasks for one sample (main.c)
+#define PROFILE_ENCODE      (6u)    // ImuLog_Encode of one sample, TELEMETRY_COMPACT (telemetry.c)
+#define PROFILE_STAGES      (7u)
+
+#define PROFILE_BUCKETS     (32u)   // log2 buckets, covers the whole uint32 range
+#define PROFILE_LINE_SIZE   (160u)  // Profile_Format buffer, fits every bucket of a typical stage
+
+/***************************************
+*            Types
+****************************************/
+
+typedef struct
+{
+    uint32 count;
+    uint32 min;
+    uint32 max;
+    uint64 sum;
+    uint32 hist[PROFILE_BUCKETS];
+} PROFILE_STATS;
+
+#if defined(PROFILE) && !defined(HOST_BUILD)
+
+#include "timebase.h"
+
+extern PROFILE_STATS profileStats[PROFILE_STAGES];
+
+/***************************************
+*        Function Prototypes
+****************************************/
+
+void Profile_Reset(void);
+void Profile_Record(uint8 stage, uint32 ticks);
+uint16 Profile_Format(uint8 stage, char *buf, uint16 size);
+
+#define PROFILE_START(mark)         uint32 mark = Timebase_Now()
+#define PROFILE_LAP(stage, mark)    do { Profile_Record((stage), Timebase_Now() - (mark)); (mark) = Timebase_Now(); } while(0)
+#define PROFILE_SINCE(stage, start) Profile_Record((stage), Timebase_Now() - (start))
+
+#else
+
+#define Profile_Reset()
+#define PROFILE_START(mark)
+#define PROFILE_LAP(stage, mark)
+#define PROFILE_SINCE(stage, start)
+
+#endif
+
+#endif
+
+/* [] END OF FILE */
@@ -0,0 +1,176 @@
+/* ========================================
+ *
+ * Copyright YOUR COMPANY, THE YEAR
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CONFIDENTIAL AND PROPRIETARY INFORMATION
+ * WHICH IS THE PROPERTY OF your company.
+ *
+ * ========================================
+*/
+
+#include "scheduler.h"
+#include "main.h"
+#include "timebase.h"
+
+static void Tick(void);
+
+/* Global variable declaration */
+    static const SCHEDULER_TASK *taskTable;
+    static uint8 taskCount = 0;
+    static uint16 countdown[SCHEDULER_MAX_TASKS];   // ms to the next release of a periodic task
+    static uint32 releaseTime[SCHEDULER_MAX_TASKS]; // Timebase cycles
+    static volatile uint8 ready[SCHEDULER_MAX_TASKS];
+    static uint64 busyAtLoad = 0;                   // Scheduler_LoadPermille window start
+    static uint32 msAtLoad = 0;
+    static uint64 busyTotal = 0;
+
+    SCHEDULER_STATS schedulerStats[SCHEDULER_MAX_TASKS];
+    volatile uint32 schedulerMs = 0;                // SysTick ms since Scheduler_Start
+
+void Scheduler_Start(const SCHEDULER_TASK *tasks, uint8 count)
+{
+    // Takes the task table, count at most SCHEDULER_MAX_TASKS. Needs the SysTick running (Deferred_Init)
+    if(count > SCHEDULER_MAX_TASKS)
+    {
+        count = SCHEDULER_MAX_TASKS;
+    }
+
+    for(uint8 i = 0; i < count; i++)
+    {
+        countdown[i] = tasks[i].periodMs;
+        ready[i] = FALSE;
+        schedulerStats[i] = (SCHEDULER_STATS){ 0, 0, 0, 0, 0, 0, 0 };
+    }
+    taskTable = tasks;
+    taskCount = count;
+
+    (void) CySysTickSetCallback(SCHEDULER_TICK_CALLBACK, Tick);
+}
+
+void Scheduler_Release(uint8 task)
+{
+    // Makes task ready. From a task or an interrupt
+    uint8 intState = CyEnterCriticalSection();
+
+    if(ready[task])
+    {
+        schedulerStats[task].overruns++;
+    }
+    else
+    {
+        ready[task] = TRUE;
+        releaseTime[task] = Timebase_Now();
+        schedulerStats[task].releases++;
+    }
+
+    CyExitCriticalSection(intState);
+}
+
+static uint8 NextReady(void)
+{
+    // Highest priority ready task, taskCount if none. Polled tasks are released here
+    for(uint8 i = 0; i < taskCount; i++)
+    {
+        if(!ready[i] && taskTable[i].poll != NULL && taskTable[i].poll())
+        {
+            Scheduler_Release(i);
+        }
+        if(ready[i])
+        {
+            return i;
+        }
+    }
+
+    return taskCount;
+}
+
+static void Dispatch(uint8 i)
+{
+    SCHEDULER_STATS *stats = &schedulerStats[i];
+    uint32 start, end;
+    uint8 intState = CyEnterCriticalSection();
+
+    ready[i] = FALSE;                   // a release while running counts as the next one
+    CyExitCriticalSection(intState);
+    start = Timebase_Now();
+    taskTable[i].run();
+    end = Timebase_Now();
+
+    stats->runs++;
+    stats->busyTicks += end - start;
+    busyTotal += end - start;
+    if(start - releaseTime[i] > stats->latencyMax)
+    {
+        stats->latencyMax = start - releaseTime[i];
+    }
+    if(end - start > stats->runMax)
+    {
+        stats->runMax = end - start;
+    }
+    if(end - releaseTime[i] > TIMEBASE_TICKS((uint32)taskTable[i].deadlineMs * 1000u))
+    {
+        stats->misses++;
+    }
+}
+
+void Scheduler_Run(void)
+{
+    // Never returns
+    for(;;)
+    {
+        uint8 i = NextReady();
+
+        if(i < taskCount)
+        {
+            Dispatch(i);
+        }
+        else
+        {
+            uint8 intState = CyEnterCriticalSection();
+
+            if(NextReady() == taskCount)
+            {
+                __WFI();                // a pending interrupt ends it even while masked
+            }
+            CyExitCriticalSection(intState);
+        }
+    }
+}
+
+uint16 Scheduler_LoadPermille(void)
+{
+    // Busy share since the previous call, 0..1000. SysTick time base, the DWT may stop in WFI
+    uint32 ms = schedulerMs;
+    uint64 busy = busyTotal - busyAtLoad;
+    uint64 elapsed = (uint64)TIMEBASE_TICKS(1000u) * (ms - msAtLoad);
+    uint16 load;
+
+    busyAtLoad = busyTotal;
+    msAtLoad = ms;
+    if(elapsed == 0u)
+    {
+        return 0u;
+    }
+    load = (uint16)((busy * 1000u) / elapsed);
+
+    return (load > 1000u) ? 1000u : load;
+}
+
+static void Tick(void)
+{
+    // SysTick interrupt, every 1 ms
+    schedulerMs++;
+
+    for(uint8 i = 0; i < taskCount; i++)
+    {
+        if(taskTable[i].periodMs != 0u && --countdown[i] == 0u)
+        {
+            countdown[i] = taskTable[i].periodMs;
+            Scheduler_Release(i);
+        }
+    }
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,91 @@
+/* ========================================
+ *
+ * Copyright YOUR COMPANY, THE YEAR
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CONFIDENTIAL AND PROPRIETARY INFORMATION
+ * WHICH IS THE PROPERTY OF your company.
+ *
+ * ========================================
+*/
+
+/*
+    Cooperative scheduler for the main loop.
+
+    The work is split into rate groups, each a SCHEDULER_TASK in a static table
+    ordered by priority, index 0 first. A task becomes ready
+
+        every periodMs              counted by the SysTick interrupt
+        on Scheduler_Release        a previous stage or an interrupt hands it work
+        while poll() is TRUE        work waiting in a queue, e.g. the IMU ring
+
+    Scheduler_Run always runs the highest priority ready task to completion
+    and then starts again from the top. Nothing is preempted: a lower group adds
+    at most its own run time to the latency of a higher one, so everything
+    below the fall path must stay short, and blocking work (flash write,
+    sleep) must only be started while the detector is idle.
+
+    With nothing ready the CPU waits in WFI for the next interrupt: the
+    SysTick, the sampling timer or the I2C master. The readiness check and
+    the WFI run with interrupts masked, a pending interrupt still ends the WFI
+    so no release is missed.
+
+    Per task schedulerStats counts releases, runs, deadline misses (release to
+    completion longer than deadlineMs) and overruns (released again before it
+    ran), with the worst latency (release to start) and run time. A polled
+    task's release is the moment the scheduler first sees poll() TRUE.
+    Scheduler_LoadPermille gives the busy share since its last call, the rest
+    was spent in WFI.
+*/
+
+#if !defined(SCHEDULER_H)
+#define SCHEDULER_H
+
+#include "project.h"
+
+/***************************************
+*            Constants
+****************************************/
+
+#define SCHEDULER_MAX_TASKS         (8u)
+#define SCHEDULER_TICK_CALLBACK     (1u)    // SysTick callback slot, deferred.c has slot 0
+
+/***************************************
+*            Types
+****************************************/
+
+typedef struct
+{
+    void (*run)(void);          // runs to completion, must not wait for anything
+    uint8 (*poll)(void);        // NULL, or TRUE while the task has work waiting
+    uint16 periodMs;            // 0: released by Scheduler_Release or poll only
+    uint16 deadlineMs;          // from release to completion
+} SCHEDULER_TASK;
+
+typedef struct
+{
+    uint32 releases;
+    uint32 runs;
+    uint32 misses;              // finished later than deadlineMs after the release
+    uint32 overruns;            // released again while still waiting to run
+    uint32 latencyMax;          // release to start, Timebase cycles
+    uint32 runMax;              // Timebase cycles
+    uint64 busyTicks;           // sum of the run times
+} SCHEDULER_STATS;
+
+/***************************************
+*        Function Prototypes
+****************************************/
+
+void Scheduler_Start(const SCHEDULER_TASK *tasks, uint8 count);
+void Scheduler_Release(uint8 task);
+void Scheduler_Run(void);
+uint16 Scheduler_LoadPermille(void);
+
+extern SCHEDULER_STATS schedulerStats[SCHEDULER_MAX_TASKS];
+extern volatile uint32 schedulerMs;
+
+#endif
+
+/* [] END OF FILE */
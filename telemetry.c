@@ -0,0 +1,301 @@
+/* ========================================
+ *
+ * Copyright YOUR COMPANY, THE YEAR
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CONFIDENTIAL AND PROPRIETARY INFORMATION
+ * WHICH IS THE PROPERTY OF your company.
+ *
+ * ========================================
+*/
+
+#include "telemetry.h"
+#include "crc16.h"
+#include "imu_log.h"
+#include "profile.h"
+
+static uint8 *Put16(uint8 *p, uint16 x)
+{
+    p[0] = (uint8)x;
+    p[1] = (uint8)(x >> 8);
+    return p + 2;
+}
+
+static uint8 *Put32(uint8 *p, uint32 x)
+{
+    p[0] = (uint8)x;
+    p[1] = (uint8)(x >> 8);
+    p[2] = (uint8)(x >> 16);
+    p[3] = (uint8)(x >> 24);
+    return p + 4;
+}
+
+uint16 Telemetry_PackSample(uint8 *packet, const IMU_FRAME *frame, const FUSION_OUT *fused, uint8 flags)
+{
+    // layout in telemetry.h, returns TELEMETRY_SAMPLE_SIZE
+    uint8 *p = packet;
+
+    *p++ = TELEMETRY_TYPE_SAMPLE;
+    p = Put32(p, frame->seq);
+    p = Put32(p, frame->timestamp);
+    for(uint8 i = 0; i < 3u; i++)
+    {
+        p = Put16(p, (uint16)frame->accel[i]);
+    }
+    for(uint8 i = 0; i < 3u; i++)
+    {
+        p = Put16(p, (uint16)frame->gyro[i]);
+    }
+    p = Put16(p, (uint16)frame->temp);
+    p = Put32(p, (uint32)fused->rollQ16);
+    p = Put32(p, (uint32)fused->pitchQ16);
+    for(uint8 i = 0; i < 4u; i++)
+    {
+        p = Put32(p, (uint32)fused->quat[i]);
+    }
+    p = Put16(p, (uint16)fused->accLim);
+    *p++ = flags | (frame->magValid ? TELEMETRY_FLAG_MAG : 0u);
+    for(uint8 i = 0; i < 3u; i++)
+    {
+        p = Put16(p, (uint16)frame->mag[i]);
+    }
+    p = Put16(p, Crc16(packet, (uint16)(p - packet)));
+
+    return (uint16)(p - packet);
+}
+
+uint16 Telemetry_PackLog(uint8 *packet, const uint8 *records, uint16 len)
+{
+    // layout in telemetry.h, len up to TELEMETRY_LOG_PAYLOAD. Returns the packet length
+    uint8 *p = packet;
+
+    *p++ = TELEMETRY_TYPE_LOG;
+    for(uint16 i = 0; i < len; i++)
+    {
+        *p++ = records[i];
+    }
+    p = Put16(p, Crc16(packet, (uint16)(p - packet)));
+
+    return (uint16)(p - packet);
+}
+
+uint16 Telemetry_CobsEncode(uint8 *out, const uint8 *in, uint16 len)
+{
+    /*
+        COBS: every 0 byte is replaced by the distance to the next one, a code
+        byte of 0xFF means 254 data bytes without a 0. out needs len + len/254
+        + 2 bytes, the trailing 0 delimiter included. Returns the bytes written.
+    */
+
+    uint16 code = 0;        // position of the pending code byte
+    uint16 o = 1;
+    uint8 run = 1;
+
+    for(uint16 i = 0; i < len; i++)
+    {
+        if(in[i] == 0u)
+        {
+            out[code] = run;
+            code = o++;
+            run = 1;
+        }
+        else
+        {
+            out[o++] = in[i];
+            if(++run == 0xFFu)
+            {
+                out[code] = run;
+                code = o++;
+                run = 1;
+            }
+        }
+    }
+    out[code] = run;
+    out[o++] = 0u;
+
+    return o;
+}
+
+uint16 Telemetry_CobsDecode(uint8 *out, uint16 outSize, const uint8 *in, uint16 len)
+{
+    // in is one frame without its delimiter. Returns the decoded length, 0 if it is malformed
+    uint16 i = 0;
+    uint16 o = 0;
+
+    while(i < len)
+    {
+        uint8 code = in[i++];
+
+        if(code == 0u)
+        {
+            return 0u;
+        }
+        for(uint8 k = 1; k < code; k++)
+        {
+            if(i >= len || o >= outSize || in[i] == 0u)
+            {
+                return 0u;
+            }
+            out[o++] = in[i++];
+        }
+        if(code != 0xFFu && i < len)
+        {
+            if(o >= outSize)
+            {
+                return 0u;
+            }
+            out[o++] = 0u;
+        }
+    }
+
+    return o;
+}
+
+#if defined(TELEMETRY) && !defined(HOST_BUILD)
+
+#define TELEMETRY_NO_BUFFER     (0xFFu)
+
+/* Global variable declaration */
+    static uint8 buffer[2][TELEMETRY_MAX_ENCODED];
+    static uint16 length[2];
+    static volatile uint8 sending = TELEMETRY_NO_BUFFER;   // buffer the DMA is working on
+    static volatile uint8 queued = TELEMETRY_NO_BUFFER;    // encoded, next after sending
+    static uint8 dmaChannel;
+    static uint8 dmaTd;
+
+    TELEMETRY_STATS telemetryStats = { 0, 0 };
+
+#ifdef TELEMETRY_COMPACT
+    static IMU_LOG_ENCODER logEncoder;
+    static uint8 logRecords[TELEMETRY_LOG_PAYLOAD];     // the packet being filled
+    static uint16 logLen = 0;
+    static uint8 logSamples = 0;
+#endif
+
+static void StartDma(uint8 b)
+{
+    // interrupts off or in the completion ISR
+    (void) CyDmaTdSetConfiguration(dmaTd, length[b], CY_DMA_DISABLE_TD, TX_DMA__TD_TERMOUT_EN | CY_DMA_TD_INC_SRC_ADR);
+    (void) CyDmaTdSetAddress(dmaTd, LO16((uint32)buffer[b]), LO16((uint32)UART_TXDATA_PTR));
+    (void) CyDmaChSetInitialTd(dmaChannel, dmaTd);
+    sending = b;
+    telemetryStats.sent++;
+    (void) CyDmaChEnable(dmaChannel, 1u);
+}
+
+CY_ISR(TelemetryTxDone) // TX_DMA has moved the last byte into the UART FIFO
+{
+    if(queued != TELEMETRY_NO_BUFFER)
+    {
+        uint8 b = queued;
+
+        queued = TELEMETRY_NO_BUFFER;
+        StartDma(b);
+    }
+    else
+    {
+        sending = TELEMETRY_NO_BUFFER;
+    }
+}
+
+void Telemetry_Start(void)
+{
+    UART_Start();
+    dmaChannel = TX_DMA_DmaInitialize(1u, 1u, HI16(CYDEV_SRAM_BASE), HI16(CYDEV_PERIPH_BASE));   // a byte per FIFO request
+    dmaTd = CyDmaTdAllocate();
+    Tx_done_intr_StartEx(TelemetryTxDone);
+#ifdef TELEMETRY_COMPACT
+    ImuLog_InitEncoder(&logEncoder);
+#endif
+}
+
+uint8 Telemetry_Send(const IMU_FRAME *frame, const FUSION_OUT *fused, uint8 flags)
+{
+    /*
+        Main loop only. Returns FALSE when the sample was dropped because the
+        DMA is still busy with the previous two.
+    */
+
+    uint8 packet[TELEMETRY_SAMPLE_SIZE];
+
+    return Telemetry_SendPacket(packet, Telemetry_PackSample(packet, frame, fused, flags));
+}
+
+uint8 Telemetry_SendPacket(const uint8 *packet, uint16 len)
+{
+    // Main loop only, len up to TELEMETRY_PACKET_MAX. FALSE when both buffers are busy
+    uint8 b = TELEMETRY_NO_BUFFER;
+    uint8 intState;
+
+    // the ISR only ever releases buffers, so a free one stays free until it is queued below
+    intState = CyEnterCriticalSection();
+    for(uint8 i = 0; i < 2u; i++)
+    {
+        if(sending != i && queued != i)
+        {
+            b = i;
+            break;
+        }
+    }
+    CyExitCriticalSection(intState);
+
+    if(b == TELEMETRY_NO_BUFFER)
+    {
+        telemetryStats.dropped++;
+        return FALSE;
+    }
+
+    length[b] = Telemetry_CobsEncode(buffer[b], packet, len);
+
+    intState = CyEnterCriticalSection();
+    if(sending == TELEMETRY_NO_BUFFER)
+    {
+        StartDma(b);
+    }
+    else
+    {
+        queued = b;
+    }
+    CyExitCriticalSection(intState);
+
+    return TRUE;
+}
+
+#ifdef TELEMETRY_COMPACT
+uint8 Telemetry_SendLog(const IMU_FRAME *frame)
+{
+    /*
+        Main loop only. Adds the sample to the log packet and sends the packet
+        every TELEMETRY_LOG_SAMPLES samples, or before a record might not fit.
+        Returns FALSE when a full packet was dropped, the next one then starts
+        with a key so the host only loses the dropped one.
+    */
+
+    uint8 sent = TRUE;
+
+    PROFILE_START(mark);
+    logLen += ImuLog_Encode(&logEncoder, &logRecords[logLen], frame);
+    PROFILE_SINCE(PROFILE_ENCODE, mark);
+    logSamples++;
+
+    if(logSamples >= TELEMETRY_LOG_SAMPLES || logLen + IMU_LOG_MAX_RECORD > TELEMETRY_LOG_PAYLOAD)
+    {
+        uint8 packet[TELEMETRY_PACKET_MAX];
+
+        sent = Telemetry_SendPacket(packet, Telemetry_PackLog(packet, logRecords, logLen));
+        if(!sent)
+        {
+            ImuLog_Resync(&logEncoder);
+        }
+        logLen = 0;
+        logSamples = 0;
+    }
+
+    return sent;
+}
+#endif
+
+#endif
+
+/* [] END OF FILE */
@@ -0,0 +1,124 @@
+/* ========================================
+ *
+ * Copyright YOUR COMPANY, THE YEAR
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CONFIDENTIAL AND PROPRIETARY INFORMATION
+ * WHICH IS THE PROPERTY OF your company.
+ *
+ * ========================================
+*/
+
+/*
+    Binary telemetry, one packet per sample (TELEMETRY in main.h).
+
+    Packet, all fields little endian, TELEMETRY_SAMPLE_SIZE bytes:
+
+        0   uint8   type            TELEMETRY_TYPE_SAMPLE
+        1   uint32  seq             IMU_FRAME.seq
+        5   uint32  timestamp       IMU_FRAME.timestamp, Timebase cycles
+        9   int16   accel[3]        counts, offsets removed (calib.h)
+        15  int16   gyro[3]
+        21  int16   temp
+        23  int32   rollQ16         FUSION_OUT, deg Q16
+        27  int32   pitchQ16
+        31  int32   quat[4]         Q30
+        47  int16   accLim          0.1 g
+        49  uint8   flags           TELEMETRY_FLAG_*
+        50  int16   mag[3]          0.15 uT counts, hard-iron removed, valid with TELEMETRY_FLAG_MAG
+        56  uint16  crc             Crc16 (crc16.h) over bytes 0..55
+
+    The packet is COBS encoded and ends with a 0 byte, so a receiver
+    resynchronizes at the next 0 after a lost byte. 60 bytes on the wire,
+    6000 bytes/s at 100 Hz, fits 115200 baud with the line idle 48 % of the time.
+
+    With TELEMETRY_COMPACT the samples go out as the compressed log of
+    imu_log.h instead, TELEMETRY_LOG_SAMPLES per packet, raw IMU_FRAME fields
+    only (replay recomputes fusion and detection on the host):
+
+        0   uint8   type            TELEMETRY_TYPE_LOG
+        1   ...     records         whole imu_log records, up to TELEMETRY_LOG_PAYLOAD bytes
+        n   uint16  crc             Crc16 over bytes 0..n-1
+
+    Records continue from packet to packet. When a packet is dropped the next
+    one starts with a key, and a receiver that sees a bad packet waits for
+    the next key (ImuLog_Desync). ~13.5 bytes per sample on the wire with
+    the magnetometer (host/imu_log stats, packet and COBS overhead
+    included), under a quarter of the sample packets.
+
+    Telemetry_Send encodes into one of two buffers while the DMA sends the
+    other one from SRAM into the UART TX FIFO. The TX_DMA completion interrupt
+    starts the buffer waiting behind it, so the CPU only spends the encoding
+    (~60 bytes) per sample. With both buffers taken the new sample is dropped
+    and counted. Telemetry_SendPacket queues other packet types (blackbox.h)
+    the same way.
+
+    TopDesign needs (not in this tree, place them in PSoC Creator):
+        UART        TX only, 115200 8N1, TX buffer 4 (hardware FIFO only),
+                    tx_interrupt on "TX FIFO not full" wired to TX_DMA drq
+        TX_DMA      DMA component, hardware request level, nrq to Tx_done_intr
+        Tx_done_intr  isr, rising edge
+
+    host/telemetry_decode reads the captured stream.
+*/
+
+#if !defined(TELEMETRY_H)
+#define TELEMETRY_H
+
+#include "imu_types.h"
+#include "main.h"
+#include "fusion.h"
+
+/***************************************
+*            Constants
+****************************************/
+
+#define TELEMETRY_TYPE_SAMPLE   (0x01u)
+#define TELEMETRY_TYPE_BLACKBOX (0x02u)     // black-box window record, layout in blackbox.h
+#define TELEMETRY_TYPE_LOG      (0x03u)     // compressed samples, TELEMETRY_COMPACT
+#define TELEMETRY_SAMPLE_SIZE   (58u)       // with the CRC
+#define TELEMETRY_LOG_PAYLOAD   (160u)      // records per log packet, bytes
+#define TELEMETRY_LOG_SAMPLES   (10u)       // samples per log packet, 100 ms at 100 Hz
+#define TELEMETRY_PACKET_MAX    (TELEMETRY_LOG_PAYLOAD + 3u)    // largest packet, the log packet with type and CRC
+#define TELEMETRY_MAX_ENCODED   (TELEMETRY_PACKET_MAX + TELEMETRY_PACKET_MAX / 254u + 2u)    // COBS + delimiter
+
+// flags
+#define TELEMETRY_FLAG_ACTUATOR (0x01u)     // detector has the actuator on
+#define TELEMETRY_FLAG_PENDING  (0x02u)     // actuator scheduled, not on yet
+#define TELEMETRY_FLAG_MAG      (0x04u)     // mag holds a magnetometer sample, set from IMU_FRAME.magValid
+
+/***************************************
+*            Types
+****************************************/
+
+typedef struct
+{
+    uint32 sent;                // packets handed to the DMA
+    uint32 dropped;             // packets with both buffers busy
+} TELEMETRY_STATS;
+
+/***************************************
+*        Function Prototypes
+****************************************/
+
+// Hardware free, shared with the host decoder
+uint16 Telemetry_PackSample(uint8 *packet, const IMU_FRAME *frame, const FUSION_OUT *fused, uint8 flags);
+uint16 Telemetry_PackLog(uint8 *packet, const uint8 *records, uint16 len);
+uint16 Telemetry_CobsEncode(uint8 *out, const uint8 *in, uint16 len);
+uint16 Telemetry_CobsDecode(uint8 *out, uint16 outSize, const uint8 *in, uint16 len);
+
+#if defined(TELEMETRY) && !defined(HOST_BUILD)
+void Telemetry_Start(void);
+uint8 Telemetry_Send(const IMU_FRAME *frame, const FUSION_OUT *fused, uint8 flags);
+uint8 Telemetry_SendPacket(const uint8 *packet, uint16 len);
+#ifdef TELEMETRY_COMPACT
+uint8 Telemetry_SendLog(const IMU_FRAME *frame);
+#endif
+
+extern TELEMETRY_STATS telemetryStats;
+#endif
+
+#endif
+
+/* [] END OF FILE */
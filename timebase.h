@@ -0,0 +1,44 @@
+/* ========================================
+ *
+ * Copyright YOUR COMPANY, THE YEAR
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CONFIDENTIAL AND PROPRIETARY INFORMATION
+ * WHICH IS THE PROPERTY OF your company.
+ *
+ * ========================================
+*/
+
+/*
+    Free running cycle counter used for timeouts and timestamps.
+
+    The Cortex-M3 DWT cycle counter runs at the CPU clock (BUS_CLK on this design)
+    and wraps after 2^32 cycles (~67 s at 64 MHz). Always compare times by
+    subtracting, never with < or >, so the wrap is harmless.
+*/
+
+#if !defined(TIMEBASE_H)
+#define TIMEBASE_H
+
+#include "project.h"
+
+#define TIMEBASE_TICKS_PER_US   (BCLK__BUS_CLK__MHZ)
+#define TIMEBASE_US(ticks)      ((uint32)(ticks) / TIMEBASE_TICKS_PER_US)
+#define TIMEBASE_TICKS(us)      ((uint32)(us) * TIMEBASE_TICKS_PER_US)
+
+static CY_INLINE void Timebase_Start(void)
+{
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;     // enable the DWT unit
+    DWT->CYCCNT = 0u;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;                // start counting cycles
+}
+
+static CY_INLINE uint32 Timebase_Now(void)
+{
+    return DWT->CYCCNT;
+}
+
+#endif
+
+/* [] END OF FILE */
@@ -0,0 +1,141 @@
+/* ========================================
+ *
+ * Copyright YOUR COMPANY, THE YEAR
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CONFIDENTIAL AND PROPRIETARY INFORMATION
+ * WHICH IS THE PROPERTY OF your company.
+ *
+ * ========================================
+*/
+
+#include "vote.h"
+#include "stdlib.h"
+
+void Vote_Init(VOTE_STATE *vote)
+{
+    for(uint8 d = 0; d < MPU_DEVICE_COUNT; d++)
+    {
+        VOTE_DEVICE *dev = &vote->device[d];
+
+        Fusion_Init(&dev->fusion);
+        for(uint8 i = 0; i < 6u; i++)
+        {
+            dev->lastRaw[i] = 0;
+        }
+        dev->unchanged = 0;
+        dev->missing = 0;
+        dev->saturated = 0;
+        dev->stuck = 0;
+    }
+    vote->chosen = 0;
+    vote->disagreements = 0;
+    vote->noneHealthy = 0;
+}
+
+static uint8 Healthy(VOTE_DEVICE *dev, const IMU_FRAME *frame)
+{
+    // fault checks on the sample, saturation as Calib_Update saw it before correcting, counts the faults
+    uint8 saturated = FALSE;
+    uint8 same = TRUE;
+
+    for(uint8 i = 0; i < 3u; i++)
+    {
+        if(frame->saturated || abs(frame->accel[i]) >= VOTE_FULL_SCALE || abs(frame->gyro[i]) >= VOTE_FULL_SCALE)
+        {
+            saturated = TRUE;
+        }
+        if(frame->accel[i] != dev->lastRaw[i] || frame->gyro[i] != dev->lastRaw[i + 3u])
+        {
+            same = FALSE;
+        }
+        dev->lastRaw[i] = frame->accel[i];
+        dev->lastRaw[i + 3u] = frame->gyro[i];
+    }
+
+    dev->unchanged = same ? dev->unchanged + 1u : 0u;
+
+    if(saturated)
+    {
+        dev->saturated++;
+        return FALSE;
+    }
+    if(dev->unchanged >= VOTE_STUCK_FRAMES)
+    {
+        dev->stuck++;
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+uint8 Vote_Round(VOTE_STATE *vote, const IMU_ROUND *round, FUSION_OUT *out)
+{
+    /*
+        Fuses every device that was read and copies the output of the chosen
+        one to out. Returns the index of the chosen device, its frame is the
+        sample the output belongs to. VOTE_NONE without a healthy device, out
+        is not written then.
+    */
+
+    uint8 healthy[MPU_DEVICE_COUNT];
+    uint8 n = 0;
+
+    for(uint8 d = 0; d < MPU_DEVICE_COUNT; d++)
+    {
+        VOTE_DEVICE *dev = &vote->device[d];
+
+        if(!(round->valid & (1u << d)))
+        {
+            dev->missing++;
+            continue;
+        }
+
+        Fusion_Update(&dev->fusion, &round->frame[d], &dev->out);   // even when faulty, to stay in step
+
+        if(Healthy(dev, &round->frame[d]))
+        {
+            // insertion sort by |a|, MPU_DEVICE_COUNT is small
+            uint8 k = n++;
+
+            while(k > 0u && vote->device[healthy[k - 1u]].out.accNow > dev->out.accNow)
+            {
+                healthy[k] = healthy[k - 1u];
+                k--;
+            }
+            healthy[k] = d;
+        }
+    }
+
+    if(n == 0u)
+    {
+        vote->noneHealthy++;
+        return VOTE_NONE;
+    }
+    else if(n == 2u)
+    {
+        const VOTE_DEVICE *a = &vote->device[healthy[0]];
+        const VOTE_DEVICE *b = &vote->device[healthy[1]];
+
+        if(abs(b->out.accNow - a->out.accNow) > VOTE_AGREE_ACC)
+        {
+            vote->disagreements++;
+        }
+        if(vote->chosen != healthy[0] && vote->chosen != healthy[1])
+        {
+            vote->chosen = ((a->missing + a->saturated + a->stuck) <= (b->missing + b->saturated + b->stuck)) ?
+                           healthy[0] : healthy[1];
+        }
+    }
+    else
+    {
+        vote->chosen = healthy[n / 2u];     // median, the only one with n == 1
+    }
+
+    *out = vote->device[vote->chosen].out;
+
+    return vote->chosen;
+}
+
+/* [] END OF FILE */
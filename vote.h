@@ -0,0 +1,86 @@
+/* ========================================
+ *
+ * Copyright YOUR COMPANY, THE YEAR
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CONFIDENTIAL AND PROPRIETARY INFORMATION
+ * WHICH IS THE PROPERTY OF your company.
+ *
+ * ========================================
+*/
+
+/*
+    Sensor voting over the MPU_DEVICE_COUNT devices of a round.
+
+    Every device has its own fusion state and is fused on every round it
+    was read in. A device is left out of the vote for the round when
+    - its read failed (not in IMU_ROUND.valid),
+    - any accel or gyro axis is at full scale (saturated, the value is a limit
+      and not a measurement). Judged on the raw sample: IMU_FRAME.saturated
+      is set before the calibration offsets move the value off the limit,
+    - its raw accel and gyro have not changed for VOTE_STUCK_FRAMES rounds
+      (stuck, real sensor noise always moves the last bits).
+
+    Of the devices left, the one with the median |a| gives the output, so a
+    single wrong sensor can not decide with three or more. Two devices that
+    disagree by more than VOTE_AGREE_ACC can not be told apart: the previous
+    choice is kept while it is healthy, else the one with fewer faults, and
+    the disagreement is counted. With no healthy device there is no output
+    for the round: Vote_Round returns VOTE_NONE, leaves out as it was and
+    counts the round in noneHealthy. The caller skips the round rather than
+    use a frame that failed its read or was judged faulty.
+
+    The whole FUSION_OUT of one device is taken, never a mix of devices, so
+    the quaternion and angles stay consistent.
+*/
+
+#if !defined(VOTE_H)
+#define VOTE_H
+
+#include "imu_types.h"
+#include "imu_ring.h"
+#include "fusion.h"
+
+/***************************************
+*            Constants
+****************************************/
+
+#define VOTE_STUCK_FRAMES   (10u)       // identical raw samples in a row, 100 ms
+#define VOTE_FULL_SCALE     (IMU_FULL_SCALE)    // |raw| at or above this is saturated
+#define VOTE_AGREE_ACC      (MPU_ACCEL_LSB_PER_G / 10)  // 0.1 g difference of |a| still agrees
+#define VOTE_NONE           (MPU_DEVICE_COUNT)  // Vote_Round result of a round without a healthy device
+
+/***************************************
+*            Types
+****************************************/
+
+typedef struct
+{
+    FUSION_STATE fusion;
+    FUSION_OUT out;             // of the last round the device was read in
+    int16 lastRaw[6];           // accel and gyro of the previous round
+    uint16 unchanged;           // rounds in a row with lastRaw unchanged
+    uint32 missing;             // rounds the read failed
+    uint32 saturated;
+    uint32 stuck;
+} VOTE_DEVICE;
+
+typedef struct
+{
+    VOTE_DEVICE device[MPU_DEVICE_COUNT];
+    uint8 chosen;               // device that gave the last output, kept over VOTE_NONE rounds
+    uint32 disagreements;       // two healthy devices more than VOTE_AGREE_ACC apart
+    uint32 noneHealthy;         // rounds without a healthy device, returned as VOTE_NONE
+} VOTE_STATE;
+
+/***************************************
+*        Function Prototypes
+****************************************/
+
+void Vote_Init(VOTE_STATE *vote);
+uint8 Vote_Round(VOTE_STATE *vote, const IMU_ROUND *round, FUSION_OUT *out);
+
+#endif
+
+/* [] END OF FILE */
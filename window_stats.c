@@ -0,0 +1,126 @@
+/* ========================================
+ *
+ * Copyright YOUR COMPANY, THE YEAR
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CONFIDENTIAL AND PROPRIETARY INFORMATION
+ * WHICH IS THE PROPERTY OF your company.
+ *
+ * ========================================
+*/
+
+#include "window_stats.h"
+
+static uint16 Wrap(uint16 i)
+{
+    return (i >= WINDOW_STATS_LEN) ? (uint16)(i - WINDOW_STATS_LEN) : i;
+}
+
+void WindowStats_Init(WINDOW_STATS *w)
+{
+    for(uint16 i = 0; i < WINDOW_STATS_LEN; i++)
+    {
+        w->values[i] = 0;
+    }
+    w->pos = 0;
+    w->count = 0;
+    w->minHead = 0;
+    w->minCount = 0;
+    w->maxHead = 0;
+    w->maxCount = 0;
+    w->sum = 0;
+    w->sumSq = 0;
+}
+
+void WindowStats_Push(WINDOW_STATS *w, int32 x)
+{
+    uint16 slot = w->pos;
+
+    if(w->count == WINDOW_STATS_LEN)
+    {
+        // the oldest sample leaves, and with it the deque fronts that point at its slot
+        int32 old = w->values[slot];
+
+        w->sum -= old;
+        w->sumSq -= (uint64)((int64)old * old);
+
+        if(w->minCount != 0u && w->minQ[w->minHead] == slot)
+        {
+            w->minHead = Wrap(w->minHead + 1u);
+            w->minCount--;
+        }
+        if(w->maxCount != 0u && w->maxQ[w->maxHead] == slot)
+        {
+            w->maxHead = Wrap(w->maxHead + 1u);
+            w->maxCount--;
+        }
+    }
+    else
+    {
+        w->count++;
+    }
+
+    w->values[slot] = x;
+    w->sum += x;
+    w->sumSq += (uint64)((int64)x * x);
+
+    // drop every entry the new sample makes irrelevant, then append it
+    while(w->minCount != 0u && w->values[w->minQ[Wrap(w->minHead + w->minCount - 1u)]] >= x)
+    {
+        w->minCount--;
+    }
+    w->minQ[Wrap(w->minHead + w->minCount)] = slot;
+    w->minCount++;
+
+    while(w->maxCount != 0u && w->values[w->maxQ[Wrap(w->maxHead + w->maxCount - 1u)]] <= x)
+    {
+        w->maxCount--;
+    }
+    w->maxQ[Wrap(w->maxHead + w->maxCount)] = slot;
+    w->maxCount++;
+
+    w->pos = Wrap(slot + 1u);
+}
+
+int32 WindowStats_Min(const WINDOW_STATS *w)
+{
+    return (w->minCount != 0u) ? w->values[w->minQ[w->minHead]] : 0;
+}
+
+int32 WindowStats_Max(const WINDOW_STATS *w)
+{
+    return (w->maxCount != 0u) ? w->values[w->maxQ[w->maxHead]] : 0;
+}
+
+int32 WindowStats_Mean(const WINDOW_STATS *w)
+{
+    // rounded to nearest, the sum fits in 32 bits for any window below 32768 samples
+    int32 sum = (int32)w->sum;
+    int32 n = (int32)w->count;
+
+    if(n == 0)
+    {
+        return 0;
+    }
+
+    return (sum >= 0) ? (sum + n / 2) / n : -((-sum + n / 2) / n);
+}
+
+uint32 WindowStats_Variance(const WINDOW_STATS *w)
+{
+    // population variance, floor((n * sumSq - sum^2) / n^2)
+    uint64 n = w->count;
+    uint64 num;
+
+    if(n == 0u)
+    {
+        return 0u;
+    }
+
+    num = n * w->sumSq - (uint64)(w->sum * w->sum);
+
+    return (uint32)(num / (n * n));
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,76 @@
+/* ========================================
+ *
+ * Copyright YOUR COMPANY, THE YEAR
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CONFIDENTIAL AND PROPRIETARY INFORMATION
+ * WHICH IS THE PROPERTY OF your company.
+ *
+ * ========================================
+*/
+
+/*
+    Sliding window statistics over the last WINDOW_STATS_LEN samples.
+
+    Every push and every query is O(1) (min/max amortized). Sum and sum of
+    squares are exact 64 bit integers, so nothing drifts however long it runs.
+    Min and max come from two monotonic deques of buffer positions. An entry
+    leaves the front of a deque when its buffer slot is overwritten.
+
+    Samples must stay within +-65536, then the variance is exact as well
+    (len * sumSq < 2^63). Before the window is full the statistics cover the
+    samples pushed so far. host/window_check compares every query with a
+    brute force window.
+
+    One window is meant to be shared by all the detectors working on the same
+    signal (free fall, impact, stillness), so the length is a single
+    compile-time constant.
+*/
+
+#if !defined(WINDOW_STATS_H)
+#define WINDOW_STATS_H
+
+#include "imu_types.h"
+
+/***************************************
+*            Constants
+****************************************/
+
+#define WINDOW_STATS_LEN    (10u)       // samples, 100 ms at 100 Hz
+
+/***************************************
+*            Types
+****************************************/
+
+typedef struct
+{
+    int32 values[WINDOW_STATS_LEN];     // ring of samples, values[pos] is the oldest once full
+    uint16 minQ[WINDOW_STATS_LEN];      // positions with increasing values, front is the min
+    uint16 maxQ[WINDOW_STATS_LEN];      // positions with decreasing values, front is the max
+    uint16 pos;                         // slot of the next sample
+    uint16 count;                       // samples in the window, up to WINDOW_STATS_LEN
+    uint16 minHead, minCount;
+    uint16 maxHead, maxCount;
+    int64 sum;
+    uint64 sumSq;
+} WINDOW_STATS;
+
+/***************************************
+*        Function Prototypes
+****************************************/
+
+void WindowStats_Init(WINDOW_STATS *w);
+void WindowStats_Push(WINDOW_STATS *w, int32 x);
+int32 WindowStats_Min(const WINDOW_STATS *w);
+int32 WindowStats_Max(const WINDOW_STATS *w);
+int32 WindowStats_Mean(const WINDOW_STATS *w);
+uint32 WindowStats_Variance(const WINDOW_STATS *w);
+
+#define WindowStats_Sum(w)      ((w)->sum)
+#define WindowStats_Count(w)    ((w)->count)
+#define WindowStats_Full(w)     ((w)->count == WINDOW_STATS_LEN)
+
+#endif
+
+/* [] END OF FILE */